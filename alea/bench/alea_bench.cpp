@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+/**
+ * Benchmark for the alea accumulators.
+ *
+ * Feeds time series generated by a VAR(1) model into each accumulator type,
+ * sweeping vector size, batch size and granularity, and writes one line of
+ * comma-separated values per configuration to standard output:
+ *
+ *   - `samples_per_sec`:  ingestion throughput (excluding data generation)
+ *   - `state_bytes`:      size of the serialized result
+ *   - `bytes_per_sample`: `state_bytes / nsamples`, i.e., the retained state
+ *                         per ingested sample (compare with the input size of
+ *                         `size * sizeof(double)` bytes per sample)
+ *   - `finalize_sec`:     time taken by `finalize()`
+ *   - `metric`, `error`:  accuracy against the analytic moments of the model,
+ *                         i.e., deviation of the mean in units of the exact
+ *                         error (`mean_z`) or relative deviation of the
+ *                         autocorrelation time implied by the error estimate
+ *                         (`tau_rel`)
+ *
+ * Usage: alea_bench [nsamples]
+ */
+#include <alps/alea.hpp>
+#include <alps/alea/util/model.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace alea = alps::alea;
+
+typedef std::chrono::steady_clock bench_clock;
+
+/** Analytic moments of a VAR(1) model with diagonal `phi1` */
+struct exact_moments
+{
+    exact_moments(const alea::util::var1_model<double> &model)
+        : mean(model.mean())
+        , var(model.size())
+        , tau(model.size())
+    {
+        // model.cov() scales as size**6, so we exploit the diagonal phi1
+        for (size_t i = 0; i != (size_t)mean.size(); ++i) {
+            double phi = model.phi1()(i, i);
+            var(i) = model.var_eps()(i) / (1 - phi * phi);
+            tau(i) = phi / (1 - phi);
+        }
+    }
+
+    /** Standard error of the mean after `n` samples */
+    Eigen::VectorXd stderror(size_t n) const
+    {
+        return (var.array() * (1 + 2 * tau.array()) / n).sqrt().matrix();
+    }
+
+    Eigen::VectorXd mean, var, tau;
+};
+
+/** Returns model with autocorrelation times spread between 1 and 9 */
+alea::util::var1_model<double> make_model(size_t size)
+{
+    Eigen::VectorXd phi0 = Eigen::VectorXd::Ones(size);
+    Eigen::VectorXd veps = Eigen::VectorXd::Ones(size);
+    Eigen::MatrixXd phi1 = Eigen::MatrixXd::Zero(size, size);
+    for (size_t i = 0; i != size; ++i)
+        phi1(i, i) = size > 1 ? 0.5 + 0.4 * i / (size - 1) : 0.5;
+    return alea::util::var1_model<double>(phi0, phi1, veps);
+}
+
+/** Generates time series with the steps in the columns */
+Eigen::MatrixXd make_series(const alea::util::var1_model<double> &model,
+                            size_t nsamples)
+{
+    alea::util::var1_run<double> run = model.start();
+    boost::random::mt19937 engine;
+
+    // discard initial transient
+    for (size_t t = 0; t != 1000; ++t)
+        run.step(engine);
+
+    Eigen::MatrixXd series(model.size(), nsamples);
+    run.step_block(engine, series);
+    return series;
+}
+
+/**
+ * Largest relative deviation of the autocorrelation time implied by the
+ * standard error `stderror` after `n` samples from the exact one.
+ *
+ * Unlike `autocorr_result::tau()`, this does not depend on the batch size.
+ */
+template <typename Derived>
+double tau_rel_error(const Eigen::MatrixBase<Derived> &stderror, size_t n,
+                     const exact_moments &exact)
+{
+    Eigen::ArrayXd tau = 0.5 * (n * stderror.array().square() / exact.var.array() - 1);
+    return ((tau - exact.tau.array()) / exact.tau.array()).abs().maxCoeff();
+}
+
+/** Accumulator-specific construction and accuracy measure */
+template <typename Acc>
+struct bench_case;
+
+template <>
+struct bench_case< alea::mean_acc<double> >
+{
+    static const char *name() { return "mean_acc"; }
+    static bool has_batch_size() { return false; }
+    static bool has_granularity() { return false; }
+    static const char *metric() { return "mean_z"; }
+
+    static alea::mean_acc<double> make(size_t size, size_t, size_t)
+    {
+        return alea::mean_acc<double>(size);
+    }
+
+    static double error(const alea::mean_result<double> &res,
+                        const exact_moments &exact)
+    {
+        // deviation in units of the exact standard error
+        return ((res.mean() - exact.mean).array()
+                / exact.stderror(res.count()).array()).abs().maxCoeff();
+    }
+};
+
+template <>
+struct bench_case< alea::var_acc<double> >
+{
+    static const char *name() { return "var_acc"; }
+    static bool has_batch_size() { return true; }
+    static bool has_granularity() { return false; }
+    static const char *metric() { return "tau_rel"; }
+
+    static alea::var_acc<double> make(size_t size, size_t batch_size, size_t)
+    {
+        return alea::var_acc<double>(size, batch_size);
+    }
+
+    static double error(const alea::var_result<double> &res,
+                        const exact_moments &exact)
+    {
+        // underestimated unless the batches are much longer than tau
+        return tau_rel_error(res.stderror(), res.count(), exact);
+    }
+};
+
+template <>
+struct bench_case< alea::cov_acc<double> >
+{
+    static const char *name() { return "cov_acc"; }
+    static bool has_batch_size() { return true; }
+    static bool has_granularity() { return false; }
+    static const char *metric() { return "tau_rel"; }
+
+    static alea::cov_acc<double> make(size_t size, size_t batch_size, size_t)
+    {
+        return alea::cov_acc<double>(size, batch_size);
+    }
+
+    static double error(const alea::cov_result<double> &res,
+                        const exact_moments &exact)
+    {
+        return tau_rel_error(res.stderror(), res.count(), exact);
+    }
+};
+
+template <>
+struct bench_case< alea::autocorr_acc<double> >
+{
+    static const char *name() { return "autocorr_acc"; }
+    static bool has_batch_size() { return true; }
+    static bool has_granularity() { return true; }
+    static const char *metric() { return "tau_rel"; }
+
+    static alea::autocorr_acc<double> make(size_t size, size_t batch_size,
+                                           size_t granularity)
+    {
+        return alea::autocorr_acc<double>(size, batch_size, granularity);
+    }
+
+    static double error(const alea::autocorr_result<double> &res,
+                        const exact_moments &exact)
+    {
+        return tau_rel_error(res.stderror(), res.count(), exact);
+    }
+};
+
+template <>
+struct bench_case< alea::batch_acc<double> >
+{
+    static const char *name() { return "batch_acc"; }
+    static bool has_batch_size() { return true; }
+    static bool has_granularity() { return false; }
+    static const char *metric() { return "tau_rel"; }
+
+    static alea::batch_acc<double> make(size_t size, size_t batch_size, size_t)
+    {
+        return alea::batch_acc<double>(size, 256, batch_size);
+    }
+
+    static double error(const alea::batch_result<double> &res,
+                        const exact_moments &exact)
+    {
+        return tau_rel_error(res.stderror(), res.count(), exact);
+    }
+};
+
+template <typename Acc>
+void run_case(std::ostream &out, const Eigen::MatrixXd &series,
+              const exact_moments &exact, size_t batch_size, size_t granularity)
+{
+    typedef bench_case<Acc> bcase;
+    size_t size = series.rows(), nsamples = series.cols();
+    Acc acc = bcase::make(size, batch_size, granularity);
+
+    bench_clock::time_point start = bench_clock::now();
+    for (size_t t = 0; t != nsamples; ++t)
+        acc << series.col(t);
+    bench_clock::time_point mid = bench_clock::now();
+    typename alea::traits<Acc>::result_type res = acc.finalize();
+    bench_clock::time_point stop = bench_clock::now();
+
+    alea::buffer_serializer ser;
+    serialize(ser, "result", res);
+
+    double add_sec = std::chrono::duration<double>(mid - start).count();
+    double finalize_sec = std::chrono::duration<double>(stop - mid).count();
+    out << bcase::name()
+        << ',' << size
+        << ',' << (bcase::has_batch_size() ? batch_size : 0)
+        << ',' << (bcase::has_granularity() ? granularity : 0)
+        << ',' << nsamples
+        << ',' << nsamples / add_sec
+        << ',' << ser.size()
+        << ',' << double(ser.size()) / nsamples
+        << ',' << finalize_sec
+        << ',' << bcase::metric()
+        << ',' << bcase::error(res, exact)
+        << std::endl;
+}
+
+template <typename Acc>
+void sweep(std::ostream &out, const Eigen::MatrixXd &series,
+           const exact_moments &exact, const std::vector<size_t> &batch_sizes,
+           const std::vector<size_t> &granularities)
+{
+    typedef bench_case<Acc> bcase;
+    for (size_t batch_size : batch_sizes) {
+        for (size_t granularity : granularities) {
+            run_case<Acc>(out, series, exact, batch_size, granularity);
+            if (!bcase::has_granularity())
+                break;
+        }
+        if (!bcase::has_batch_size())
+            break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t nsamples = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    if (nsamples == 0) {
+        std::cerr << "Usage: " << argv[0] << " [nsamples]\n";
+        return 1;
+    }
+
+    const std::vector<size_t> sizes = {1, 8, 64};
+    const std::vector<size_t> batch_sizes = {1, 16, 256};
+    const std::vector<size_t> granularities = {2, 4, 8};
+
+    std::ostream &out = std::cout;
+    out.precision(6);
+    out << "accumulator,size,batch_size,granularity,nsamples,samples_per_sec,"
+        << "state_bytes,bytes_per_sample,finalize_sec,metric,error"
+        << std::endl;
+
+    for (size_t size : sizes) {
+        std::cerr << "Generating " << nsamples << " samples of size " << size
+                  << "...\n";
+        alea::util::var1_model<double> model = make_model(size);
+        exact_moments exact(model);
+        Eigen::MatrixXd series = make_series(model, nsamples);
+
+        sweep<alea::mean_acc<double> >(out, series, exact, batch_sizes, granularities);
+        sweep<alea::var_acc<double> >(out, series, exact, batch_sizes, granularities);
+        sweep<alea::cov_acc<double> >(out, series, exact, batch_sizes, granularities);
+        sweep<alea::autocorr_acc<double> >(out, series, exact, batch_sizes, granularities);
+        sweep<alea::batch_acc<double> >(out, series, exact, batch_sizes, granularities);
+    }
+    return 0;
+}
@@ -19,6 +19,7 @@
  *   | `mean_acc`     | `N`        | `k`        |  X   |     |     |     |
  *   | `var_acc`      | `N`        | `k`        |  X   |  X  |     |     |
  *   | `cov_acc`      | `N`        | `k`        |  X   |  X  |  X  |     |
+ *   | `blockcov_acc` | `N`        | `k m`      |  X   |  X  | (X) |     |
  *   | `autocorr_acc` | `a N`      | `k log(N)` |  X   |  X  |  X  |  X  |
  *   | `batch_acc`    | `a N`      | `k b`      |  X   |  X  |  X  | (X) |
  *
@@ -27,6 +28,7 @@
  *   - `N`: number of samples or calls to `operator<<`, i.e., final `count()`
  *   - `k`: components of the result vector, i.e., `size()`
  *   - `b`: number of batches, i.e., `num_batches()`
+ *   - `m`: average size of the covariance blocks
  *   - `a`: granularity factor (usually 2)
  *
  * and the following statistcal estimates:
@@ -125,11 +127,17 @@
 #include <alps/alea/mean.hpp>
 #include <alps/alea/variance.hpp>
 #include <alps/alea/covariance.hpp>
+#include <alps/alea/blockcov.hpp>
 #include <alps/alea/autocorr.hpp>
 #include <alps/alea/batch.hpp>
+#include <alps/alea/concurrent.hpp>
+
+// Time series analysis
+#include <alps/alea/acf.hpp>
 
 // Plugins
 #include <alps/alea/hdf5.hpp>
+#include <alps/alea/buffer.hpp>
 #ifdef ALPS_HAVE_MPI
     #include <alps/alea/mpi.hpp>
 #endif
@@ -140,6 +148,7 @@
 // Transforms
 #include <alps/alea/transform.hpp>
 #include <alps/alea/transformer.hpp>
+#include <alps/alea/dual.hpp>
 
 // Tests
 #include <alps/alea/testing.hpp>
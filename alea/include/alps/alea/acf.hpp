@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+#pragma once
+
+#include <alps/alea/core.hpp>
+#include <alps/alea/util.hpp>
+#include <alps/alea/batch.hpp>
+
+#include <vector>
+
+namespace alps { namespace alea {
+
+/**
+ * Lag-resolved normalized autocorrelation function of a time series.
+ *
+ * Given a time-ordered series with the components in the rows and the time
+ * steps in the columns, returns the matrix `C`, where `C(i,t)` is the
+ * normalized autocorrelation function of the `i`-th component at lag `t`:
+ *
+ *     C(i,t) = Gamma(i,t) / Gamma(i,0),
+ *     Gamma(i,t) = 1/N sum_s Re[ conj(x(i,s) - mean(i)) (x(i,s+t) - mean(i)) ]
+ *
+ * for `t = 0, ..., max_lag` (defaults to `N - 1`).  The `1/N` normalization
+ * biases `Gamma` at large lags, but ensures that the estimate is positive
+ * semi-definite.
+ *
+ * Each component is computed by zero-padded fast Fourier transform in
+ * `O(N log N)` time rather than `O(N max_lag)`.  The transforms are batched
+ * across components, as far as the work buffer stays moderately sized, and
+ * real components are packed pairwise into one complex transform.
+ *
+ * Note that `batch_data::batch()` is not such a series: it holds the sums
+ * over batches of unequal size, in the order of the slots rather than in time
+ * order.  Use the overload for `batch_result` instead.
+ *
+ * @see alps::alea::sokal_window, alps::alea::sokal_tau
+ */
+template <typename T>
+typename eigen<double>::matrix autocorr_function(
+                    const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> &series,
+                    size_t max_lag=0);
+
+/**
+ * Lag-resolved normalized autocorrelation function of the batch means.
+ *
+ * Puts the non-empty batches of `result` into time order by their offsets,
+ * divides each batch sum by its count, and returns the autocorrelation
+ * function of the resulting series of batch means.  The lag `t` is thus
+ * measured in batches, which is only meaningful if the batches are of
+ * (about) equal size.
+ */
+template <typename T>
+typename eigen<double>::matrix autocorr_function(const batch_result<T> &result,
+                                                 size_t max_lag=0);
+
+/**
+ * Determines summation window for the integrated autocorrelation time.
+ *
+ * Given the normalized autocorrelation function `acf` as returned by
+ * `autocorr_function()`, use Sokal's automatic windowing procedure: for
+ * each component, return the smallest window `M >= 1` such that
+ *
+ *     M >= c * tau_int(M),    tau_int(M) = 1/2 + sum_{t=1}^M C(t).
+ *
+ * If no such window exists, the largest available lag is returned, and the
+ * series is likely too short to estimate `tau` reliably.  `c` should be
+ * between 4 and 10 for exponentially decaying correlations.
+ */
+std::vector<size_t> sokal_window(const eigen<double>::matrix &acf, double c=5);
+
+/**
+ * Integrated autocorrelation time using Sokal's automatic windowing.
+ *
+ * Returns `sum_{t=1}^M C(t)` for each component, where `M` is the window
+ * determined by `sokal_window()`.  Note that this follows the convention of
+ * `autocorr_result::tau()`, i.e., vanishes for uncorrelated data.
+ */
+column<double> sokal_tau(const eigen<double>::matrix &acf, double c=5);
+
+}}
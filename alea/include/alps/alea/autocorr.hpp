@@ -94,7 +94,14 @@ public:
     /** Add computed vector to the accumulator */
     autocorr_acc& operator<<(const computed<T>& src){ add(src, 1); return *this; }
 
-    /** Merge partial result into accumulator */
+    /**
+     * Merge partial result into accumulator.
+     *
+     * The result is treated as an independent time series (e.g., a different
+     * Markov chain), which must have been accumulated with the same batch
+     * size and granularity.  Levels which are not present in the result are
+     * amended by the full series of the result as a single partial batch.
+     */
     autocorr_acc &operator<<(const autocorr_result<T> &result);
 
     /** Returns sample size, i.e., number of accumulated data points */
@@ -103,6 +110,24 @@ public:
     /** Returns result corresponding to current state of accumulator */
     autocorr_result<T> result() const;
 
+    /**
+     * Stores result corresponding to current state of accumulator in `result`.
+     *
+     * Re-uses the storage of the levels in `result` if they already have the
+     * correct size.  Only a scratch bundle of `size()` elements is allocated;
+     * use the overload taking `carry` for snapshots without any allocation.
+     */
+    void result_to(autocorr_result<T> &result) const;
+
+    /**
+     * Stores result corresponding to current state of accumulator in `result`.
+     *
+     * `carry` is scratch space, which is re-used if it has `size()` elements,
+     * such that periodic snapshots do not allocate memory unless a new level
+     * was added in the meantime.
+     */
+    void result_to(autocorr_result<T> &result, bundle<T> &carry) const;
+
     /** Frees data associated with accumulator and return result */
     autocorr_result<T> finalize();
 
@@ -136,6 +161,8 @@ struct traits< autocorr_acc<T> >
 
 extern template class autocorr_acc<double>;
 extern template class autocorr_acc<std::complex<double> >;
+extern template class autocorr_acc<float>;
+extern template class autocorr_acc<std::complex<float> >;
 
 
 /**
@@ -245,5 +272,7 @@ struct traits< autocorr_result<T> >
 
 extern template class autocorr_result<double>;
 extern template class autocorr_result<std::complex<double> >;
+extern template class autocorr_result<float>;
+extern template class autocorr_result<std::complex<float> >;
 
 }}
@@ -12,6 +12,7 @@
 #include <alps/alea/var_strategy.hpp>
 
 #include <memory>
+#include <vector>
 
 // Forward declarations
 
@@ -36,6 +37,10 @@ namespace alps { namespace alea {
 
 /**
  * Representation of a time series in (compact) batches.
+ *
+ * The batches are not stored in time order, since `batch_acc` re-uses the
+ * slots freed by merging (see `internal::galois_hopper`).  Instead, `offset()`
+ * keeps the position of the first data point of each batch in the series.
  */
 template <typename T>
 class batch_data
@@ -61,9 +66,15 @@ public:
     /** Returns sample size (number of accumulated points) for each batch */
     const typename eigen<uint64_t>::row &count() const { return count_; }
 
+    /** Returns start of each batch in the time series */
+    typename eigen<uint64_t>::row &offset() { return offset_; }
+
+    /** Returns start of each batch in the time series */
+    const typename eigen<uint64_t>::row &offset() const { return offset_; }
+
 private:
     typename eigen<T>::matrix batch_;
-    typename eigen<uint64_t>::row count_;
+    typename eigen<uint64_t>::row count_, offset_;
 };
 
 template <typename T>
@@ -74,6 +85,8 @@ struct traits< batch_data<T> >
 
 extern template class batch_data<double>;
 extern template class batch_data<std::complex<double> >;
+extern template class batch_data<float>;
+extern template class batch_data<std::complex<float> >;
 
 /**
  * Accumulator which keeps track of batches of (consecutive) measurements
@@ -115,7 +128,13 @@ public:
     /** Add computed vector to the accumulator */
     batch_acc& operator<<(const computed<T>& src){ add(src, 1); return *this; }
 
-    /** Merge partial result into accumulator */
+    /**
+     * Merge partial result into accumulator.
+     *
+     * The result is treated as an independent time series (e.g., a different
+     * Markov chain), which is appended to the accumulated series.  Its
+     * batches are merged as needed to preserve the number of batches.
+     */
     batch_acc &operator<<(const batch_result<T> &result);
 
     /** Returns sample size, i.e., total number of accumulated data points */
@@ -124,6 +143,13 @@ public:
     /** Returns result corresponding to current state of accumulator */
     batch_result<T> result() const;
 
+    /**
+     * Stores result corresponding to current state of accumulator in `result`.
+     *
+     * Re-uses the storage of `result` if it already has the same shape.
+     */
+    void result_to(batch_result<T> &result) const;
+
     /** Frees data associated with accumulator and return result */
     batch_result<T> finalize();
 
@@ -132,7 +158,7 @@ public:
 
     const internal::galois_hopper &cursor() const { return cursor_; }
 
-    const typename eigen<uint64_t>::row &offset() const { return offset_; }
+    const typename eigen<uint64_t>::row &offset() const { return store_->offset(); }
 
     size_t current_batch_size() const { return base_size_ * cursor_.factor(); }
 
@@ -147,7 +173,6 @@ private:
     size_t size_, num_batches_, base_size_;
     std::unique_ptr< batch_data<value_type> > store_;
     internal::galois_hopper cursor_;
-    typename eigen<uint64_t>::row offset_;
 };
 
 template <typename T>
@@ -162,6 +187,8 @@ struct traits< batch_acc<T> >
 
 extern template class batch_acc<double>;
 extern template class batch_acc<std::complex<double> >;
+extern template class batch_acc<float>;
+extern template class batch_acc<std::complex<float> >;
 
 
 /**
@@ -212,6 +239,19 @@ public:
     template <typename Strategy=circular_var>
     column<typename bind<Strategy,T>::var_type> var() const;
 
+    /**
+     * Returns coarser batchings of the result, one for each entry in
+     * `num_batches`, for checking the stability of the error estimate.
+     *
+     * The batches are visited in time order, and each is merged into the
+     * coarse batch containing its midpoint, such that the coarse batches are
+     * again compact in time.  All batchings are built in a single pass over
+     * the batches, split across `nthreads` threads by component (by default,
+     * depending on the size and the hardware).
+     */
+    std::vector<batch_result> rebatch(const std::vector<size_t> &num_batches,
+                                      size_t nthreads=0) const;
+
     /** Returns bias-corrected sample covariance matrix for given strategy */
     template <typename Strategy=circular_var>
     typename eigen<typename bind<Strategy,T>::cov_type>::matrix cov() const;
@@ -277,5 +317,7 @@ struct traits< batch_result<T> >
 
 extern template class batch_result<double>;
 extern template class batch_result<std::complex<double> >;
+extern template class batch_result<float>;
+extern template class batch_result<std::complex<float> >;
 
 }} /* namespace alps::alea */
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+#pragma once
+
+#include <alps/alea/core.hpp>
+#include <alps/alea/util.hpp>
+#include <alps/alea/bundle.hpp>
+#include <alps/alea/complex_op.hpp>
+#include <alps/alea/computed.hpp>
+#include <alps/alea/var_strategy.hpp>
+
+#include <memory>
+#include <vector>
+
+// Forward declarations
+
+namespace alps { namespace alea {
+    template <typename T, typename Str> class blockcov_data;
+    template <typename T, typename Str> class blockcov_acc;
+    template <typename T, typename Str> class blockcov_result;
+
+    template <typename T, typename Str>
+    void serialize(serializer &, const std::string &, const blockcov_result<T,Str> &);
+
+    template <typename T, typename Str>
+    void deserialize(deserializer &, const std::string &, blockcov_result<T,Str> &);
+
+    template <typename T, typename Str>
+    std::ostream &operator<<(std::ostream &, const blockcov_result<T,Str> &);
+}}
+
+// Actual declarations
+
+namespace alps { namespace alea {
+
+/**
+ * Returns block sizes partitioning `size` components into blocks of equal
+ * size `block_size` (except for a possibly smaller last block).
+ */
+std::vector<size_t> uniform_blocks(size_t size, size_t block_size);
+
+/**
+ * Data for block-diagonal covariance accumulation.
+ *
+ * As with `cov_data`, this class either represents the sum of X[i] and the
+ * sum of X[i]*X[j] (sum state) or the sample mean and sample covariance of X
+ * (mean state).  However, only the covariance within each of a set of
+ * contiguous blocks of components is kept.
+ */
+template <typename T, typename Strategy=circular_var>
+class blockcov_data
+{
+public:
+    typedef typename bind<Strategy, T>::value_type value_type;
+    typedef typename bind<Strategy, T>::cov_type cov_type;
+    typedef typename eigen<cov_type>::matrix cov_matrix_type;
+
+public:
+    blockcov_data(const std::vector<size_t> &block_sizes);
+
+    /** Re-allocate and thus clear all accumulated data */
+    void reset();
+
+    /** Number of components of the random vector (e.g., size of mean) */
+    size_t size() const { return data_.rows(); }
+
+    /** Number of diagonal blocks of the covariance matrix */
+    size_t nblocks() const { return data2_.size(); }
+
+    /** Index of the first component in the `i`-th block */
+    size_t block_offset(size_t i) const { return offset_[i]; }
+
+    /** Number of components in the `i`-th block */
+    size_t block_size(size_t i) const { return data2_[i].rows(); }
+
+    /** Returns the size of each block */
+    std::vector<size_t> block_sizes() const;
+
+    /** Returns sample size, i.e., number of accumulated data points */
+    uint64_t count() const { return count_; }
+
+    /** Returns sample size, i.e., number of accumulated data points */
+    uint64_t &count() { return count_; }
+
+    /** Returns sum of squared weights */
+    double count2() const { return count2_; }
+
+    /** Returns sum of squared weights */
+    double &count2() { return count2_; }
+
+    const column<value_type> &data() const { return data_; }
+
+    column<value_type> &data() { return data_; }
+
+    const cov_matrix_type &data2(size_t i) const { return data2_[i]; }
+
+    cov_matrix_type &data2(size_t i) { return data2_[i]; }
+
+    void convert_to_mean();
+
+    void convert_to_sum();
+
+private:
+    column<T> data_;
+    std::vector<cov_matrix_type> data2_;
+    std::vector<size_t> offset_;
+    uint64_t count_;
+    double count2_;
+};
+
+template <typename T, typename Strategy>
+struct traits< blockcov_data<T,Strategy> >
+{
+    typedef Strategy strategy_type;
+    typedef typename bind<Strategy, T>::value_type value_type;
+    typedef typename bind<Strategy, T>::var_type var_type;
+    typedef typename bind<Strategy, T>::cov_type cov_type;
+};
+
+extern template class blockcov_data<double>;
+extern template class blockcov_data<std::complex<double>, circular_var>;
+extern template class blockcov_data<std::complex<double>, elliptic_var>;
+extern template class blockcov_data<float>;
+extern template class blockcov_data<std::complex<float>, circular_var>;
+extern template class blockcov_data<std::complex<float>, elliptic_var>;
+
+
+/**
+ * Accumulator which tracks the mean and a block-diagonal covariance estimate.
+ *
+ * For very large random vectors, the full covariance matrix is prohibitively
+ * expensive both in memory and runtime.  This accumulator only keeps the
+ * covariance within user-declared contiguous blocks (e.g., per orbital), such
+ * that memory and runtime scale as the sum of squared block sizes rather than
+ * `size * size`.  Mean and variance are available for all components.
+ *
+ * @see alps::alea::cov_acc, alps::alea::uniform_blocks
+ */
+template <typename T, typename Strategy=circular_var>
+class blockcov_acc
+{
+public:
+    using value_type = T;
+    using var_type = typename bind<Strategy, T>::var_type;
+    using cov_type =  typename bind<Strategy, T>::cov_type;
+    using cov_matrix_type = typename eigen<cov_type>::matrix;
+
+public:
+    /** Construct accumulator with a single block (full covariance) */
+    blockcov_acc(size_t size=1, uint64_t batch_size=1);
+
+    /** Construct accumulator with given block sizes */
+    blockcov_acc(const std::vector<size_t> &block_sizes, uint64_t batch_size=1);
+
+    blockcov_acc(const blockcov_acc &other);
+
+    blockcov_acc &operator=(const blockcov_acc &other);
+
+    /** Re-allocate and thus clear all accumulated data */
+    void reset();
+
+    /** Update the size to a single block and discard all measurements, if any */
+    void set_size(size_t size) { set_blocks(std::vector<size_t>(1, size)); }
+
+    /** Update the blocks and discard all measurements, if any */
+    void set_blocks(const std::vector<size_t> &block_sizes);
+
+    /** Update the batch size and discard current batch */
+    void set_batch_size(uint64_t batch_size);
+
+    /** Returns `false` if `finalize()` has been called, `true` otherwise */
+    bool valid() const { return (bool)store_; }
+
+    /** Number of components of the random vector (e.g., size of mean) */
+    size_t size() const { return current_.size(); }
+
+    /** Number of diagonal blocks of the covariance matrix */
+    size_t nblocks() const { return block_sizes_.size(); }
+
+    /** Returns number of data points per batch */
+    uint64_t batch_size() const { return current_.target(); }
+
+    /** Add computed vector to the accumulator */
+    blockcov_acc& operator<<(const computed<T>& src){ add(src, 1); return *this; }
+
+    /** Merge partial result into accumulator */
+    blockcov_acc &operator<<(const blockcov_result<T,Strategy> &result);
+
+    /** Returns sample size, i.e., number of accumulated data points */
+    uint64_t count() const { return store_->count(); }
+
+    /** Returns result corresponding to current state of accumulator */
+    blockcov_result<T,Strategy> result() const;
+
+    /**
+     * Stores result corresponding to current state of accumulator in `result`.
+     *
+     * Re-uses the storage of `result` if it already has the same blocks.
+     */
+    void result_to(blockcov_result<T,Strategy> &result) const;
+
+    /** Frees data associated with accumulator and return result */
+    blockcov_result<T,Strategy> finalize();
+
+    const bundle<value_type> &current() const { return current_; }
+
+    /** Return backend object used for storing estimands */
+    const blockcov_data<T,Strategy> &store() const { return *store_; }
+
+protected:
+    void add(const computed<T> &source, uint64_t count);
+
+    void add_bundle();
+
+    void finalize_to(blockcov_result<T,Strategy> &result);
+
+private:
+    std::vector<size_t> block_sizes_;
+    std::unique_ptr<blockcov_data<T,Strategy> > store_;
+    bundle<value_type> current_;
+};
+
+template <typename T, typename Strategy>
+struct traits< blockcov_acc<T,Strategy> >
+{
+    typedef Strategy strategy_type;
+    typedef typename bind<Strategy, T>::value_type value_type;
+    typedef typename bind<Strategy, T>::var_type var_type;
+    typedef typename bind<Strategy, T>::cov_type cov_type;
+    typedef blockcov_result<T,Strategy> result_type;
+    typedef blockcov_data<T, Strategy> store_type;
+};
+
+extern template class blockcov_acc<double>;
+extern template class blockcov_acc<std::complex<double>, circular_var>;
+extern template class blockcov_acc<std::complex<double>, elliptic_var>;
+extern template class blockcov_acc<float>;
+extern template class blockcov_acc<std::complex<float>, circular_var>;
+extern template class blockcov_acc<std::complex<float>, elliptic_var>;
+
+
+/**
+ * Result which tracks the mean and a block-diagonal covariance estimate.
+ *
+ * @see alps::alea::blockcov_acc
+ */
+template <typename T, typename Strategy=circular_var>
+class blockcov_result
+{
+public:
+    typedef typename bind<Strategy, T>::value_type value_type;
+    typedef typename bind<Strategy, T>::var_type var_type;
+    typedef typename bind<Strategy, T>::cov_type cov_type;
+    typedef typename eigen<cov_type>::matrix cov_matrix_type;
+
+public:
+    blockcov_result() { }
+
+    blockcov_result(const blockcov_data<T,Strategy> &acc_data)
+        : store_(new blockcov_data<T,Strategy>(acc_data))
+    { }
+
+    blockcov_result(const blockcov_result &other);
+
+    blockcov_result &operator=(const blockcov_result &other);
+
+    /** Returns `false` if `finalize()` has been called, `true` otherwise */
+    bool valid() const { return (bool)store_; }
+
+    /** Number of components of the random vector (e.g., size of mean) */
+    size_t size() const { return store_->size(); }
+
+    /** Number of diagonal blocks of the covariance matrix */
+    size_t nblocks() const { return store_->nblocks(); }
+
+    /** Returns sample size, i.e., number of accumulated data points */
+    uint64_t count() const { return store_->count(); }
+
+    /** Returns sum of squared sample sizes */
+    double count2() const { return store_->count2(); }
+
+    /** Returns average batch size */
+    double batch_size() const { return store_->count2() / store_->count(); }
+
+    /** Returns effective number of observations */
+    double observations() const { return count() / batch_size(); }
+
+    /** Returns sample mean */
+    const column<T> &mean() const { return store_->data(); }
+
+    /** Returns bias-corrected sample variance */
+    column<var_type> var() const;
+
+    /** Returns bias-corrected sample covariance matrix of the `i`-th block */
+    const cov_matrix_type &block_cov(size_t i) const { return store_->data2(i); }
+
+    /** Returns bias-corrected sample covariance matrix (zero outside blocks) */
+    cov_matrix_type cov() const;
+
+    /** Returns bias-corrected standard error of the mean */
+    column<var_type> stderror() const;
+
+    /** Return backend object used for storing estimands */
+    const blockcov_data<T,Strategy> &store() const { return *store_; }
+
+    /** Return backend object used for storing estimands */
+    blockcov_data<T,Strategy> &store() { return *store_; }
+
+    /** Collect measurements from different instances using sum-reducer */
+    void reduce(const reducer &r) { reduce(r, true, true); }
+
+    /** Convert result to a permanent format (write to disk etc.) */
+    friend void serialize<>(serializer &, const std::string &, const blockcov_result &);
+
+    /** Convert result from a permanent format (write to disk etc.) */
+    friend void deserialize<>(deserializer &, const std::string &, blockcov_result &);
+
+    /** Write some info about the result to a stream */
+    friend std::ostream &operator<< <>(std::ostream &, const blockcov_result &);
+
+protected:
+    void reduce(const reducer &, bool do_pre_commit, bool do_post_commit);
+
+private:
+    std::unique_ptr<blockcov_data<T,Strategy> > store_;
+
+    friend class blockcov_acc<T,Strategy>;
+};
+
+/** Check if two results are identical */
+template <typename T, typename Strategy>
+bool operator==(const blockcov_result<T, Strategy> &r1,
+                const blockcov_result<T, Strategy> &r2);
+template <typename T, typename Strategy>
+bool operator!=(const blockcov_result<T, Strategy> &r1,
+                const blockcov_result<T, Strategy> &r2)
+{
+    return !operator==(r1, r2);
+}
+
+template<typename T> struct is_alea_acc<blockcov_acc<T, circular_var>> :
+    std::true_type {};
+template<typename T> struct is_alea_acc<blockcov_acc<T, elliptic_var>> :
+    std::true_type {};
+template<typename T> struct is_alea_result<blockcov_result<T, circular_var>> :
+    std::true_type {};
+template<typename T> struct is_alea_result<blockcov_result<T, elliptic_var>> :
+    std::true_type {};
+
+template <typename T, typename Strategy>
+struct traits< blockcov_result<T,Strategy> >
+{
+    typedef Strategy strategy_type;
+    typedef typename bind<Strategy, T>::value_type value_type;
+    typedef typename bind<Strategy, T>::var_type var_type;
+    typedef typename bind<Strategy, T>::cov_type cov_type;
+
+    // the full covariance matrix is not available (only its diagonal blocks)
+    const static bool HAVE_MEAN  = true;
+    const static bool HAVE_VAR   = true;
+    const static bool HAVE_COV   = false;
+    const static bool HAVE_TAU   = false;
+    const static bool HAVE_BATCH = false;
+};
+
+extern template class blockcov_result<double>;
+extern template class blockcov_result<std::complex<double>, circular_var>;
+extern template class blockcov_result<std::complex<double>, elliptic_var>;
+extern template class blockcov_result<float>;
+extern template class blockcov_result<std::complex<float>, circular_var>;
+extern template class blockcov_result<std::complex<float>, elliptic_var>;
+
+}} /* namespace alps::alea */
@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+#include <alps/alea/core.hpp>
+
+namespace alps { namespace alea {
+
+namespace internal {
+
+/** Type tags for the primitives stored in a serialization buffer */
+template <typename T> struct buffer_tag;
+
+template <> struct buffer_tag<double> { static const uint32_t value = 1; };
+template <> struct buffer_tag<std::complex<double>> { static const uint32_t value = 2; };
+template <> struct buffer_tag<int64_t> { static const uint32_t value = 3; };
+template <> struct buffer_tag<uint64_t> { static const uint32_t value = 4; };
+template <> struct buffer_tag<int32_t> { static const uint32_t value = 5; };
+template <> struct buffer_tag<uint32_t> { static const uint32_t value = 6; };
+
+/**
+ * Header preceding each primitive in a serialization buffer.
+ *
+ * The header is followed by `ndim` extents (as `uint64_t`) and the key, padded
+ * to `BUFFER_ALIGNMENT`, and then the payload of `nbytes` bytes, again padded.
+ */
+struct buffer_record
+{
+    uint32_t tag;
+    uint32_t ndim;
+    uint64_t key_size;
+    uint64_t nbytes;
+};
+
+/** Alignment of the payloads within a serialization buffer */
+const static size_t BUFFER_ALIGNMENT = 16;
+
+/** Magic number at the start of a serialization buffer */
+const static uint64_t BUFFER_MAGIC = 0x3146554241454c41ULL;  // "ALEABUF1"
+
+inline size_t buffer_pad(size_t size)
+{
+    return (size + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT;
+}
+
+/** Build full path from group stack and key, as in the HDF5 backend */
+inline std::string buffer_path(const std::vector<std::string> &groups,
+                               const std::string &key)
+{
+    if (key.find('/') != std::string::npos)
+        throw std::runtime_error("Key must not contain '/'");
+
+    std::ostringstream maker;
+    for (const std::string &group : groups)
+        maker << group << '/';
+    maker << key;
+    return maker.str();
+}
+
+}
+
+/**
+ * Serializer writing to a single contiguous memory buffer.
+ *
+ * Each primitive is stored as a compact header (type, shape and full key)
+ * followed by its payload, which is copied verbatim using `memcpy`.  The
+ * payloads are aligned to `internal::BUFFER_ALIGNMENT` bytes relative to the
+ * start of the buffer.  The resulting buffer can be sent over MPI, put into
+ * shared memory, or written to disk as is, and read back using a
+ * `buffer_deserializer`.
+ *
+ * The buffer uses the native byte order and is thus not portable between
+ * architectures with different endianness.
+ *
+ *     alps::alea::buffer_serializer ser;
+ *     serialize(ser, "result", res);
+ *     MPI_Send(ser.data(), ser.size(), MPI_BYTE, ...);
+ *
+ * @see buffer_deserializer
+ */
+class buffer_serializer
+    : public serializer
+{
+public:
+    buffer_serializer(size_t capacity=4096)
+        : buffer_()
+        , group_()
+    {
+        buffer_.reserve(capacity);
+        grow(sizeof(internal::BUFFER_MAGIC));
+        std::memcpy(buffer_.data(), &internal::BUFFER_MAGIC,
+                    sizeof(internal::BUFFER_MAGIC));
+        grow(internal::buffer_pad(buffer_.size()) - buffer_.size());
+    }
+
+    // Common methods
+
+    void enter(const std::string &group) override { group_.push_back(group); }
+
+    void exit() override
+    {
+        if (group_.empty())
+            throw std::runtime_error("exit without enter");
+        group_.pop_back();
+    }
+
+    // Serialization methods
+
+    void write(const std::string &key, ndview<const double> value) override {
+        do_write(key, value);
+    }
+
+    void write(const std::string &key, ndview<const std::complex<double>> value) override {
+        do_write(key, value);
+    }
+
+    void write(const std::string &key, ndview<const int64_t> value) override {
+        do_write(key, value);
+    }
+
+    void write(const std::string &key, ndview<const uint64_t> value) override {
+        do_write(key, value);
+    }
+
+    void write(const std::string &key, ndview<const int32_t> value) override {
+        do_write(key, value);
+    }
+
+    void write(const std::string &key, ndview<const uint32_t> value) override {
+        do_write(key, value);
+    }
+
+    buffer_serializer *clone() override { return new buffer_serializer(*this); }
+
+    /** Returns pointer to the start of the serialized data */
+    const char *data() const { return buffer_.data(); }
+
+    /** Returns size of the serialized data in bytes */
+    size_t size() const { return buffer_.size(); }
+
+    /** Returns underlying buffer */
+    const std::vector<char> &buffer() const { return buffer_; }
+
+    /** Discards all data written so far, but retains the capacity */
+    void clear()
+    {
+        buffer_.resize(internal::buffer_pad(sizeof(internal::BUFFER_MAGIC)));
+        group_.clear();
+    }
+
+protected:
+    template <typename T>
+    void do_write(const std::string &key, ndview<const T> value)
+    {
+        std::string path = internal::buffer_path(group_, key);
+
+        internal::buffer_record record;
+        record.tag = internal::buffer_tag<T>::value;
+        record.ndim = value.ndim();
+        record.key_size = path.size();
+        record.nbytes = value.size() * sizeof(T);
+
+        size_t head_size = sizeof(record) + record.ndim * sizeof(uint64_t)
+                           + record.key_size;
+        size_t head_pos = buffer_.size();
+        size_t data_pos = head_pos + internal::buffer_pad(head_size);
+        grow(data_pos - head_pos + internal::buffer_pad(record.nbytes));
+
+        char *head = buffer_.data() + head_pos;
+        std::memcpy(head, &record, sizeof(record));
+        head += sizeof(record);
+        for (size_t i = 0; i != record.ndim; ++i, head += sizeof(uint64_t)) {
+            uint64_t extent = value.shape()[i];
+            std::memcpy(head, &extent, sizeof(uint64_t));
+        }
+        std::memcpy(head, path.data(), path.size());
+
+        if (record.nbytes != 0)
+            std::memcpy(buffer_.data() + data_pos, value.data(), record.nbytes);
+    }
+
+    void grow(size_t nbytes)
+    {
+        // amortized growth, new space (including padding) is zeroed
+        if (buffer_.size() + nbytes > buffer_.capacity())
+            buffer_.reserve(std::max(2 * buffer_.capacity(), buffer_.size() + nbytes));
+        buffer_.resize(buffer_.size() + nbytes, 0);
+    }
+
+private:
+    std::vector<char> buffer_;
+    std::vector<std::string> group_;
+};
+
+/**
+ * Deserializer reading from a contiguous memory buffer.
+ *
+ * Takes a buffer written by `buffer_serializer` without copying it, and
+ * indexes the primitives therein once on construction.  The buffer must thus
+ * outlive the deserializer.  Apart from the usual `read()` methods, which
+ * `memcpy` the payload, the `view()` method gives direct access to it.
+ *
+ * @see buffer_serializer
+ */
+class buffer_deserializer
+    : public deserializer
+{
+public:
+    buffer_deserializer(const char *data, size_t size)
+        : data_(data)
+        , size_(size)
+        , index_()
+        , group_()
+    {
+        build_index();
+    }
+
+    buffer_deserializer(const std::vector<char> &buffer)
+        : buffer_deserializer(buffer.data(), buffer.size())
+    { }
+
+    // Common methods
+
+    void enter(const std::string &group) override { group_.push_back(group); }
+
+    void exit() override
+    {
+        if (group_.empty())
+            throw std::runtime_error("exit without enter");
+        group_.pop_back();
+    }
+
+    // Deserialization methods
+
+    std::vector<size_t> get_shape(const std::string &key) override
+    {
+        const entry &item = find(internal::buffer_path(group_, key));
+        return std::vector<size_t>(item.shape.begin(), item.shape.end());
+    }
+
+    void read(const std::string &key, ndview<double> value) override {
+        do_read(key, value);
+    }
+
+    void read(const std::string &key, ndview<std::complex<double>> value) override {
+        do_read(key, value);
+    }
+
+    void read(const std::string &key, ndview<int64_t> value) override {
+        do_read(key, value);
+    }
+
+    void read(const std::string &key, ndview<uint64_t> value) override {
+        do_read(key, value);
+    }
+
+    void read(const std::string &key, ndview<int32_t> value) override {
+        do_read(key, value);
+    }
+
+    void read(const std::string &key, ndview<uint32_t> value) override {
+        do_read(key, value);
+    }
+
+    buffer_deserializer *clone() override { return new buffer_deserializer(*this); }
+
+    /**
+     * Returns view of a primitive directly within the buffer.
+     *
+     * Requires the buffer itself to be aligned to `alignof(T)`.
+     */
+    template <typename T>
+    ndview<const T> view(const std::string &key) const
+    {
+        const entry &item = find(internal::buffer_path(group_, key));
+        if (item.tag != internal::buffer_tag<T>::value)
+            throw std::runtime_error("Type mismatch for key in buffer");
+        if (reinterpret_cast<uintptr_t>(item.data) % alignof(T) != 0)
+            throw std::runtime_error("Buffer is not properly aligned");
+
+        return ndview<const T>(reinterpret_cast<const T *>(item.data),
+                               item.shape.data(), item.shape.size());
+    }
+
+protected:
+    struct entry
+    {
+        uint32_t tag;
+        std::vector<size_t> shape;
+        const char *data;
+        size_t nbytes;
+    };
+
+    template <typename T>
+    void do_read(const std::string &key, ndview<T> value)
+    {
+        const entry &item = find(internal::buffer_path(group_, key));
+        if (item.tag != internal::buffer_tag<T>::value)
+            throw std::runtime_error("Type mismatch for key in buffer");
+
+        // check shape (this is cheap compared to reading)
+        if (value.ndim() != item.shape.size())
+            throw size_mismatch();
+        for (size_t i = 0; i != item.shape.size(); ++i)
+            if (item.shape[i] != value.shape()[i])
+                throw size_mismatch();
+
+        // discard the data
+        if (value.data() == nullptr)
+            return;
+
+        std::memcpy(value.data(), item.data, item.nbytes);
+    }
+
+    const entry &find(const std::string &path) const
+    {
+        auto it = index_.find(path);
+        if (it == index_.end())
+            throw std::runtime_error("Key not found in buffer: " + path);
+        return it->second;
+    }
+
+    void build_index()
+    {
+        uint64_t magic;
+        if (size_ < sizeof(magic))
+            throw std::runtime_error("Buffer too small");
+        std::memcpy(&magic, data_, sizeof(magic));
+        if (magic != internal::BUFFER_MAGIC)
+            throw std::runtime_error("Not a serialization buffer");
+
+        size_t pos = internal::buffer_pad(sizeof(magic));
+        while (pos < size_) {
+            internal::buffer_record record;
+            if (pos + sizeof(record) > size_)
+                throw std::runtime_error("Truncated serialization buffer");
+            std::memcpy(&record, data_ + pos, sizeof(record));
+
+            size_t head_size = sizeof(record) + record.ndim * sizeof(uint64_t)
+                               + record.key_size;
+            size_t data_pos = pos + internal::buffer_pad(head_size);
+            if (data_pos + record.nbytes > size_)
+                throw std::runtime_error("Truncated serialization buffer");
+
+            entry item;
+            item.tag = record.tag;
+            item.shape.resize(record.ndim);
+            const char *head = data_ + pos + sizeof(record);
+            for (size_t i = 0; i != record.ndim; ++i, head += sizeof(uint64_t)) {
+                uint64_t extent;
+                std::memcpy(&extent, head, sizeof(uint64_t));
+                item.shape[i] = extent;
+            }
+            item.data = data_ + data_pos;
+            item.nbytes = record.nbytes;
+
+            index_[std::string(head, record.key_size)] = item;
+            pos = data_pos + internal::buffer_pad(record.nbytes);
+        }
+    }
+
+private:
+    const char *data_;
+    size_t size_;
+    std::unordered_map<std::string, entry> index_;
+    std::vector<std::string> group_;
+};
+
+}}
@@ -75,42 +75,46 @@ public:
     /** Construct new operation */
     complex_op(T rere, T reim, T imre, T imim)
     {
-        vals_[0][0] = rere;
-        vals_[0][1] = reim;
-        vals_[1][0] = imre;
-        vals_[1][1] = imim;
+        vals_[0] = rere;
+        vals_[1] = reim;
+        vals_[2] = imre;
+        vals_[3] = imim;
     }
 
-    T &rere() { return vals_[0][0]; }
-    T &reim() { return vals_[0][1]; }
-    T &imre() { return vals_[1][0]; }
-    T &imim() { return vals_[1][1]; }
+    /** Convert operation of different precision */
+    template <typename U>
+    explicit complex_op(const complex_op<U> &other)
+        : complex_op(other.rere(), other.reim(), other.imre(), other.imim())
+    { }
 
-    const T &rere() const { return vals_[0][0]; }
-    const T &reim() const { return vals_[0][1]; }
-    const T &imre() const { return vals_[1][0]; }
-    const T &imim() const { return vals_[1][1]; }
+    T &rere() { return vals_[0]; }
+    T &reim() { return vals_[1]; }
+    T &imre() { return vals_[2]; }
+    T &imim() { return vals_[3]; }
+
+    const T &rere() const { return vals_[0]; }
+    const T &reim() const { return vals_[1]; }
+    const T &imre() const { return vals_[2]; }
+    const T &imim() const { return vals_[3]; }
 
     complex_op &operator+=(complex_op x)
     {
-        std::transform(&vals_[0][0], &vals_[2][0], &x.vals_[0][0],
-                       &vals_[0][0], std::plus<T>());
+        std::transform(vals_, vals_ + 4, x.vals_, vals_, std::plus<T>());
         return *this;
     }
 
     complex_op &operator-=(complex_op x)
     {
-        std::transform(&vals_[0][0], &vals_[2][0], &x.vals_[0][0],
-                       &vals_[0][0], std::minus<T>());
+        std::transform(vals_, vals_ + 4, x.vals_, vals_, std::minus<T>());
         return *this;
     }
 
     complex_op &operator*=(double x)
     {
-        vals_[0][0] *= x;
-        vals_[0][1] *= x;
-        vals_[1][0] *= x;
-        vals_[1][1] *= x;
+        vals_[0] *= x;
+        vals_[1] *= x;
+        vals_[2] *= x;
+        vals_[3] *= x;
         return *this;
     }
 
@@ -159,12 +163,12 @@ public:
 
     friend bool operator==(complex_op l, complex_op r)
     {
-        return std::equal(&l.vals_[0][0], &l.vals_[2][0], &r.vals_[0][0]);
+        return std::equal(l.vals_, l.vals_ + 4, r.vals_);
     }
 
     friend bool operator!=(complex_op l, complex_op r)
     {
-        return !std::equal(&l.vals_[0][0], &l.vals_[2][0], &r.vals_[0][0]);
+        return !std::equal(l.vals_, l.vals_ + 4, r.vals_);
     }
 
     friend complex_op inv(complex_op x)
@@ -203,12 +207,12 @@ public:
 
     friend bool isnan(complex_op x)
     {
-        return std::any_of(&x.vals_[0][0], &x.vals_[2][0], [](T y) {return std::isnan(y); });
+        return std::any_of(x.vals_, x.vals_ + 4, [](T y) {return std::isnan(y); });
     }
 
     friend bool isfinite(complex_op x)
     {
-        return std::all_of(&x.vals_[0][0], &x.vals_[2][0], [](T y) {return std::isfinite(y); });
+        return std::all_of(x.vals_, x.vals_ + 4, [](T y) {return std::isfinite(y); });
     }
 
     friend bool isinf(complex_op x)
@@ -218,7 +222,7 @@ public:
         if (isnan(x))
             return false;
 
-        return std::any_of(&x.vals_[0][0], &x.vals_[2][0], [](T y) {return std::isinf(y); });
+        return std::any_of(x.vals_, x.vals_ + 4, [](T y) {return std::isinf(y); });
     }
 
     friend complex_op abs(complex_op x) { return sqrt(abs2(x)); }
@@ -232,7 +236,8 @@ public:
 
 
 private:
-    T vals_[2][2];
+    // rere, reim, imre, imim
+    T vals_[4];
 };
 
 }} /* namespace alps::alea */
@@ -24,6 +24,7 @@ namespace alps { namespace alea {
     template <typename T> class vector_adapter;
     template <typename T, size_t N> class array_adapter;
     template <typename T, typename Derived> class eigen_adapter;
+    template <typename T> class sparse_adapter;
 }}
 
 // Actual declarations
@@ -48,6 +49,14 @@ array_adapter<T,N> make_array_adapter(const std::array<T, N> &a){
   return array_adapter<T,N>(a);
 }
 
+template <typename T>
+sparse_adapter<T> make_sparse_adapter(size_t size,
+                                      const std::vector<size_t> &indices,
+                                      const std::vector<T> &values)
+{
+    return sparse_adapter<T>(size, indices, values);
+}
+
 template <typename T>
 class value_adapter
     : public computed<T>
@@ -171,6 +180,43 @@ private:
     const Eigen::DenseBase<Derived> &in_;
 };
 
+/**
+ * Sparse vector of given `size`, where only the elements at `indices` are set.
+ */
+template <typename T>
+class sparse_adapter
+    : public sparse_computed<T>
+{
+public:
+    typedef T value_type;
+
+public:
+    sparse_adapter(size_t size, const std::vector<size_t> &indices,
+                   const std::vector<T> &values)
+        : size_(size)
+        , indices_(indices)
+        , values_(values)
+    {
+        if (indices.size() != values.size())
+            throw size_mismatch();
+    }
+
+    size_t size() const { return size_; }
+
+    size_t nnz() const { return indices_.size(); }
+
+    const size_t *indices() const { return indices_.data(); }
+
+    const T *values() const { return values_.data(); }
+
+    ~sparse_adapter() { }
+
+private:
+    size_t size_;
+    const std::vector<size_t> &indices_;
+    const std::vector<T> &values_;
+};
+
 /**
  * Proxy object for computed results.
  */
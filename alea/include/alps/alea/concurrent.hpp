@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+#pragma once
+
+#include <alps/alea/core.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace alps { namespace alea {
+
+/**
+ * Accumulator fed by multiple producers (e.g., threads) concurrently.
+ *
+ * Rather than serializing the producers on a single accumulator, each
+ * producer is given a private copy of the accumulator, which it fills without
+ * any synchronization:
+ *
+ *     alps::alea::concurrent_acc<var_acc<double> > acc(nthreads, var_acc<double>(2));
+ *     #pragma omp parallel
+ *     {
+ *         var_acc<double> &my_acc = acc.producer(omp_get_thread_num());
+ *         for (...)
+ *             my_acc << measurement;
+ *     }
+ *     var_result<double> res = acc.result();
+ *
+ * The partial accumulators are merged in the order of the producers when
+ * `result()` is called.  The result thus only depends on which data was fed
+ * to which producer, not on how the producers were interleaved in time.
+ * Merging requires the producers to be quiescent, i.e., `result()` must not
+ * race with additions to the partial accumulators.
+ *
+ * The partial accumulators are allocated on separate cache lines to avoid
+ * false sharing of their counters between producers.  Buffers which the
+ * accumulators allocate themselves, such as the sums of their bundles, are
+ * ordinary heap allocations and are not isolated in this way.
+ */
+template <typename Acc>
+class concurrent_acc
+{
+public:
+    typedef Acc acc_type;
+    typedef typename traits<Acc>::value_type value_type;
+    typedef typename traits<Acc>::result_type result_type;
+
+    /** Size of a cache line in bytes (conservative estimate) */
+    static const size_t CACHE_LINE = 64;
+
+public:
+    /** Construct with `nproducers` copies of the (empty) accumulator `proto` */
+    concurrent_acc(size_t nproducers=1, const Acc &proto=Acc())
+        : proto_(proto)
+        , slot_()
+    {
+        for (size_t i = 0; i != nproducers; ++i)
+            slot_.emplace_back(new slot(proto_));
+    }
+
+    /** Number of producers */
+    size_t nproducers() const { return slot_.size(); }
+
+    /** Number of components of the random vector (e.g., size of mean) */
+    size_t size() const { return proto_.size(); }
+
+    /**
+     * Returns the private accumulator of the `i`-th producer.
+     *
+     * Each partial accumulator must only be accessed by one producer at a
+     * time, but different producers may access their accumulators concurrently.
+     */
+    Acc &producer(size_t i) { return slot_[i]->acc; }
+
+    const Acc &producer(size_t i) const { return slot_[i]->acc; }
+
+    /** Returns sample size summed over all producers */
+    uint64_t count() const
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i != nproducers(); ++i)
+            total += slot_[i]->acc.count();
+        return total;
+    }
+
+    /** Re-allocate and thus clear all partial accumulators */
+    void reset()
+    {
+        for (size_t i = 0; i != nproducers(); ++i)
+            slot_[i]->acc = proto_;
+    }
+
+    /** Returns result merged over all producers */
+    result_type result() const
+    {
+        Acc merged(proto_);
+        for (size_t i = 0; i != nproducers(); ++i) {
+            // empty results have undefined mean, so skip idle producers
+            if (slot_[i]->acc.count() != 0)
+                merged << slot_[i]->acc.result();
+        }
+        return merged.finalize();
+    }
+
+protected:
+    struct alignas(CACHE_LINE) slot
+    {
+        slot(const Acc &proto) : acc(proto) { }
+
+        // `new` need not honour over-alignment before C++17, so we align the
+        // slot by hand and store the original pointer in front of it.
+        static void *operator new(size_t size)
+        {
+            void *raw = ::operator new(size + CACHE_LINE + sizeof(void *));
+            uintptr_t addr = reinterpret_cast<uintptr_t>(raw) + sizeof(void *);
+            addr = (addr + CACHE_LINE - 1) & ~uintptr_t(CACHE_LINE - 1);
+            reinterpret_cast<void **>(addr)[-1] = raw;
+            return reinterpret_cast<void *>(addr);
+        }
+
+        static void operator delete(void *ptr)
+        {
+            ::operator delete(static_cast<void **>(ptr)[-1]);
+        }
+
+        Acc acc;
+    };
+
+private:
+    Acc proto_;
+    std::vector<std::unique_ptr<slot> > slot_;
+};
+
+template <typename Acc>
+struct traits< concurrent_acc<Acc> >
+    : traits<Acc>
+{ };
+
+}}
@@ -112,6 +112,54 @@ struct computed
     virtual ~computed() { }
 };
 
+/**
+ * Interface for a sparse computed result.
+ *
+ * In addition to the `computed` interface, exposes the (potentially) non-zero
+ * elements as list of indices and values, which must both have `nnz()`
+ * entries.  The indices must be unique.  For, e.g., a histogram-like estimator
+ * which sets only a handful of components per sample, this allows accumulators
+ * to only touch these components.
+ *
+ * See also: sparse_adapter<T>
+ */
+template <typename T>
+struct sparse_computed
+    : public computed<T>
+{
+    /** Number of non-zero elements */
+    virtual size_t nnz() const = 0;
+
+    /** Indices of the non-zero elements */
+    virtual const size_t *indices() const = 0;
+
+    /** Values of the non-zero elements */
+    virtual const T *values() const = 0;
+
+    /** Throw `size_mismatch` unless all indices are smaller than `size()` */
+    void check_indices() const
+    {
+        const size_t *index = indices();
+        for (size_t k = 0; k != nnz(); ++k) {
+            if (index[k] >= this->size())
+                throw size_mismatch();
+        }
+    }
+
+    /** Add the non-zero elements to the buffer in `out` */
+    void add_to(view<T> out) const
+    {
+        if (out.size() != this->size())
+            throw size_mismatch();
+        check_indices();
+
+        const size_t *index = indices();
+        const T *value = values();
+        for (size_t k = 0; k != nnz(); ++k)
+            out.data()[index[k]] += value[k];
+    }
+};
+
 /**
  * Shorthand for Eigen column vector
  */
@@ -205,6 +253,9 @@ struct reducer
     /** Reduce double data-set into `data` */
     virtual void reduce(view<double> data) const = 0;
 
+    /** Reduce single-precision data-set into `data` */
+    virtual void reduce(view<float> data) const = 0;
+
     /** Reduce int data-set into `data` */
     virtual void reduce(view<int32_t> data) const = 0;
 
@@ -228,6 +279,12 @@ struct reducer
     void reduce(view<complex_op<double> > data) const {
         reduce(view<double>((double *)data.data(), 4 * data.size()));
     }
+    void reduce(view<std::complex<float> > data) const {
+        reduce(view<float>((float *)data.data(), 2 * data.size()));
+    }
+    void reduce(view<complex_op<float> > data) const {
+        reduce(view<float>((float *)data.data(), 4 * data.size()));
+    }
     void reduce(view<uint32_t> data) const {
         reduce(view<int32_t>((int32_t *)data.data(), data.size()));
     }
@@ -110,10 +110,21 @@ struct traits< cov_data<T,Strategy> >
 extern template class cov_data<double>;
 extern template class cov_data<std::complex<double>, circular_var>;
 extern template class cov_data<std::complex<double>, elliptic_var>;
+extern template class cov_data<float>;
+extern template class cov_data<std::complex<float>, circular_var>;
+extern template class cov_data<std::complex<float>, elliptic_var>;
 
 
 /**
  * Accumulator which tracks the mean and a naive covariance estimate.
+ *
+ * Completed batches are not added to the covariance matrix one by one, as
+ * this amounts to a memory-bound rank-1 update of a `size * size` matrix.
+ * Instead, they are staged as columns of a buffer and added as one rank-k
+ * update of the lower triangle whenever the buffer is full.  The upper
+ * triangle is only restored by `flush()` and in the result.  `result()` adds
+ * the staged batches to its copy of the data, such that const methods leave
+ * the accumulator untouched.
  */
 template <typename T, typename Strategy=circular_var>
 class cov_acc
@@ -152,6 +163,14 @@ public:
     /** Add computed vector to the accumulator */
     cov_acc& operator<<(const computed<T>& src){ add(src, 1); return *this; }
 
+    /**
+     * Add sparse computed vector to the accumulator.
+     *
+     * For unit batch size, this performs a sparse outer-product update, which
+     * scales with the square of the number of non-zero elements.
+     */
+    cov_acc &operator<<(const sparse_computed<T> &src) { add_sparse(src, 1); return *this; }
+
     /** Merge partial result into accumulator */
     cov_acc &operator<<(const cov_result<T,Strategy> &result);
 
@@ -161,25 +180,51 @@ public:
     /** Returns result corresponding to current state of accumulator */
     cov_result<T,Strategy> result() const;
 
+    /**
+     * Stores result corresponding to current state of accumulator in `result`.
+     *
+     * Re-uses the storage of `result` if it already has the correct size.
+     */
+    void result_to(cov_result<T,Strategy> &result) const;
+
     /** Frees data associated with accumulator and return result */
     cov_result<T,Strategy> finalize();
 
     const bundle<value_type> &current() const { return current_; }
 
-    /** Return backend object used for storing estimands */
-    const cov_data<T,Strategy> &store() const { return *store_; }
+    /** Adds the staged batches to the stored covariance matrix */
+    void flush();
+
+    /**
+     * Return backend object used for storing estimands.
+     *
+     * The store contains all completed batches, but not the current,
+     * incomplete batch.  Staged batches are flushed first.
+     */
+    const cov_data<T,Strategy> &store() const;
 
 protected:
     void add(const computed<T> &source, uint64_t count);
 
+    void add_sparse(const sparse_computed<T> &source, uint64_t count);
+
     void add_bundle();
 
+    void flush_stage() const;
+
     void finalize_to(cov_result<T,Strategy> &result);
 
 private:
+    const static size_t STAGE_SIZE = 32;
+
     std::unique_ptr<cov_data<T,Strategy> > store_;
     bundle<value_type> current_;
 
+    // batches not yet added to the covariance matrix; flushing them does not
+    // change the observable state, so it is allowed from const methods
+    mutable typename eigen<value_type>::matrix stage_;
+    mutable size_t nstaged_;
+
     friend class batch_result<T>;
 };
 
@@ -197,6 +242,9 @@ struct traits< cov_acc<T,Strategy> >
 extern template class cov_acc<double>;
 extern template class cov_acc<std::complex<double>, circular_var>;
 extern template class cov_acc<std::complex<double>, elliptic_var>;
+extern template class cov_acc<float>;
+extern template class cov_acc<std::complex<float>, circular_var>;
+extern template class cov_acc<std::complex<float>, elliptic_var>;
 
 
 /**
@@ -326,5 +374,8 @@ struct traits< cov_result<T,Strategy> >
 extern template class cov_result<double>;
 extern template class cov_result<std::complex<double>, circular_var>;
 extern template class cov_result<std::complex<double>, elliptic_var>;
+extern template class cov_result<float>;
+extern template class cov_result<std::complex<float>, circular_var>;
+extern template class cov_result<std::complex<float>, elliptic_var>;
 
 }} /* namespace alps::alea */
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+#pragma once
+
+#include <alps/alea/core.hpp>
+#include <alps/alea/util.hpp>
+
+#include <cmath>
+#include <complex>
+#include <iosfwd>
+#include <utility>
+
+// Forward declarations
+
+namespace alps { namespace alea {
+    template <typename T> class dual;
+    template <typename T> struct dual_transformer;
+}}
+
+// Actual declarations
+
+namespace alps { namespace alea {
+
+/**
+ * Dual number carrying a value and its gradient for forward-mode AD.
+ *
+ * A dual number represents `value + sum_j tangent[j] eps[j]`, where
+ * `eps[j]` are infinitesimals with `eps[i] eps[j] = 0`.  Evaluating a function
+ * on dual numbers thus computes its value together with its derivatives along
+ * all tangent directions at once, exactly and in a single pass.
+ *
+ * Constants have an empty tangent, which is treated as zero in arithmetic, so
+ * they do not need to know the number of tangent directions.
+ *
+ * For complex `T`, the derivatives are complex derivatives and thus only
+ * meaningful for holomorphic functions.
+ *
+ * The tangent is a dynamic vector, so every non-constant result needs storage
+ * for it.  To keep that to a minimum, the compound assignments update the
+ * tangent in place, and the operators and functions take their (left)
+ * argument by value and work on that copy: intermediate results of an
+ * expression thus hand on their storage instead of allocating anew.
+ *
+ * @see alps::alea::dual_transformer, alps::alea::jacobian
+ */
+template <typename T>
+class dual
+{
+public:
+    typedef T value_type;
+    typedef typename eigen<T>::col tangent_type;
+
+    /** Returns independent variable `value` along the `i`-th of `n` directions */
+    static dual variable(T value, size_t n, size_t i)
+    {
+        return dual(value, tangent_type::Unit(n, i));
+    }
+
+public:
+    /** Zero constant */
+    dual() : value_(0), tangent_() { }
+
+    /** Constant (vanishing tangent) */
+    dual(T value) : value_(value), tangent_() { }
+
+    /** Construct from value and tangent */
+    dual(T value, tangent_type tangent) : value_(value), tangent_(std::move(tangent)) { }
+
+    /** Value of the number */
+    const T &value() const { return value_; }
+
+    /** Derivatives with respect to each tangent direction (empty if constant) */
+    const tangent_type &tangent() const { return tangent_; }
+
+    /** Returns `true` if the number has vanishing tangent */
+    bool is_constant() const { return tangent_.size() == 0; }
+
+    dual &operator+=(const dual &x)
+    {
+        combine(1, 1, x);
+        value_ += x.value_;
+        return *this;
+    }
+
+    dual &operator-=(const dual &x)
+    {
+        combine(1, -1, x);
+        value_ -= x.value_;
+        return *this;
+    }
+
+    dual &operator*=(const dual &x)
+    {
+        combine(x.value_, value_, x);
+        value_ *= x.value_;
+        return *this;
+    }
+
+    dual &operator/=(const dual &x)
+    {
+        T inv = T(1) / x.value_;
+        T quot = value_ * inv;
+        combine(inv, -quot * inv, x);
+        value_ = quot;
+        return *this;
+    }
+
+    friend dual operator+(dual l, const dual &r) { l += r; return l; }
+
+    friend dual operator-(dual l, const dual &r) { l -= r; return l; }
+
+    friend dual operator*(dual l, const dual &r) { l *= r; return l; }
+
+    friend dual operator/(dual l, const dual &r) { l /= r; return l; }
+
+    friend dual operator-(dual x) { x.chain(-x.value_, -1); return x; }
+
+    friend dual operator+(dual x) { return x; }
+
+    friend bool operator==(const dual &l, const dual &r) { return l.value_ == r.value_; }
+
+    friend bool operator!=(const dual &l, const dual &r) { return l.value_ != r.value_; }
+
+    friend bool operator<(const dual &l, const dual &r) { return l.value_ < r.value_; }
+
+    friend bool operator>(const dual &l, const dual &r) { return l.value_ > r.value_; }
+
+    friend dual sqrt(dual x)
+    {
+        T s = std::sqrt(x.value_);
+        x.chain(s, T(0.5) / s);
+        return x;
+    }
+
+    friend dual exp(dual x)
+    {
+        T e = std::exp(x.value_);
+        x.chain(e, e);
+        return x;
+    }
+
+    friend dual log(dual x)
+    {
+        x.chain(std::log(x.value_), T(1) / x.value_);
+        return x;
+    }
+
+    friend dual sin(dual x)
+    {
+        x.chain(std::sin(x.value_), std::cos(x.value_));
+        return x;
+    }
+
+    friend dual cos(dual x)
+    {
+        x.chain(std::cos(x.value_), -std::sin(x.value_));
+        return x;
+    }
+
+    friend dual tan(dual x)
+    {
+        T t = std::tan(x.value_);
+        x.chain(t, T(1) + t * t);
+        return x;
+    }
+
+    friend dual pow(dual x, double p)
+    {
+        x.chain(std::pow(x.value_, p), T(p) * std::pow(x.value_, p - 1));
+        return x;
+    }
+
+    friend dual abs(dual x)
+    {
+        // only meaningful for real numbers
+        x.chain(std::abs(x.value_), x.value_ < 0 ? -1 : 1);
+        return x;
+    }
+
+    friend std::ostream &operator<<(std::ostream &out, const dual &x)
+    {
+        out << x.value_ << "+d[" << x.tangent_.transpose() << ']';
+        return out;
+    }
+
+protected:
+    /** Replaces `x` by `f(x)`, given the value `f(x)` and derivative `f'(x)` */
+    void chain(T value, T deriv)
+    {
+        tangent_ *= deriv;
+        value_ = value;
+    }
+
+    /** Sets tangent to `a * tangent + b * x.tangent`, where empty tangents vanish */
+    void combine(T a, T b, const dual &x)
+    {
+        if (x.is_constant()) {
+            tangent_ *= a;
+        } else if (is_constant()) {
+            tangent_ = b * x.tangent_;
+        } else {
+            if (tangent_.size() != x.tangent_.size())
+                throw size_mismatch();
+            tangent_ = a * tangent_ + b * x.tangent_;
+        }
+    }
+
+private:
+    T value_;
+    tangent_type tangent_;
+};
+
+/**
+ * Transformer which can also be evaluated on dual numbers.
+ *
+ * Evaluating the transformation on dual numbers yields the exact Jacobian in
+ * a single pass, which is used by `transform(linear_prop, ...)` in place of
+ * finite differences.
+ *
+ * @see alps::alea::make_dual_transformer, alps::alea::jacobian
+ */
+template <typename T>
+struct dual_transformer
+    : public transformer<T>
+{
+    using transformer<T>::operator();
+
+    /** apply transformation to dual numbers, propagating the tangents */
+    virtual column<dual<T> > operator() (const column<dual<T> > &in) const = 0;
+};
+
+}} /* namespace alps::alea */
+
+namespace Eigen {
+
+/**
+ * Allows use of alps::alea::dual as scalar of Eigen matrices
+ */
+template <typename T>
+struct NumTraits< alps::alea::dual<T> >
+    : NumTraits<T>
+{
+    typedef alps::alea::dual<T> Real;
+    typedef alps::alea::dual<T> NonInteger;
+    typedef alps::alea::dual<T> Nested;
+    typedef alps::alea::dual<T> Literal;
+
+    enum {
+        IsComplex = 0,
+        IsInteger = 0,
+        IsSigned = 1,
+        RequireInitialization = 1,
+        ReadCost = 1,
+        AddCost = 3,
+        MulCost = 3
+    };
+};
+
+} /* namespace Eigen */
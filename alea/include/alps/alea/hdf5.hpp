@@ -8,6 +8,7 @@
 #include <sstream>
 #include <numeric>
 #include <iostream>
+#include <set>
 
 #include <alps/alea/core.hpp>
 
@@ -15,30 +16,47 @@
 
 namespace alps { namespace alea {
 
+/**
+ * Serializer and deserializer backed by an HDF5 archive.
+ *
+ * The full paths of the groups on the `enter()`/`exit()` stack are cached,
+ * and each group is only created once per serializer, which avoids most of
+ * the metadata traffic when writing many results into the same archive.
+ *
+ * If `scalar_attributes` is set, scalars (e.g., sample counts) are written
+ * as attributes `@key` of the enclosing group rather than as datasets of
+ * their own.  Attributes are stored in the header of the group, which is much
+ * cheaper than creating a dataset for each scalar.  Either layout is read
+ * back transparently.
+ */
 class hdf5_serializer
     : public serializer
     , public deserializer
 {
 public:
-    hdf5_serializer(hdf5::archive &ar, const std::string &path)
+    hdf5_serializer(hdf5::archive &ar, const std::string &path,
+                    bool scalar_attributes=false)
         : archive_(&ar)
-        , path_(path)
-        , group_()
+        , scalar_attributes_(scalar_attributes)
+        , prefix_(1, path + '/')
+        , created_()
     { }
 
     // Common methods
 
     void enter(const std::string &group) override
     {
-        archive_->create_group(get_path(group));  // TODO: what if exists?
-        group_.push_back(group);
+        std::string path = get_path(group);
+        if (created_.insert(path).second)
+            archive_->create_group(path);
+        prefix_.push_back(path + '/');
     }
 
     void exit() override
     {
-        if (group_.empty())
+        if (prefix_.size() == 1)
             throw std::runtime_error("exit without enter");
-        group_.pop_back();
+        prefix_.pop_back();
     }
 
     void write(const std::string &key, ndview<const double> value) override {
@@ -68,7 +86,8 @@ public:
     // Deserialization methods
 
     std::vector<size_t> get_shape(const std::string &key) override {
-        return get_extent(get_path(key));
+        std::string path;
+        return locate(key, path);
     }
 
     void read(const std::string &key, ndview<double> value) override {
@@ -98,10 +117,10 @@ public:
     ~hdf5_serializer()
     {
         // Cannot do exception because we are in destructor
-        if (!group_.empty()) {
+        if (prefix_.size() != 1) {
             std::cerr << "alps::alea::hdf5_serializer: warning: "
                       << "enter without exit\n Lingering groups:"
-                      << get_path("") << "\n\n";
+                      << prefix_.back() << "\n\n";
         }
     }
 
@@ -109,22 +128,25 @@ protected:
     template <typename T>
     void do_write(const std::string &relpath, ndview<const T> data)
     {
-        std::string path = get_path(relpath);
+        std::string path = get_write_path(relpath);
 
         std::vector<size_t> shape(data.shape(), data.shape() + data.ndim());
         std::vector<size_t> offset(shape.size(), 0);
         std::vector<size_t> chunk = shape;
 
-        if (data.ndim() == 0)
+        if (data.ndim() == 0) {
+            if (scalar_attributes_ && relpath[0] != '@')
+                path = get_path('@' + relpath);
             archive_->write(path, *data.data());
-        else
+        } else {
             archive_->write(path, data.data(), shape, chunk, offset);
+        }
     }
 
     template <typename T>
     void do_write(const std::string &relpath, ndview<const std::complex<T>> data)
     {
-        std::string path = get_path(relpath);
+        std::string path = get_write_path(relpath);
 
         if (data.ndim() == 0)
             throw unsupported_operation();
@@ -143,10 +165,9 @@ protected:
     template <typename T>
     void do_read(const std::string &relpath, ndview<T> data)
     {
-        std::string path = get_path(relpath);
-
         // check shape (this is cheap compared to reading)
-        std::vector<size_t> shape = get_extent(path);
+        std::string path;
+        std::vector<size_t> shape = locate(relpath, path);
         if (data.ndim() != shape.size())
             throw size_mismatch();
         for (size_t i = 0; i != shape.size(); ++i)
@@ -170,10 +191,9 @@ protected:
     template <typename T>
     void do_read(const std::string &relpath, ndview<std::complex<T>> data)
     {
-        std::string path = get_path(relpath);
-
         // check shape (this is cheap compared to reading)
-        std::vector<size_t> shape = get_extent(path);
+        std::string path;
+        std::vector<size_t> shape = locate(relpath, path);
         if (data.ndim() != shape.size() - 1)
             throw size_mismatch();
         for (size_t i = 0; i != data.ndim(); ++i)
@@ -197,14 +217,43 @@ protected:
 
     std::string get_path(const std::string &key)
     {
-        std::ostringstream maker(path_, std::ios_base::app);
-        maker << '/';
-        for (const std::string &group : group_)
-            maker << group << '/';
         if (key.find('/') != std::string::npos)
             throw std::runtime_error("Key must not contain '/'");
-        maker << key;
-        return maker.str();
+        return prefix_.back() + key;
+    }
+
+    std::string get_write_path(const std::string &key)
+    {
+        // writing a dataset replaces any group of the same name
+        std::string path = get_path(key);
+        created_.erase(path);
+        created_.erase(created_.lower_bound(path + '/'),
+                       created_.lower_bound(path + char('/' + 1)));
+        return path;
+    }
+
+    /**
+     * Returns the extent of `key` and stores its full path in `path`.
+     *
+     * Scalars may have been written as attributes (see constructor), but the
+     * dataset is tried first, such that this costs no additional metadata
+     * calls unless the dataset does not exist.
+     */
+    std::vector<size_t> locate(const std::string &key, std::string &path)
+    {
+        path = get_path(key);
+        if (key.empty() || key[0] == '@')
+            return get_extent(path);
+
+        try {
+            return get_extent(path);
+        } catch (const hdf5::archive_error &) {
+            std::string attr_path = get_path('@' + key);
+            if (!archive_->is_attribute(attr_path))
+                throw;
+            path = attr_path;
+            return get_extent(path);
+        }
     }
 
     std::vector<size_t> get_extent(const std::string &path)
@@ -217,8 +266,9 @@ protected:
 
 private:
     hdf5::archive *archive_;
-    std::string path_;
-    std::vector<std::string> group_;
+    bool scalar_attributes_;
+    std::vector<std::string> prefix_;
+    std::set<std::string> created_;
 };
 
 }}
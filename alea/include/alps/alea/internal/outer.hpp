@@ -7,7 +7,10 @@
 
 #include <Eigen/Core>
 
+#include <type_traits>
+
 #include <alps/alea/complex_op.hpp>
+#include <alps/alea/util.hpp>
 #include <alps/alea/var_strategy.hpp>
 
 // Forward declarations
@@ -125,3 +128,76 @@ private:
 };
 
 }} /* namespace Eigen::internal */
+
+namespace alps { namespace alea { namespace internal {
+
+/**
+ * Rank-k update of a covariance-like matrix in the sense of `outer()`.
+ *
+ * Given a matrix `x` of `k` columns, adds `sum(outer(x[:,i], x[:,i]))` to
+ * `cov`.  If `outer` is the usual outer product `x * y.adjoint()`, only the
+ * lower triangle of `cov` is updated using a single BLAS-3-like operation
+ * (SYRK/HERK), and `mirror()` must be called to restore the upper triangle.
+ * Otherwise, we fall back to `k` dense rank-1 updates.
+ */
+template <typename Str, bool Hermitian=std::is_same<
+                typename Str::cov_type, typename Str::value_type>::value>
+struct rank_update
+{
+    template <typename Matrix, typename Arg>
+    static void add(Matrix &cov, const Eigen::MatrixBase<Arg> &x)
+    {
+        cov.template selfadjointView<Eigen::Lower>().rankUpdate(x);
+    }
+
+    /**
+     * Adds `scale * outer(x, x)` for sparse `x` given as `nnz` index/values.
+     *
+     * The indices are not checked: see `sparse_computed::check_indices()`.
+     */
+    template <typename Matrix, typename T>
+    static void add_sparse(Matrix &cov, const size_t *index, const T *value,
+                           size_t nnz, make_real_type<T> scale)
+    {
+        // like `add()`, only update the lower triangle
+        for (size_t a = 0; a != nnz; ++a) {
+            for (size_t b = 0; b != nnz; ++b) {
+                if (index[a] >= index[b])
+                    cov(index[a], index[b]) += scale * Str::outer(value[a], value[b]);
+            }
+        }
+    }
+
+    template <typename Matrix>
+    static void mirror(Matrix &cov)
+    {
+        for (Eigen::Index j = 1; j < cov.cols(); ++j)
+            cov.col(j).head(j) = cov.row(j).head(j).adjoint();
+    }
+};
+
+template <typename Str>
+struct rank_update<Str, false>
+{
+    template <typename Matrix, typename Arg>
+    static void add(Matrix &cov, const Eigen::MatrixBase<Arg> &x)
+    {
+        for (Eigen::Index i = 0; i != x.cols(); ++i)
+            cov.noalias() += outer<Str>(x.col(i), x.col(i));
+    }
+
+    template <typename Matrix, typename T>
+    static void add_sparse(Matrix &cov, const size_t *index, const T *value,
+                           size_t nnz, make_real_type<T> scale)
+    {
+        for (size_t a = 0; a != nnz; ++a) {
+            for (size_t b = 0; b != nnz; ++b)
+                cov(index[a], index[b]) += scale * Str::outer(value[a], value[b]);
+        }
+    }
+
+    template <typename Matrix>
+    static void mirror(Matrix &) { }
+};
+
+}}}
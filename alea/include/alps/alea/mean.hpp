@@ -89,6 +89,8 @@ struct traits< mean_data<T> >
 
 extern template class mean_data<double>;
 extern template class mean_data<std::complex<double> >;
+extern template class mean_data<float>;
+extern template class mean_data<std::complex<float> >;
 
 
 /**
@@ -131,6 +133,13 @@ public:
     /** Returns result corresponding to current state of accumulator */
     mean_result<T> result() const;
 
+    /**
+     * Stores result corresponding to current state of accumulator in `result`.
+     *
+     * Re-uses the storage of `result` if it already has the correct size.
+     */
+    void result_to(mean_result<T> &result) const;
+
     /** Frees data associated with accumulator and return result */
     mean_result<T> finalize();
 
@@ -157,6 +166,8 @@ struct traits< mean_acc<T> >
 
 extern template class mean_acc<double>;
 extern template class mean_acc<std::complex<double> >;
+extern template class mean_acc<float>;
+extern template class mean_acc<std::complex<float> >;
 
 /**
  * Result of a mean accumulation
@@ -240,5 +251,7 @@ struct traits< mean_result<T> >
 
 extern template class mean_result<double>;
 extern template class mean_result<std::complex<double> >;
+extern template class mean_result<float>;
+extern template class mean_result<std::complex<float> >;
 
 }}
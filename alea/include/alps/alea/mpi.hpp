@@ -64,6 +64,8 @@ struct mpi_reducer
 
     void reduce(view<double> data) const override { inplace_reduce(data); }
 
+    void reduce(view<float> data) const override { inplace_reduce(data); }
+
     void reduce(view<int32_t> data) const override { inplace_reduce(data); }
 
     void reduce(view<int64_t> data) const override { inplace_reduce(data); }
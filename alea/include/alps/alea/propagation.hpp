@@ -8,11 +8,13 @@
 #include <Eigen/Core>
 
 #include <alps/alea/complex_op.hpp>
+#include <alps/alea/dual.hpp>
 
 // TODO maybe a better way?
 #include <alps/alea/mean.hpp>
 #include <alps/alea/variance.hpp>
 #include <alps/alea/covariance.hpp>
+#include <alps/alea/blockcov.hpp>
 #include <alps/alea/autocorr.hpp>
 #include <alps/alea/batch.hpp>
 
@@ -34,9 +36,11 @@ struct no_prop { };
  *
  *     Cov[f(X)] = df/dX Cov[X] (df/dX)^T + O(d^2f/dx^2)
  *
- * where `df/dX` is the Jacobian of `f` at `X`, as estimated by finite
- * differences of `dx`.  This procedure is exact for linear transformations;
- * for non-linear transformation, it will introduce bias.
+ * where `df/dX` is the Jacobian of `f` at `X`.  If `f` is a
+ * `dual_transformer`, the Jacobian is computed exactly by forward-mode
+ * automatic differentiation and `dx` is ignored; otherwise, it is estimated
+ * by finite differences of `dx`.  This procedure is exact for linear
+ * transformations; for non-linear transformation, it will introduce bias.
  *
  * @see alps::alea::jacobian
  */
@@ -107,6 +111,43 @@ private:
 template <typename T>
 typename eigen<T>::matrix jacobian(const transformer<T> &f, column<T> x, double dx);
 
+/**
+ * Given a function `f`, compute its Jacobian `J[i,j] = df[i]/dx[j]` exactly.
+ *
+ * Evaluates `f` once on dual numbers seeded with the `f.in_size()` unit
+ * tangent directions, i.e., by forward-mode automatic differentiation.
+ */
+template <typename T>
+typename eigen<T>::matrix jacobian(const dual_transformer<T> &f, const column<T> &x);
+
+/**
+ * Given a function `f`, estimate the diagonal blocks of its Jacobian.
+ *
+ * Assuming that `f` maps each of a set of contiguous blocks of components
+ * onto itself, i.e., that the Jacobian is block-diagonal, estimate the
+ * diagonal blocks by forward differences, where the `j`-th component of all
+ * blocks is displaced at once.  This requires only `max(block_sizes) + 1`
+ * rather than `f.in_size() + 1` evaluations of `f`.
+ *
+ * @see alps::alea::jacobian
+ */
+template <typename T>
+std::vector<typename eigen<T>::matrix> block_jacobian(
+                        const transformer<T> &f, column<T> x,
+                        const std::vector<size_t> &block_sizes, double dx);
+
+/**
+ * Given a function `f`, compute the diagonal blocks of its Jacobian exactly.
+ *
+ * As the finite-difference variant, but evaluates `f` once on dual numbers
+ * with `max(block_sizes)` tangent directions, where the `j`-th component of
+ * every block is seeded with the `j`-th direction.
+ */
+template <typename T>
+std::vector<typename eigen<T>::matrix> block_jacobian(
+                        const dual_transformer<T> &f, const column<T> &x,
+                        const std::vector<size_t> &block_sizes);
+
 
 /**
  * Perform Jackknife transformation to pseudovalues
@@ -12,6 +12,31 @@
 
 #include <array>
 
+namespace alps { namespace alea { namespace internal {
+
+/**
+ * Maps scalar type to the type it is stored as by (de-)serializers.
+ *
+ * Single-precision types are not serialization primitives, so their values
+ * are widened to the corresponding double-precision type on disk.
+ */
+template <typename T>
+struct serialized_scalar { typedef T type; };
+
+template <>
+struct serialized_scalar<float> { typedef double type; };
+
+template <>
+struct serialized_scalar<std::complex<float>> { typedef std::complex<double> type; };
+
+template <>
+struct serialized_scalar<complex_op<float>> { typedef complex_op<double> type; };
+
+template <typename T>
+using serialized_scalar_t = typename serialized_scalar<T>::type;
+
+}}}
+
 namespace alps { namespace serialization {
 
 /** Serializes Eigen array of complex_op<double> */
@@ -71,4 +96,41 @@ deserialize(deserializer &ser, const std::string &key,
     }
 }
 
+/** Underlying Eigen scalar type is single-precision and widened on disk */
+template <typename Derived>
+struct has_narrow_scalar {
+    static const bool value = !std::is_same<
+                alps::alea::internal::serialized_scalar_t<eigen_scalar_t<Derived>>,
+                eigen_scalar_t<Derived>>::value;
+};
+
+/** Serializes Eigen array of single-precision scalars */
+template <typename Derived>
+typename std::enable_if<has_narrow_scalar<Derived>::value>::type
+serialize(serializer &ser, const std::string &key,
+          const Eigen::PlainObjectBase<Derived> &value)
+{
+    using wide_type = alps::alea::internal::serialized_scalar_t<eigen_scalar_t<Derived>>;
+    using matrix_type = Eigen::Matrix<wide_type, Derived::RowsAtCompileTime,
+                                      Derived::ColsAtCompileTime>;
+
+    serialize(ser, key, matrix_type(value.template cast<wide_type>()));
+}
+
+/** Deserializes Eigen array of single-precision scalars */
+template <typename Derived>
+typename std::enable_if<has_narrow_scalar<Derived>::value>::type
+deserialize(deserializer &ser, const std::string &key,
+            Eigen::PlainObjectBase<Derived> &value)
+{
+    using scalar_type = eigen_scalar_t<Derived>;
+    using wide_type = alps::alea::internal::serialized_scalar_t<scalar_type>;
+    using matrix_type = Eigen::Matrix<wide_type, Derived::RowsAtCompileTime,
+                                      Derived::ColsAtCompileTime>;
+
+    matrix_type buffer(value.rows(), value.cols());
+    deserialize(ser, key, buffer);
+    value = buffer.template cast<scalar_type>();
+}
+
 }}
@@ -11,6 +11,7 @@
 #include <alps/alea/mean.hpp>
 #include <alps/alea/variance.hpp>
 #include <alps/alea/covariance.hpp>
+#include <alps/alea/blockcov.hpp>
 #include <alps/alea/batch.hpp>
 
 #include <alps/alea/propagation.hpp>
@@ -22,6 +23,30 @@
 
 namespace alps { namespace alea {
 
+namespace internal {
+
+/**
+ * Returns Jacobian of `tf` at the mean of `in` for linearized propagation.
+ *
+ * Uses automatic differentiation if `tf` supports it, or else forward
+ * differences with step `p.dx()` (defaulting to a fraction of the error).
+ */
+template <typename T, typename InResult>
+typename eigen<T>::matrix linear_jacobian(linear_prop p, const transformer<T> &tf,
+                                          const InResult &in)
+{
+    const dual_transformer<T> *dual_tf = dynamic_cast<const dual_transformer<T> *>(&tf);
+    if (dual_tf != nullptr)
+        return jacobian(*dual_tf, in.mean());
+
+    double dx = p.dx();
+    if (dx == 0)
+        dx = 0.125 * std::abs(in.stderror().mean());
+    return jacobian(tf, in.mean(), dx);
+}
+
+}
+
 template <typename T, typename InResult>
 mean_result<T> transform(no_prop, const transformer<T> &tf, const InResult &in)
 {
@@ -49,10 +74,7 @@ typename std::enable_if<traits<InResult>::HAVE_COV, cov_result<T> >::type transf
     if (tf.in_size() != in.size())
         throw size_mismatch();
 
-    double dx = p.dx();
-    if (dx == 0)
-        dx = 0.125 * std::abs(in.stderror().mean());
-    typename eigen<T>::matrix jac = jacobian(tf, in.mean(), dx);
+    typename eigen<T>::matrix jac = internal::linear_jacobian(p, tf, in);
 
     cov_result<T> res(cov_data<T>(tf.out_size()));
     res.store().data() = tf(in.mean());
@@ -73,10 +95,7 @@ typename std::enable_if<!traits<InResult>::HAVE_COV, cov_result<T>>::type transf
     if (tf.in_size() != in.size())
         throw size_mismatch();
 
-    double dx = p.dx();
-    if (dx == 0)
-        dx = 0.125 * std::abs(in.stderror().mean());
-    typename eigen<T>::matrix jac = jacobian(tf, in.mean(), dx);
+    typename eigen<T>::matrix jac = internal::linear_jacobian(p, tf, in);
 
     cov_result<T> res(cov_data<T>(tf.out_size()));
     res.store().data() = tf(in.mean());
@@ -86,6 +105,36 @@ typename std::enable_if<!traits<InResult>::HAVE_COV, cov_result<T>>::type transf
     return res;
 }
 
+template <typename T>
+blockcov_result<T> transform(linear_prop p, const transformer<T> &tf, const blockcov_result<T> &in)
+{
+    // the transform must respect the block structure of the result, i.e.,
+    // map each block onto itself, such that the Jacobian is block-diagonal.
+    if (tf.in_size() != in.size() || tf.out_size() != in.size())
+        throw size_mismatch();
+
+    std::vector<size_t> block_sizes = in.store().block_sizes();
+    std::vector<typename eigen<T>::matrix> jac;
+    const dual_transformer<T> *dual_tf = dynamic_cast<const dual_transformer<T> *>(&tf);
+    if (dual_tf != nullptr) {
+        jac = block_jacobian(*dual_tf, in.mean(), block_sizes);
+    } else {
+        double dx = p.dx();
+        if (dx == 0)
+            dx = 0.125 * std::abs(in.stderror().mean());
+        jac = block_jacobian(tf, in.mean(), block_sizes, dx);
+    }
+
+    blockcov_data<T> res_data(block_sizes);
+    blockcov_result<T> res(res_data);
+    res.store().data() = tf(in.mean());
+    for (size_t i = 0; i != in.nblocks(); ++i)
+        res.store().data2(i) = jac[i] * in.block_cov(i) * jac[i].adjoint();
+    res.store().count() = in.count();
+    res.store().count2() = in.count2();
+    return res;
+}
+
 template <typename T>
 batch_result<T> transform(jackknife_prop, const transformer<T> &tf, const batch_result<T> &in)
 {
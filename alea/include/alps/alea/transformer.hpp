@@ -11,6 +11,7 @@
 #include <alps/alea/mean.hpp>
 #include <alps/alea/propagation.hpp>
 #include <alps/alea/convert.hpp>
+#include <alps/alea/dual.hpp>
 
 // Forward declarations
 
@@ -18,6 +19,7 @@ namespace alps { namespace alea {
     template <typename T> struct linear_transformer;
     template <typename T> struct scalar_unary_transformer;
     template <typename T> struct scalar_binary_transformer;
+    template <typename T, typename Fn> struct dual_function_transformer;
 }}
 
 // Actual declarations
@@ -36,6 +38,34 @@ scalar_binary_transformer<T> make_transformer(std::function<T(T,T)> fn)
     return scalar_binary_transformer<T>(fn);
 }
 
+/**
+ * Create transformer from function object generic in the scalar type.
+ *
+ * `fn` must be callable both with `column<T>` and with `column<dual<T>>`,
+ * returning a column of the same scalar type.  Use unqualified calls to
+ * mathematical functions such that the overloads for `dual` are found:
+ *
+ *     struct log_ratio {
+ *         template <typename S>
+ *         column<S> operator()(const column<S> &in) const {
+ *             using std::log;
+ *             column<S> out(1);
+ *             out(0) = log(in(0) / in(1));
+ *             return out;
+ *         }
+ *     };
+ *     auto tf = make_dual_transformer<double>(2, 1, log_ratio());
+ *
+ * The resulting transformer allows `transform(linear_prop, ...)` to use the
+ * exact Jacobian instead of finite differences.
+ */
+template <typename T, typename Fn>
+dual_function_transformer<T, Fn> make_dual_transformer(size_t in_size,
+                                                       size_t out_size, Fn fn)
+{
+    return dual_function_transformer<T, Fn>(in_size, out_size, fn);
+}
+
 /**
  * Linear transformation mediated by a matrix.
  */
@@ -116,4 +146,44 @@ private:
     std::function<T(T,T)> fn_;
 };
 
+template <typename T, typename Fn>
+struct dual_function_transformer
+    : public dual_transformer<T>
+{
+public:
+    dual_function_transformer(size_t in_size, size_t out_size, Fn fn)
+        : in_size_(in_size)
+        , out_size_(out_size)
+        , fn_(fn)
+    { }
+
+    size_t in_size() const { return in_size_; }
+
+    size_t out_size() const { return out_size_; }
+
+    column<T> operator() (const column<T> &in) const { return apply(in); }
+
+    column<dual<T> > operator() (const column<dual<T> > &in) const
+    {
+        return apply(in);
+    }
+
+protected:
+    template <typename S>
+    column<S> apply(const column<S> &in) const
+    {
+        if (in.size() != in_size_)
+            throw size_mismatch();
+
+        column<S> ret = fn_(in);
+        if (ret.size() != out_size_)
+            throw size_mismatch();
+        return ret;
+    }
+
+private:
+    size_t in_size_, out_size_;
+    Fn fn_;
+};
+
 }}  /* namespace alps::alea */
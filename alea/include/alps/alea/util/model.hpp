@@ -9,6 +9,10 @@
 #include <alps/alea/core.hpp>
 #include <alps/alea/util.hpp>
 
+#include <algorithm>
+
+#include <Eigen/SparseCore>
+
 // TODO replace with <random>; kept for consistency through ALPS
 #include <boost/random.hpp>
 
@@ -19,6 +23,13 @@ namespace alps { namespace alea { namespace util {
 
 namespace alps { namespace alea { namespace util {
 
+/** Structure of the lag term of a VAR(1) model */
+enum lag_structure {
+    LAG_DENSE,
+    LAG_DIAGONAL,
+    LAG_SPARSE
+};
+
 /**
  * Linear vector autoregressive model (VAR(1)).
  *
@@ -47,7 +58,7 @@ public:
     typedef typename make_real<T>::type var_type;
 
 public:
-    var1_model() { }
+    var1_model() : phi1_structure_(LAG_DENSE) { }
 
     template <typename Der1, typename Der2, typename Der3>
     var1_model(const Eigen::MatrixBase<Der1> &phi0,
@@ -91,6 +102,12 @@ public:
     /** Standard dev of the Gaussian noise that makes up the shock term. */
     const typename eigen<var_type>::col &stddev_eps() const { return stddev_eps_; }
 
+    /** Structure of the linear lag term, exploited by `var1_run::step_block` */
+    lag_structure phi1_structure() const { return phi1_structure_; }
+
+    /** Linear lag term as sparse matrix (only set if structure is sparse) */
+    const Eigen::SparseMatrix<T> &phi1_sparse() const { return phi1_sparse_; }
+
 protected:
     void init();
 
@@ -98,6 +115,8 @@ private:
     typename eigen<T>::col phi0_;
     typename eigen<T>::matrix phi1_;
     typename eigen<var_type>::col var_eps_, stddev_eps_;
+    lag_structure phi1_structure_;
+    Eigen::SparseMatrix<T> phi1_sparse_;
 };
 
 extern template class var1_model<double>;
@@ -130,6 +149,33 @@ public:
         update();
     }
 
+    /**
+     * Take `out.cols()` steps at once, storing the positions in `out`.
+     *
+     * The Gaussian noise for a chunk of steps is drawn in one go, and the
+     * structure of the lag term (diagonal, sparse) is exploited.  The random
+     * numbers are consumed in the same order as by repeated calls to `step()`,
+     * which is reproduced up to rounding.  Since drawing the noise dominates,
+     * this is only a few times faster than `step()` for small models: the
+     * ziggurat sampler of `boost::random::normal_distribution` costs little
+     * more than the call to the engine, and sampling in bulk by Box-Muller
+     * turned out slower.  The `t`-th column of `out` holds the position
+     * after `t+1` steps.
+     */
+    template <typename RandomEngine>
+    void step_block(RandomEngine &engine, typename eigen<T>::matrix &out)
+    {
+        if (out.rows() != xt_.rows())
+            throw size_mismatch();
+
+        // keep noise buffer in cache by proceeding in chunks
+        Eigen::Index chunk = std::max<Eigen::Index>(NOISE_BUFFER / out.rows(), 1);
+        for (Eigen::Index start = 0; start < out.cols(); start += chunk) {
+            get_noise_block(engine, std::min(chunk, out.cols() - start));
+            update_block(out, start);
+        }
+    }
+
     /** Number of steps taken */
     size_t t() const { return t_; }
 
@@ -143,20 +189,42 @@ protected:
     template <typename RandomEngine>
     void get_noise(RandomEngine &engine)
     {
-        using boost::random::normal_distribution;
-        for (size_t i = 0; i != epst_.size(); ++i) {
-            normal_distribution<var_type> dist(0, model_->stddev_eps()[i]);
+        // draw standard normals and scale them, as in get_noise_block()
+        boost::random::normal_distribution<var_type> dist;
+        for (size_t i = 0; i != epst_.size(); ++i)
             epst_[i] = dist(engine);
-        }
+        epst_.array() *= model_->stddev_eps().array();
+    }
+
+    template <typename RandomEngine>
+    void get_noise_block(RandomEngine &engine, size_t nsteps)
+    {
+        // draw standard normals in one sweep and scale them afterwards
+        boost::random::normal_distribution<var_type> dist;
+        noise_.resize(epst_.size(), nsteps);
+        var_type *data = noise_.data();
+        for (Eigen::Index i = 0; i != noise_.size(); ++i)
+            data[i] = dist(engine);
+        noise_.array().colwise() *= model_->stddev_eps().array();
     }
 
     void update();
 
+    void update_block(typename eigen<T>::matrix &out, Eigen::Index start);
+
+    template <typename Lag>
+    void update_block(const Lag &phi1, typename eigen<T>::matrix &out,
+                      Eigen::Index start);
+
+    /** Maximum number of noise terms drawn at once */
+    static const Eigen::Index NOISE_BUFFER = 16384;
+
 private:
     const var1_model<T> *model_;
     size_t t_;
     column<T> xt_;
     column<var_type> epst_;
+    typename eigen<var_type>::matrix noise_;
 };
 
 extern template class var1_run<double>;
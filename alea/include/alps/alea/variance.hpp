@@ -111,6 +111,9 @@ struct traits< var_data<T,Strategy> >
 extern template class var_data<double>;
 extern template class var_data<std::complex<double>, circular_var>;
 extern template class var_data<std::complex<double>, elliptic_var>;
+extern template class var_data<float>;
+extern template class var_data<std::complex<float>, circular_var>;
+extern template class var_data<std::complex<float>, elliptic_var>;
 
 /**
  * Accumulator which tracks the weighted mean and a variance estimate.
@@ -162,6 +165,13 @@ public:
     /** Add computed vector to the accumulator */
     var_acc &operator<<(const computed<T> &src) { add(src, 1, nullptr); return *this; }
 
+    /**
+     * Add sparse computed vector to the accumulator.
+     *
+     * For unit batch size, this only touches the non-zero elements.
+     */
+    var_acc &operator<<(const sparse_computed<T> &src) { add_sparse(src, 1); return *this; }
+
     /** Merge partial result into accumulator */
     var_acc &operator<<(const var_result<T,Strategy> &result);
 
@@ -171,6 +181,15 @@ public:
     /** Returns result corresponding to current state of accumulator */
     var_result<T,Strategy> result() const;
 
+    /**
+     * Stores result corresponding to current state of accumulator in `result`.
+     *
+     * Unlike `result()`, this re-uses the storage of `result` if it already
+     * has the correct size, such that periodic snapshots of a running
+     * accumulator do not allocate memory.
+     */
+    void result_to(var_result<T,Strategy> &result) const { result_to(result, nullptr); }
+
     /** Frees data associated with accumulator and return result */
     var_result<T,Strategy> finalize();
 
@@ -182,10 +201,16 @@ public:
 protected:
     void add(const computed<T> &source, uint64_t count, var_acc *cascade);
 
+    void add_sparse(const sparse_computed<T> &source, uint64_t count);
+
     void add_bundle(var_acc *cascade);
 
+    void add_batch(const column<T> &sum, uint64_t count);
+
     void finalize_to(var_result<T,Strategy> &result, var_acc *cascade);
 
+    void result_to(var_result<T,Strategy> &result, bundle<T> *carry) const;
+
 private:
     std::unique_ptr< var_data<value_type, Strategy> > store_;
     bundle<value_type> current_;
@@ -207,6 +232,9 @@ struct traits< var_acc<T,Strategy> >
 extern template class var_acc<double>;
 extern template class var_acc<std::complex<double>, circular_var>;
 extern template class var_acc<std::complex<double>, elliptic_var>;
+extern template class var_acc<float>;
+extern template class var_acc<std::complex<float>, circular_var>;
+extern template class var_acc<std::complex<float>, elliptic_var>;
 
 /**
  * Result which tracks the weighted mean and a variance estimate.
@@ -319,5 +347,8 @@ struct traits< var_result<T,Strategy> >
 extern template class var_result<double>;
 extern template class var_result<std::complex<double>, circular_var>;
 extern template class var_result<std::complex<double>, elliptic_var>;
+extern template class var_result<float>;
+extern template class var_result<std::complex<float>, circular_var>;
+extern template class var_result<std::complex<float>, elliptic_var>;
 
 }} /* namespace alps::alea */
@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+#include <alps/alea/acf.hpp>
+#include <alps/alea/internal/util.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <type_traits>
+#include <vector>
+
+namespace alps { namespace alea {
+
+namespace {
+
+typedef std::complex<double> cplx;
+typedef std::vector<cplx> fft_buffer;
+
+/** Maximum number of complex numbers in the work buffer of a batch */
+const size_t MAX_BATCH_BUFFER = size_t(1) << 22;
+
+/** Returns `exp(-2 pi i k/n)` for `k = 0, ..., n/2 - 1` */
+fft_buffer fft_twiddles(size_t n)
+{
+    const double pi = std::acos(-1.);
+    fft_buffer twiddle(n / 2);
+    for (size_t k = 0; k != n / 2; ++k)
+        twiddle[k] = std::polar(1.0, -2 * pi * k / n);
+    return twiddle;
+}
+
+/** Complex product without the NaN/inf recovery of `std::complex`, so it vectorizes */
+inline cplx mul(const cplx &a, const cplx &b)
+{
+    return cplx(a.real() * b.real() - a.imag() * b.imag(),
+                a.real() * b.imag() + a.imag() * b.real());
+}
+
+/**
+ * In-place, unnormalized radix-2 FFT of `nb` interleaved series in `buf`.
+ *
+ * Element `s` of series `c` is stored at `buf[s * nb + c]`, such that the
+ * innermost loop runs over the series with unit stride and each twiddle
+ * factor is loaded once for all series.  The length of the series must be a
+ * power of two.  If `inverse` is set, the inverse transform (times the
+ * length) is performed.
+ */
+void fft(fft_buffer &buf, size_t nb, const fft_buffer &twiddle, bool inverse)
+{
+    size_t n = buf.size() / nb;
+
+    // bit-reversal permutation
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            std::swap_ranges(buf.begin() + i * nb, buf.begin() + (i + 1) * nb,
+                             buf.begin() + j * nb);
+        }
+    }
+
+    // butterflies
+    for (size_t len = 2; len <= n; len <<= 1) {
+        size_t half = len / 2, step = n / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k != half; ++k) {
+                cplx w = twiddle[k * step];
+                if (inverse)
+                    w = std::conj(w);
+                cplx *u = &buf[(i + k) * nb];
+                cplx *v = &buf[(i + k + half) * nb];
+                for (size_t c = 0; c != nb; ++c) {
+                    cplx vw = mul(v[c], w);
+                    v[c] = u[c] - vw;
+                    u[c] += vw;
+                }
+            }
+        }
+    }
+}
+
+}
+
+template <typename T>
+typename eigen<double>::matrix autocorr_function(
+                    const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> &series,
+                    size_t max_lag)
+{
+    size_t size = series.rows();
+    size_t n = series.cols();
+    if (n == 0)
+        throw size_mismatch();
+    if (max_lag == 0 || max_lag >= n)
+        max_lag = n - 1;
+
+    // zero-pad to at least 2N to avoid wrap-around of the circular correlation
+    size_t nfft = 1;
+    while (nfft < 2 * n)
+        nfft <<= 1;
+    const fft_buffer twiddle = fft_twiddles(nfft);
+
+    // Real components are packed pairwise into the real and imaginary part of
+    // one complex series, which halves the number of transforms.
+    const bool packed = std::is_floating_point<T>::value;
+    const size_t per_slot = packed ? 2 : 1;
+    const size_t nslots = (size + per_slot - 1) / per_slot;
+    const size_t max_batch = std::max<size_t>(1, MAX_BATCH_BUFFER / nfft);
+
+    std::vector<cplx> mean(size);
+    for (size_t i = 0; i != size; ++i)
+        mean[i] = cplx(series.row(i).mean());
+
+    typename eigen<double>::matrix result(size, max_lag + 1);
+    fft_buffer buf;
+    for (size_t first = 0; first < nslots; first += max_batch) {
+        const size_t nb = std::min(max_batch, nslots - first);
+        buf.assign(nfft * nb, 0.0);
+        for (size_t s = 0; s != n; ++s) {
+            for (size_t c = 0; c != nb; ++c) {
+                size_t i = (first + c) * per_slot;
+                cplx x = cplx(series(i, s)) - mean[i];
+                if (packed && i + 1 != size) {
+                    cplx y = cplx(series(i + 1, s)) - mean[i + 1];
+                    x += cplx(-y.imag(), y.real());
+                }
+                buf[s * nb + c] = x;
+            }
+        }
+
+        // Wiener-Khinchin: autocovariance is the transform of the power
+        fft(buf, nb, twiddle, false);
+        if (packed) {
+            // Z = X + iY with real x, y gives X(k) = (Z(k) + Z*(-k))/2 and
+            // Y(k) = (Z(k) - Z*(-k))/2i.  Both powers are real and even, so
+            // the transform of |X|^2 + i|Y|^2 is Gamma_x + i Gamma_y.
+            for (size_t k = 0; k <= nfft / 2; ++k) {
+                size_t mk = (nfft - k) % nfft;
+                for (size_t c = 0; c != nb; ++c) {
+                    cplx z = buf[k * nb + c], zm = std::conj(buf[mk * nb + c]);
+                    cplx power(0.25 * std::norm(z + zm), 0.25 * std::norm(z - zm));
+                    buf[k * nb + c] = power;
+                    buf[mk * nb + c] = power;
+                }
+            }
+        } else {
+            for (size_t k = 0; k != buf.size(); ++k)
+                buf[k] = std::norm(buf[k]);
+        }
+        fft(buf, nb, twiddle, true);
+
+        // normalization cancels, so we do not bother dividing by N or nfft
+        for (size_t c = 0; c != nb; ++c) {
+            size_t i = (first + c) * per_slot;
+            const double gamma0 = buf[c].real();
+            for (size_t t = 0; t <= max_lag; ++t)
+                result(i, t) = gamma0 != 0 ? buf[t * nb + c].real() / gamma0 : NAN;
+            if (packed && i + 1 != size) {
+                const double gamma0_y = buf[c].imag();
+                for (size_t t = 0; t <= max_lag; ++t)
+                    result(i + 1, t) = gamma0_y != 0 ? buf[t * nb + c].imag() / gamma0_y : NAN;
+            }
+        }
+    }
+    return result;
+}
+
+template eigen<double>::matrix autocorr_function(
+            const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &, size_t);
+template eigen<double>::matrix autocorr_function(
+            const Eigen::Matrix<std::complex<double>, Eigen::Dynamic, Eigen::Dynamic> &,
+            size_t);
+template eigen<double>::matrix autocorr_function(
+            const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic> &, size_t);
+template eigen<double>::matrix autocorr_function(
+            const Eigen::Matrix<std::complex<float>, Eigen::Dynamic, Eigen::Dynamic> &,
+            size_t);
+
+template <typename T>
+typename eigen<double>::matrix autocorr_function(const batch_result<T> &result,
+                                                 size_t max_lag)
+{
+    internal::check_valid(result);
+    const batch_data<T> &store = result.store();
+
+    // the hopper re-uses freed slots, so recover the time order from offsets
+    std::vector<size_t> order;
+    for (size_t i = 0; i != store.num_batches(); ++i) {
+        if (store.count()(i) != 0)
+            order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+        [&store](size_t a, size_t b) { return store.offset()(a) < store.offset()(b); });
+
+    Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> means(result.size(), order.size());
+    for (size_t j = 0; j != order.size(); ++j) {
+        means.col(j) = store.batch().col(order[j])
+                       / typename make_real<T>::type(store.count()(order[j]));
+    }
+    return autocorr_function(means, max_lag);
+}
+
+template eigen<double>::matrix autocorr_function(const batch_result<double> &, size_t);
+template eigen<double>::matrix autocorr_function(
+            const batch_result<std::complex<double> > &, size_t);
+template eigen<double>::matrix autocorr_function(const batch_result<float> &, size_t);
+template eigen<double>::matrix autocorr_function(
+            const batch_result<std::complex<float> > &, size_t);
+
+std::vector<size_t> sokal_window(const eigen<double>::matrix &acf, double c)
+{
+    if (acf.cols() == 0)
+        throw size_mismatch();
+
+    size_t max_lag = acf.cols() - 1;
+    std::vector<size_t> window(acf.rows());
+    for (size_t i = 0; i != (size_t)acf.rows(); ++i) {
+        double tau_int = 0.5;
+        size_t m = 1;
+        for (; m <= max_lag; ++m) {
+            tau_int += acf(i, m);
+            if (m >= c * tau_int)
+                break;
+        }
+        window[i] = std::min(m, max_lag);
+    }
+    return window;
+}
+
+column<double> sokal_tau(const eigen<double>::matrix &acf, double c)
+{
+    std::vector<size_t> window = sokal_window(acf, c);
+
+    column<double> tau(acf.rows());
+    for (size_t i = 0; i != (size_t)acf.rows(); ++i)
+        tau(i) = acf.row(i).segment(1, window[i]).sum();
+    return tau;
+}
+
+}}
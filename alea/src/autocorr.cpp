@@ -82,28 +82,78 @@ template <typename T>
 autocorr_acc<T> &autocorr_acc<T>::operator<<(const autocorr_result<T> &other)
 {
     internal::check_valid(*this);
+    internal::check_valid(other);
+    if (size() != other.size())
+        throw size_mismatch();
+    if (other.count() == 0)
+        return *this;
+
+    // The batches of the other result must fit into the batches of the
+    // corresponding level.  (The average batch size of a finalized level is
+    // smaller than the nominal one because of partially filled batches.)
+    uint64_t nominal_size = batch_size_;
+    for (size_t i = 0; i != other.nlevel(); ++i) {
+        if (other.level(i).batch_size() > nominal_size)
+            throw size_mismatch();
+        nominal_size *= granularity_;
+    }
 
-    // ensure we have enough levels to hold other data
-    for (size_t i = nlevel(); i < other.nlevel(); ++i)
-        level_.push_back(var_acc<T>(size_, batch_size_));
+    // Grow the hierarchy such that it can hold the combined time series.
+    // Since the top level never holds a completed batch, the new levels are
+    // consistent with the data already accumulated.
+    count_ += other.count();
+    while (count_ >= nextlevel_ || nlevel() < other.nlevel())
+        add_level();
 
-    // merge the levels
-    // FIXME handle the highers other level by doing proper mergin
+    // Every level of a finalized result contains the full time series, where
+    // left-over data was propagated upwards as partially filled batches.  We
+    // can thus merge level by level, as the batch sizes coincide.
     for (size_t i = 0; i != other.nlevel(); ++i)
         level_[i] << other.level(i);
 
+    // On the remaining levels, the other time series does not fill even a
+    // single batch: add it as one partially filled batch, which is exactly
+    // what finalize() does with the left-over data on the top level.
+    if (other.nlevel() < nlevel()) {
+        const column<T> other_sum = other.mean() * double(other.count());
+        for (size_t i = other.nlevel(); i != nlevel(); ++i)
+            level_[i].add_batch(other_sum, other.count());
+    }
     return *this;
 }
 
 template <typename T>
 autocorr_result<T> autocorr_acc<T>::result() const
 {
-    internal::check_valid(*this);
     autocorr_result<T> result;
-    autocorr_acc<T>(*this).finalize_to(result);
+    result_to(result);
     return result;
 }
 
+template <typename T>
+void autocorr_acc<T>::result_to(autocorr_result<T> &result) const
+{
+    bundle<T> carry(size_, batch_size_);
+    result_to(result, carry);
+}
+
+template <typename T>
+void autocorr_acc<T>::result_to(autocorr_result<T> &result, bundle<T> &carry) const
+{
+    internal::check_valid(*this);
+    result.level_.resize(level_.size());
+
+    // Equivalent to finalize_to(), but rather than cascading the left-over
+    // data upwards through the levels, they are collected in a carry: in
+    // bottom-up order, each level adds its current batch to the carry and
+    // the carry as a single partially filled batch to its own result.
+    if (carry.size() != size_)
+        carry = bundle<T>(size_, batch_size_);
+    carry.reset();
+    for (size_t i = 0; i != level_.size(); ++i)
+        level_[i].result_to(result.level_[i], &carry);
+}
+
 template <typename T>
 autocorr_result<T> autocorr_acc<T>::finalize()
 {
@@ -131,6 +181,8 @@ void autocorr_acc<T>::finalize_to(autocorr_result<T> &result)
 
 template class autocorr_acc<double>;
 template class autocorr_acc<std::complex<double> >;
+template class autocorr_acc<float>;
+template class autocorr_acc<std::complex<float> >;
 
 template <typename T>
 bool operator==(const autocorr_result<T> &r1, const autocorr_result<T> &r2)
@@ -147,6 +199,10 @@ template bool operator==(const autocorr_result<double> &r1,
                          const autocorr_result<double> &r2);
 template bool operator==(const autocorr_result<std::complex<double>> &r1,
                          const autocorr_result<std::complex<double>> &r2);
+template bool operator==(const autocorr_result<float> &r1,
+                         const autocorr_result<float> &r2);
+template bool operator==(const autocorr_result<std::complex<float>> &r1,
+                         const autocorr_result<std::complex<float>> &r2);
 
 template <typename T>
 uint64_t autocorr_result<T>::batch_size(size_t i) const
@@ -244,6 +300,8 @@ void autocorr_result<T>::reduce(const reducer &r, bool pre_commit, bool post_com
 
 template class autocorr_result<double>;
 template class autocorr_result<std::complex<double> >;
+template class autocorr_result<float>;
+template class autocorr_result<std::complex<float> >;
 
 
 template <typename T>
@@ -288,16 +346,20 @@ void deserialize(deserializer &s, const std::string &key, autocorr_result<T> &se
 
     scalar_size = self.size();
     s.enter("mean");
-    s.read("value", ndview<T>(nullptr, &scalar_size, 1)); // discard
-    s.read("error", ndview<var_type>(nullptr, &scalar_size, 1)); // discard
+    s.read("value", ndview<internal::serialized_scalar_t<T>>(nullptr, &scalar_size, 1)); // discard
+    s.read("error", ndview<internal::serialized_scalar_t<var_type>>(nullptr, &scalar_size, 1)); // discard
     s.exit();
 }
 
 template void serialize(serializer &, const std::string &key, const autocorr_result<double> &);
 template void serialize(serializer &, const std::string &key, const autocorr_result<std::complex<double>> &);
+template void serialize(serializer &, const std::string &key, const autocorr_result<float> &);
+template void serialize(serializer &, const std::string &key, const autocorr_result<std::complex<float>> &);
 
 template void deserialize(deserializer &, const std::string &key, autocorr_result<double> &);
 template void deserialize(deserializer &, const std::string &key, autocorr_result<std::complex<double> > &);
+template void deserialize(deserializer &, const std::string &key, autocorr_result<float> &);
+template void deserialize(deserializer &, const std::string &key, autocorr_result<std::complex<float> > &);
 
 template <typename T>
 std::ostream &operator<<(std::ostream &str, const autocorr_result<T> &self)
@@ -320,6 +382,8 @@ std::ostream &operator<<(std::ostream &str, const autocorr_result<T> &self)
 
 template std::ostream &operator<<(std::ostream &, const autocorr_result<double> &);
 template std::ostream &operator<<(std::ostream &, const autocorr_result<std::complex<double>> &);
+template std::ostream &operator<<(std::ostream &, const autocorr_result<float> &);
+template std::ostream &operator<<(std::ostream &, const autocorr_result<std::complex<float>> &);
 
 }}
 
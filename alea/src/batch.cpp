@@ -11,7 +11,9 @@
 #include <alps/alea/internal/util.hpp>
 #include <alps/alea/internal/format.hpp>
 
+#include <algorithm>
 #include <numeric>
+#include <thread>
 
 namespace alps { namespace alea {
 
@@ -19,6 +21,7 @@ template <typename T>
 batch_data<T>::batch_data(size_t size, size_t num_batches)
     : batch_(size, num_batches)
     , count_(num_batches)
+    , offset_(num_batches)
 {
     reset();
 }
@@ -28,10 +31,32 @@ void batch_data<T>::reset()
 {
     batch_.fill(0);
     count_.fill(0);
+
+    // without further information, assume batches are in time order
+    for (size_t i = 0; i != num_batches(); ++i)
+        offset_(i) = i;
+}
+
+namespace {
+
+/** Returns the indices of the batches of `store` in time order */
+template <typename T>
+std::vector<size_t> time_order(const batch_data<T> &store)
+{
+    // The hopper re-uses freed slots, so recover the time order from offsets
+    std::vector<size_t> order(store.num_batches());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+        [&store](size_t a, size_t b) { return store.offset()(a) < store.offset()(b); });
+    return order;
+}
+
 }
 
 template class batch_data<double>;
 template class batch_data<std::complex<double> >;
+template class batch_data<float>;
+template class batch_data<std::complex<float> >;
 
 
 template <typename T>
@@ -41,14 +66,13 @@ batch_acc<T>::batch_acc(size_t size, size_t num_batches, uint64_t base_size)
     , base_size_(base_size)
     , store_(new batch_data<T>(size, num_batches))
     , cursor_(num_batches)
-    , offset_(num_batches)
 {
     if (num_batches % 2 != 0) {
         throw std::runtime_error("Number of batches must be even to allow "
                                  "for rebatching.");
     }
     for (size_t i = 0; i != num_batches; ++i)
-        offset_[i] = i * base_size_;
+        store_->offset()(i) = i * base_size_;
 }
 
 template <typename T>
@@ -58,7 +82,6 @@ batch_acc<T>::batch_acc(const batch_acc &other)
     , base_size_(other.base_size_)
     , store_(other.store_ ? new batch_data<T>(*other.store_) : nullptr)
     , cursor_(other.cursor_)
-    , offset_(other.offset_)
 { }
 
 template <typename T>
@@ -69,7 +92,6 @@ batch_acc<T> &batch_acc<T>::operator=(const batch_acc &other)
     base_size_ = other.base_size_;
     store_.reset(other.store_ ? new batch_data<T>(*other.store_) : nullptr);
     cursor_ = other.cursor_;
-    offset_ = other.offset_;
     return *this;
 }
 
@@ -77,13 +99,13 @@ template <typename T>
 void batch_acc<T>::reset()
 {
     cursor_.reset();
-    for (size_t i = 0; i != num_batches_; ++i)
-        offset_[i] = i * base_size_;
-
     if (valid())
         store_->reset();
     else
         store_.reset(new batch_data<T>(size_, num_batches_));
+
+    for (size_t i = 0; i != num_batches_; ++i)
+        store_->offset()(i) = i * base_size_;
 }
 
 template <typename T>
@@ -134,16 +156,26 @@ template <typename T>
 batch_acc<T> &batch_acc<T>::operator<<(const batch_result<T> &other)
 {
     internal::check_valid(*this);
+    internal::check_valid(other);
     if (size() != other.size())
         throw size_mismatch();
-    // TODO this is not strictly speaking necessary when done properly
-    if (num_batches() != other.num_batches())
-        throw size_mismatch();
 
-    // FIXME: this is a terrible idea because it mixes two time series
-    batch_data<T> &other_store = const_cast<batch_data<T> &>(other.store());
-    store_->batch() += other_store.batch();
-    store_->count() += other_store.count();
+    // The other result is an independent time series, so we append its
+    // batches after ours rather than adding them column by column (which
+    // would mix the two series).  Start a fresh batch such that no batch
+    // but the one at the seam may contain data from both series.
+    if (store_->count()(cursor_.current()) != 0)
+        next_batch();
+
+    // Each batch of the other series is added as a whole, in time order,
+    // letting the cursor rebatch as needed.  This preserves the number of
+    // batches and is independent of the number of batches of the other result.
+    const batch_data<T> &other_store = other.store();
+    for (size_t i : time_order(other_store)) {
+        if (other_store.count()(i) == 0)
+            continue;
+        add(make_adapter(other_store.batch().col(i)), other_store.count()(i));
+    }
     return *this;
 }
 
@@ -162,10 +194,14 @@ void batch_acc<T>::next_batch()
         store_->batch().col(cursor_.current()).fill(0);
 
         // merge offsets
-        offset_(cursor_.merge_into()) = std::min(offset_(cursor_.merge_into()),
-                                                 offset_(cursor_.current()));
-        offset_(cursor_.current()) = count();
+        typename eigen<uint64_t>::row &offset = store_->offset();
+        offset(cursor_.merge_into()) = std::min(offset(cursor_.merge_into()),
+                                                offset(cursor_.current()));
     }
+
+    // the new batch starts after all data so far, also if whole batches
+    // were added by merging a result
+    store_->offset()(cursor_.current()) = count();
 }
 
 template <typename T>
@@ -176,6 +212,17 @@ batch_result<T> batch_acc<T>::result() const
     return result;
 }
 
+template <typename T>
+void batch_acc<T>::result_to(batch_result<T> &result) const
+{
+    internal::check_valid(*this);
+    if (!result.valid() || result.size() != size()
+            || result.num_batches() != store_->num_batches())
+        result.store_.reset(new batch_data<T>(size(), store_->num_batches()));
+
+    *result.store_ = *store_;
+}
+
 template <typename T>
 batch_result<T> batch_acc<T>::finalize()
 {
@@ -194,6 +241,8 @@ void batch_acc<T>::finalize_to(batch_result<T> &result)
 
 template class batch_acc<double>;
 template class batch_acc<std::complex<double> >;
+template class batch_acc<float>;
+template class batch_acc<std::complex<float> >;
 
 
 template <typename T>
@@ -211,14 +260,28 @@ batch_result<T> &batch_result<T>::operator=(const batch_result &other)
 template <typename T>
 bool operator==(const batch_result<T> &r1, const batch_result<T> &r2)
 {
-    return r1.count() == r2.count()
-        && r1.store().batch() == r2.store().batch();
+    if (r1.count() != r2.count() || r1.num_batches() != r2.num_batches())
+        return false;
+
+    // batches may be stored in different slots, so compare them in time order
+    std::vector<size_t> order1 = time_order(r1.store());
+    std::vector<size_t> order2 = time_order(r2.store());
+    for (size_t i = 0; i != order1.size(); ++i) {
+        if (r1.store().count()(order1[i]) != r2.store().count()(order2[i])
+                || r1.store().batch().col(order1[i]) != r2.store().batch().col(order2[i]))
+            return false;
+    }
+    return true;
 }
 
 template bool operator==(const batch_result<double> &r1,
                          const batch_result<double> &r2);
 template bool operator==(const batch_result<std::complex<double>> &r1,
                          const batch_result<std::complex<double>> &r2);
+template bool operator==(const batch_result<float> &r1,
+                         const batch_result<float> &r2);
+template bool operator==(const batch_result<std::complex<float>> &r1,
+                         const batch_result<std::complex<float>> &r2);
 
 template <typename T>
 column<T> batch_result<T>::mean() const
@@ -259,10 +322,93 @@ column<typename bind<circular_var,T>::var_type> batch_result<T>::stderror() cons
     return aux_acc.finalize().stderror();
 }
 
+namespace {
+
+/** Minimum number of components handled by each thread in rebatch() */
+const size_t REBATCH_MIN_ROWS = 256;
+
+}
+
+template <typename T>
+std::vector<batch_result<T> > batch_result<T>::rebatch(
+                const std::vector<size_t> &num_batches, size_t nthreads) const
+{
+    internal::check_valid(*this);
+    const batch_data<T> &fine = *store_;
+    const size_t nfine = fine.num_batches(), ncoarse = num_batches.size();
+    for (size_t j = 0; j != ncoarse; ++j) {
+        if (num_batches[j] == 0 || num_batches[j] > nfine)
+            throw size_mismatch();
+    }
+
+    std::vector<size_t> order = time_order(fine);
+
+    // Assign each batch to the coarse batch containing its midpoint.  Since
+    // this is monotonic in time, the coarse batches are compact again.
+    std::vector<batch_result> result;
+    result.reserve(ncoarse);
+    std::vector<size_t> target(nfine * ncoarse);
+    const double total = count();
+    for (size_t j = 0; j != ncoarse; ++j) {
+        result.emplace_back(batch_data<T>(size(), num_batches[j]));
+        batch_data<T> &coarse = *result[j].store_;
+
+        uint64_t start = 0;
+        for (size_t i : order) {
+            uint64_t curr = fine.count()(i);
+            if (curr == 0)
+                continue;
+
+            size_t k = (start + 0.5 * curr) / total * num_batches[j];
+            k = std::min(k, num_batches[j] - 1);
+            target[i * ncoarse + j] = k;
+            if (coarse.count()(k) == 0)
+                coarse.offset()(k) = fine.offset()(i);
+            coarse.count()(k) += curr;
+            start += curr;
+        }
+    }
+
+    // Each batch is read once and added to all batchings while it is hot in
+    // cache.  Different ranges of components are independent, so we can split
+    // them among threads without any synchronization.
+    auto add_rows = [&](size_t row_start, size_t nrows) {
+        for (size_t i : order) {
+            if (fine.count()(i) == 0)
+                continue;
+            for (size_t j = 0; j != ncoarse; ++j) {
+                result[j].store_->batch().col(target[i * ncoarse + j])
+                        .segment(row_start, nrows)
+                        += fine.batch().col(i).segment(row_start, nrows);
+            }
+        }
+    };
+
+    if (nthreads == 0) {
+        nthreads = std::min<size_t>(std::thread::hardware_concurrency(),
+                                    size() / REBATCH_MIN_ROWS);
+    }
+    nthreads = std::max<size_t>(std::min(nthreads, size()), 1);
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < nthreads; ++t) {
+        size_t row_start = t * size() / nthreads;
+        size_t row_stop = (t + 1) * size() / nthreads;
+        workers.emplace_back(add_rows, row_start, row_stop - row_start);
+    }
+    add_rows(0, size() / nthreads);
+    for (size_t t = 0; t != workers.size(); ++t)
+        workers[t].join();
+
+    return result;
+}
+
 template <typename T>
 void batch_result<T>::reduce(const reducer &r, bool pre_commit, bool post_commit)
 {
     // FIXME this is bad since it mixes bins
+    // The offsets are kept, which is consistent as long as all instances
+    // have accumulated the same number of batches.
     internal::check_valid(*this);
     if (pre_commit) {
         r.reduce(view<T>(store_->batch().data(), store_->batch().size()));
@@ -281,13 +427,21 @@ void batch_result<T>::reduce(const reducer &r, bool pre_commit, bool post_commit
 template column<double> batch_result<double>::var<circular_var>() const;
 template column<double> batch_result<std::complex<double> >::var<circular_var>() const;
 template column<complex_op<double> > batch_result<std::complex<double> >::var<elliptic_var>() const;
+template column<float> batch_result<float>::var<circular_var>() const;
+template column<float> batch_result<std::complex<float> >::var<circular_var>() const;
+template column<complex_op<float> > batch_result<std::complex<float> >::var<elliptic_var>() const;
 
 template eigen<double>::matrix batch_result<double>::cov< circular_var>() const;
 template eigen<std::complex<double>>::matrix batch_result<std::complex<double> >::cov<circular_var>() const;
 template eigen<complex_op<double> >::matrix batch_result<std::complex<double> >::cov<elliptic_var>() const;
+template eigen<float>::matrix batch_result<float>::cov< circular_var>() const;
+template eigen<std::complex<float>>::matrix batch_result<std::complex<float> >::cov<circular_var>() const;
+template eigen<complex_op<float> >::matrix batch_result<std::complex<float> >::cov<elliptic_var>() const;
 
 template class batch_result<double>;
 template class batch_result<std::complex<double> >;
+template class batch_result<float>;
+template class batch_result<std::complex<float> >;
 
 
 template <typename T>
@@ -300,9 +454,24 @@ void serialize(serializer &s, const std::string &key, const batch_result<T> &sel
     serialize(s, "@size", static_cast<uint64_t>(self.size()));
     serialize(s, "@num_batches", static_cast<uint64_t>(self.store().num_batches()));
 
+    // The hopper re-uses freed slots, so write the batches in time order.
+    // This allows deserialize() to recover the offsets from the counts.
+    const batch_data<T> &store = self.store();
+    std::vector<size_t> order = time_order(store);
     s.enter("batch");
-    serialize(s, "count", self.store().count());
-    serialize(s, "sum", self.store().batch());
+    if (std::is_sorted(order.begin(), order.end())) {
+        serialize(s, "count", store.count());
+        serialize(s, "sum", store.batch());
+    } else {
+        typename eigen<uint64_t>::row count(order.size());
+        typename eigen<T>::matrix batch(self.size(), order.size());
+        for (size_t i = 0; i != order.size(); ++i) {
+            count(i) = store.count()(order[i]);
+            batch.col(i) = store.batch().col(order[i]);
+        }
+        serialize(s, "count", count);
+        serialize(s, "sum", batch);
+    }
     s.exit();
 
     s.enter("mean");
@@ -330,18 +499,29 @@ void deserialize(deserializer &s, const std::string &key, batch_result<T> &self)
     deserialize(s, "sum", self.store().batch());
     s.exit();
 
+    // batches are stored in time order, so the offsets follow from the counts
+    uint64_t offset = 0;
+    for (size_t i = 0; i != new_nbatches; ++i) {
+        self.store().offset()(i) = offset;
+        offset += self.store().count()(i);
+    }
+
     size_t new_size_sizet = new_size;
     s.enter("mean");
-    s.read("value", ndview<T>(nullptr, &new_size_sizet, 1)); // discard
-    s.read("error", ndview<var_type>(nullptr, &new_size_sizet, 1)); // discard
+    s.read("value", ndview<internal::serialized_scalar_t<T>>(nullptr, &new_size_sizet, 1)); // discard
+    s.read("error", ndview<internal::serialized_scalar_t<var_type>>(nullptr, &new_size_sizet, 1)); // discard
     s.exit();
 }
 
 template void serialize(serializer &, const std::string &key, const batch_result<double> &);
 template void serialize(serializer &, const std::string &key, const batch_result<std::complex<double>> &);
+template void serialize(serializer &, const std::string &key, const batch_result<float> &);
+template void serialize(serializer &, const std::string &key, const batch_result<std::complex<float>> &);
 
 template void deserialize(deserializer &, const std::string &key, batch_result<double> &);
 template void deserialize(deserializer &, const std::string &key, batch_result<std::complex<double> > &);
+template void deserialize(deserializer &, const std::string &key, batch_result<float> &);
+template void deserialize(deserializer &, const std::string &key, batch_result<std::complex<float> > &);
 
 template <typename T>
 std::ostream &operator<<(std::ostream &str, const batch_result<T> &self)
@@ -363,5 +543,7 @@ std::ostream &operator<<(std::ostream &str, const batch_result<T> &self)
 
 template std::ostream &operator<<(std::ostream &, const batch_result<double> &);
 template std::ostream &operator<<(std::ostream &, const batch_result<std::complex<double>> &);
+template std::ostream &operator<<(std::ostream &, const batch_result<float> &);
+template std::ostream &operator<<(std::ostream &, const batch_result<std::complex<float>> &);
 
 }} /* namespace alps::alea */
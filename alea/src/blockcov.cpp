@@ -0,0 +1,504 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+#include <alps/alea/blockcov.hpp>
+#include <alps/alea/serialize.hpp>
+
+#include <alps/alea/internal/outer.hpp>
+#include <alps/alea/internal/util.hpp>
+#include <alps/alea/internal/format.hpp>
+
+#include <numeric>
+
+namespace alps { namespace alea {
+
+std::vector<size_t> uniform_blocks(size_t size, size_t block_size)
+{
+    if (block_size == 0)
+        throw std::invalid_argument("Block size must be positive");
+
+    std::vector<size_t> result(size / block_size, block_size);
+    if (size % block_size != 0)
+        result.push_back(size % block_size);
+    return result;
+}
+
+template <typename T, typename Str>
+blockcov_data<T,Str>::blockcov_data(const std::vector<size_t> &block_sizes)
+    : data_(std::accumulate(block_sizes.begin(), block_sizes.end(), size_t(0)))
+    , data2_()
+    , offset_()
+{
+    size_t offset = 0;
+    for (size_t block_size : block_sizes) {
+        offset_.push_back(offset);
+        data2_.push_back(cov_matrix_type(block_size, block_size));
+        offset += block_size;
+    }
+    reset();
+}
+
+template <typename T, typename Str>
+std::vector<size_t> blockcov_data<T,Str>::block_sizes() const
+{
+    std::vector<size_t> result(nblocks());
+    for (size_t i = 0; i != nblocks(); ++i)
+        result[i] = block_size(i);
+    return result;
+}
+
+template <typename T, typename Str>
+void blockcov_data<T,Str>::reset()
+{
+    data_.fill(0);
+    for (cov_matrix_type &block : data2_)
+        block.fill(0);
+    count_ = 0;
+    count2_ = 0;
+}
+
+template <typename T, typename Str>
+void blockcov_data<T,Str>::convert_to_mean()
+{
+    data_ /= count_;
+
+    // In case of zero unbiased information, the variance is infinite.
+    // However, data2_ is 0 in this case as well, so we need to handle it
+    // specially to avoid 0/0 = nan while propagating intrinsic NaN's.
+    const double nunbiased = count_ - count2_/count_;
+    for (size_t i = 0; i != nblocks(); ++i) {
+        auto mean = data_.segment(block_offset(i), block_size(i));
+        data2_[i] -= count_ * internal::outer<bind<Str, T> >(mean, mean);
+
+        if (nunbiased == 0)
+            data2_[i] = data2_[i].array().isNaN().select(data2_[i], INFINITY);
+        else
+            // HACK: this is written in out-of-place notation to work around Eigen
+            data2_[i] = data2_[i] / nunbiased;
+    }
+}
+
+template <typename T, typename Str>
+void blockcov_data<T,Str>::convert_to_sum()
+{
+    // "empty" sets must be handled specially here because of NaNs
+    if (count_ == 0) {
+        reset();
+        return;
+    }
+
+    // Care must be taken again for zero unbiased info since inf/0 is NaN.
+    const double nunbiased = count_ - count2_/count_;
+    for (size_t i = 0; i != nblocks(); ++i) {
+        if (nunbiased == 0)
+            data2_[i] = data2_[i].array().isNaN().select(data2_[i], 0);
+        else
+            data2_[i] = data2_[i] * nunbiased;
+
+        auto mean = data_.segment(block_offset(i), block_size(i));
+        data2_[i] += count_ * internal::outer<bind<Str, T> >(mean, mean);
+    }
+    data_ *= count_;
+}
+
+template class blockcov_data<double>;
+template class blockcov_data<std::complex<double>, circular_var>;
+template class blockcov_data<std::complex<double>, elliptic_var>;
+template class blockcov_data<float>;
+template class blockcov_data<std::complex<float>, circular_var>;
+template class blockcov_data<std::complex<float>, elliptic_var>;
+
+
+template <typename T, typename Str>
+blockcov_acc<T,Str>::blockcov_acc(size_t size, uint64_t batch_size)
+    : block_sizes_(1, size)
+    , store_(new blockcov_data<T,Str>(block_sizes_))
+    , current_(size, batch_size)
+{ }
+
+template <typename T, typename Str>
+blockcov_acc<T,Str>::blockcov_acc(const std::vector<size_t> &block_sizes,
+                                  uint64_t batch_size)
+    : block_sizes_(block_sizes)
+    , store_(new blockcov_data<T,Str>(block_sizes_))
+    , current_(store_->size(), batch_size)
+{ }
+
+// We need an explicit copy constructor, as we need to copy the data
+template <typename T, typename Str>
+blockcov_acc<T,Str>::blockcov_acc(const blockcov_acc &other)
+    : block_sizes_(other.block_sizes_)
+    , store_(other.store_ ? new blockcov_data<T,Str>(*other.store_) : nullptr)
+    , current_(other.current_)
+{ }
+
+template <typename T, typename Str>
+blockcov_acc<T,Str> &blockcov_acc<T,Str>::operator=(const blockcov_acc &other)
+{
+    block_sizes_ = other.block_sizes_;
+    store_.reset(other.store_ ? new blockcov_data<T,Str>(*other.store_) : nullptr);
+    current_ = other.current_;
+    return *this;
+}
+
+template <typename T, typename Str>
+void blockcov_acc<T,Str>::reset()
+{
+    current_.reset();
+    if (valid())
+        store_->reset();
+    else
+        store_.reset(new blockcov_data<T,Str>(block_sizes_));
+}
+
+template <typename T, typename Str>
+void blockcov_acc<T,Str>::set_blocks(const std::vector<size_t> &block_sizes)
+{
+    block_sizes_ = block_sizes;
+    size_t size = std::accumulate(block_sizes.begin(), block_sizes.end(), size_t(0));
+    current_ = bundle<T>(size, current_.target());
+    if (valid())
+        store_.reset(new blockcov_data<T,Str>(block_sizes_));
+}
+
+template <typename T, typename Str>
+void blockcov_acc<T,Str>::set_batch_size(uint64_t batch_size)
+{
+    // TODO: allow resizing with reset
+    current_.target() = batch_size;
+    current_.reset();
+}
+
+template <typename T, typename Str>
+void blockcov_acc<T,Str>::add(const computed<value_type> &source, uint64_t count)
+{
+    internal::check_valid(*this);
+    source.add_to(view<T>(current_.sum().data(), current_.size()));
+    current_.count() += count;
+
+    if (current_.is_full())
+        add_bundle();
+}
+
+template <typename T, typename Str>
+blockcov_acc<T,Str> &blockcov_acc<T,Str>::operator<<(const blockcov_result<T,Str> &other)
+{
+    internal::check_valid(*this);
+    if (size() != other.size() || block_sizes_ != other.store().block_sizes())
+        throw size_mismatch();
+
+    // NOTE partial sums are unchanged
+    // HACK we need this for "outwardly constant" manipulation
+    blockcov_data<T,Str> &other_store = const_cast<blockcov_data<T,Str> &>(other.store());
+    other_store.convert_to_sum();
+    store_->data() += other_store.data();
+    for (size_t i = 0; i != nblocks(); ++i)
+        store_->data2(i) += other_store.data2(i);
+    store_->count() += other_store.count();
+    store_->count2() += other_store.count2();
+    other_store.convert_to_mean();
+    return *this;
+}
+
+template <typename T, typename Str>
+blockcov_result<T,Str> blockcov_acc<T,Str>::result() const
+{
+    blockcov_result<T,Str> result;
+    result_to(result);
+    return result;
+}
+
+template <typename T, typename Str>
+void blockcov_acc<T,Str>::result_to(blockcov_result<T,Str> &result) const
+{
+    internal::check_valid(*this);
+    bool same_blocks = result.valid() && result.nblocks() == nblocks();
+    for (size_t i = 0; same_blocks && i != nblocks(); ++i)
+        same_blocks = result.store_->block_size(i) == block_sizes_[i];
+    if (!same_blocks)
+        result.store_.reset(new blockcov_data<T,Str>(block_sizes_));
+
+    // copy data without re-allocation
+    blockcov_data<T,Str> &res_store = *result.store_;
+    res_store = *store_;
+
+    // add leftover data as in add_bundle()
+    if (current_.count() != 0) {
+        res_store.data().noalias() += current_.sum();
+        for (size_t i = 0; i != nblocks(); ++i) {
+            auto sum = current_.sum().segment(res_store.block_offset(i),
+                                              res_store.block_size(i));
+            res_store.data2(i).noalias() +=
+                        internal::outer<bind<Str, T> >(sum, sum) / current_.count();
+        }
+        res_store.count() += current_.count();
+        res_store.count2() += current_.count() * current_.count();
+    }
+
+    res_store.convert_to_mean();
+}
+
+template <typename T, typename Str>
+blockcov_result<T,Str> blockcov_acc<T,Str>::finalize()
+{
+    blockcov_result<T,Str> result;
+    finalize_to(result);
+    return result;
+}
+
+template <typename T, typename Str>
+void blockcov_acc<T,Str>::finalize_to(blockcov_result<T,Str> &result)
+{
+    internal::check_valid(*this);
+
+    // add leftover data to the covariance.
+    if (current_.count() != 0)
+        add_bundle();
+
+    // swap data with result
+    result.store_.reset();
+    result.store_.swap(store_);
+
+    // post-process data
+    result.store_->convert_to_mean();
+}
+
+template <typename T, typename Str>
+void blockcov_acc<T,Str>::add_bundle()
+{
+    // add batch to average and squared, where the latter is only updated
+    // within each block
+    store_->data().noalias() += current_.sum();
+    for (size_t i = 0; i != nblocks(); ++i) {
+        auto sum = current_.sum().segment(store_->block_offset(i),
+                                          store_->block_size(i));
+        store_->data2(i).noalias() +=
+                    internal::outer<bind<Str, T> >(sum, sum) / current_.count();
+    }
+    store_->count() += current_.count();
+    store_->count2() += current_.count() * current_.count();
+
+    current_.reset();
+}
+
+template class blockcov_acc<double>;
+template class blockcov_acc<std::complex<double>, circular_var>;
+template class blockcov_acc<std::complex<double>, elliptic_var>;
+template class blockcov_acc<float>;
+template class blockcov_acc<std::complex<float>, circular_var>;
+template class blockcov_acc<std::complex<float>, elliptic_var>;
+
+
+// We need an explicit copy constructor, as we need to copy the data
+template <typename T, typename Str>
+blockcov_result<T,Str>::blockcov_result(const blockcov_result &other)
+    : store_(other.store_ ? new blockcov_data<T,Str>(*other.store_) : nullptr)
+{ }
+
+template <typename T, typename Str>
+blockcov_result<T,Str> &blockcov_result<T,Str>::operator=(const blockcov_result &other)
+{
+    store_.reset(other.store_ ? new blockcov_data<T,Str>(*other.store_) : nullptr);
+    return *this;
+}
+
+template <typename T, typename Strategy>
+bool operator==(const blockcov_result<T,Strategy> &r1,
+                const blockcov_result<T,Strategy> &r2)
+{
+    if (r1.count() == 0 && r2.count() == 0)
+        return true;
+
+    if (r1.count() != r2.count()
+            || r1.count2() != r2.count2()
+            || r1.store().block_sizes() != r2.store().block_sizes()
+            || r1.store().data() != r2.store().data())
+        return false;
+
+    for (size_t i = 0; i != r1.nblocks(); ++i) {
+        if (r1.block_cov(i) != r2.block_cov(i))
+            return false;
+    }
+    return true;
+}
+
+template bool operator==(const blockcov_result<double> &r1,
+                         const blockcov_result<double> &r2);
+template bool operator==(const blockcov_result<std::complex<double>, circular_var> &r1,
+                         const blockcov_result<std::complex<double>, circular_var> &r2);
+template bool operator==(const blockcov_result<std::complex<double>, elliptic_var> &r1,
+                         const blockcov_result<std::complex<double>, elliptic_var> &r2);
+template bool operator==(const blockcov_result<float> &r1,
+                         const blockcov_result<float> &r2);
+template bool operator==(const blockcov_result<std::complex<float>, circular_var> &r1,
+                         const blockcov_result<std::complex<float>, circular_var> &r2);
+template bool operator==(const blockcov_result<std::complex<float>, elliptic_var> &r1,
+                         const blockcov_result<std::complex<float>, elliptic_var> &r2);
+
+template <typename T, typename Str>
+column<typename blockcov_result<T,Str>::var_type> blockcov_result<T,Str>::var() const
+{
+    internal::check_valid(*this);
+    column<var_type> result(size());
+    for (size_t i = 0; i != nblocks(); ++i) {
+        result.segment(store_->block_offset(i), store_->block_size(i)) =
+                                    store_->data2(i).diagonal().real();
+    }
+    return result;
+}
+
+template <typename T, typename Str>
+typename blockcov_result<T,Str>::cov_matrix_type blockcov_result<T,Str>::cov() const
+{
+    internal::check_valid(*this);
+    cov_matrix_type result = cov_matrix_type::Zero(size(), size());
+    for (size_t i = 0; i != nblocks(); ++i) {
+        size_t offset = store_->block_offset(i), block_size = store_->block_size(i);
+        result.block(offset, offset, block_size, block_size) = store_->data2(i);
+    }
+    return result;
+}
+
+template <typename T, typename Str>
+column<typename blockcov_result<T,Str>::var_type> blockcov_result<T,Str>::stderror() const
+{
+    internal::check_valid(*this);
+    return (var() / observations()).cwiseSqrt();
+}
+
+template <typename T, typename Str>
+void blockcov_result<T,Str>::reduce(const reducer &r, bool pre_commit, bool post_commit)
+{
+    internal::check_valid(*this);
+
+    if (pre_commit) {
+        store_->convert_to_sum();
+        r.reduce(view<T>(store_->data().data(), store_->data().rows()));
+        for (size_t i = 0; i != nblocks(); ++i)
+            r.reduce(view<cov_type>(store_->data2(i).data(), store_->data2(i).size()));
+        r.reduce(view<uint64_t>(&store_->count(), 1));
+        r.reduce(view<double>(&store_->count2(), 1));
+    }
+    if (pre_commit && post_commit) {
+        r.commit();
+    }
+    if (post_commit) {
+        reducer_setup setup = r.get_setup();
+        if (setup.have_result)
+            store_->convert_to_mean();
+        else
+            store_.reset();   // free data
+    }
+}
+
+template class blockcov_result<double>;
+template class blockcov_result<std::complex<double>, circular_var>;
+template class blockcov_result<std::complex<double>, elliptic_var>;
+template class blockcov_result<float>;
+template class blockcov_result<std::complex<float>, circular_var>;
+template class blockcov_result<std::complex<float>, elliptic_var>;
+
+
+template <typename T, typename Str>
+void serialize(serializer &s, const std::string &key, const blockcov_result<T,Str> &self)
+{
+    internal::check_valid(self);
+    internal::serializer_sentry group(s, key);
+
+    // serialize to uint64_t to make sure we are consistent across 32/64 bit
+    serialize(s, "@size", static_cast<uint64_t>(self.size()));
+    serialize(s, "@nblocks", static_cast<uint64_t>(self.nblocks()));
+    typename eigen<uint64_t>::col block_sizes(self.nblocks());
+    for (size_t i = 0; i != self.nblocks(); ++i)
+        block_sizes(i) = self.store().block_size(i);
+    serialize(s, "blocks", block_sizes);
+    serialize(s, "count", self.count());
+    serialize(s, "count2", self.count2());
+    s.enter("mean");
+    serialize(s, "value", self.mean());
+    serialize(s, "error", self.stderror());   // TODO temporary
+    s.exit();
+
+    s.enter("cov");
+    for (size_t i = 0; i != self.nblocks(); ++i)
+        serialize(s, std::to_string(i), self.block_cov(i));
+    s.exit();
+}
+
+template <typename T, typename Str>
+void deserialize(deserializer &s, const std::string &key, blockcov_result<T,Str> &self)
+{
+    typedef typename blockcov_result<T,Str>::var_type var_type;
+    internal::deserializer_sentry group(s, key);
+
+    // deserialize from uint64_t
+    uint64_t new_size, new_nblocks;
+    deserialize(s, "@size", new_size);
+    deserialize(s, "@nblocks", new_nblocks);
+
+    typename eigen<uint64_t>::col new_blocks(new_nblocks);
+    deserialize(s, "blocks", new_blocks);
+    std::vector<size_t> block_sizes(new_blocks.data(),
+                                    new_blocks.data() + new_nblocks);
+
+    if (std::accumulate(block_sizes.begin(), block_sizes.end(), uint64_t(0)) != new_size)
+        throw size_mismatch();
+    if (!self.valid() || self.store().block_sizes() != block_sizes)
+        self.store_.reset(new blockcov_data<T,Str>(block_sizes));
+
+    // deserialize data
+    deserialize(s, "count", self.store_->count());
+    deserialize(s, "count2", self.store_->count2());
+    s.enter("mean");
+    deserialize(s, "value", self.store_->data());
+    Eigen::Matrix<var_type, Eigen::Dynamic, 1> discard(self.size());
+    deserialize(s, "error", discard);
+    s.exit();
+
+    s.enter("cov");
+    for (size_t i = 0; i != self.nblocks(); ++i)
+        deserialize(s, std::to_string(i), self.store_->data2(i));
+    s.exit();
+}
+
+template void serialize(serializer &, const std::string &key, const blockcov_result<double, circular_var> &);
+template void serialize(serializer &, const std::string &key, const blockcov_result<std::complex<double>, circular_var> &);
+template void serialize(serializer &, const std::string &key, const blockcov_result<std::complex<double>, elliptic_var> &);
+template void serialize(serializer &, const std::string &key, const blockcov_result<float, circular_var> &);
+template void serialize(serializer &, const std::string &key, const blockcov_result<std::complex<float>, circular_var> &);
+template void serialize(serializer &, const std::string &key, const blockcov_result<std::complex<float>, elliptic_var> &);
+
+template void deserialize(deserializer &, const std::string &key, blockcov_result<double, circular_var> &);
+template void deserialize(deserializer &, const std::string &key, blockcov_result<std::complex<double>, circular_var> &);
+template void deserialize(deserializer &, const std::string &key, blockcov_result<std::complex<double>, elliptic_var> &);
+template void deserialize(deserializer &, const std::string &key, blockcov_result<float, circular_var> &);
+template void deserialize(deserializer &, const std::string &key, blockcov_result<std::complex<float>, circular_var> &);
+template void deserialize(deserializer &, const std::string &key, blockcov_result<std::complex<float>, elliptic_var> &);
+
+
+template <typename T, typename Str>
+std::ostream &operator<<(std::ostream &str, const blockcov_result<T,Str> &self)
+{
+    internal::format_sentry sentry(str);
+    verbosity verb = internal::get_format(str, PRINT_TERSE);
+
+    if (verb == PRINT_VERBOSE)
+        str << "<X> = ";
+    str << self.mean() << " +- " << self.stderror();
+    if (verb == PRINT_VERBOSE) {
+        for (size_t i = 0; i != self.nblocks(); ++i)
+            str << "\nSigma[" << i << "] = " << self.block_cov(i);
+    }
+    return str;
+}
+
+template std::ostream &operator<<(std::ostream &, const blockcov_result<double, circular_var> &);
+template std::ostream &operator<<(std::ostream &, const blockcov_result<std::complex<double>, circular_var> &);
+template std::ostream &operator<<(std::ostream &, const blockcov_result<std::complex<double>, elliptic_var> &);
+template std::ostream &operator<<(std::ostream &, const blockcov_result<float, circular_var> &);
+template std::ostream &operator<<(std::ostream &, const blockcov_result<std::complex<float>, circular_var> &);
+template std::ostream &operator<<(std::ostream &, const blockcov_result<std::complex<float>, elliptic_var> &);
+
+}} /* namespace alps::alea */
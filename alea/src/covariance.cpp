@@ -69,12 +69,17 @@ void cov_data<T,Str>::convert_to_sum()
 template class cov_data<double>;
 template class cov_data<std::complex<double>, circular_var>;
 template class cov_data<std::complex<double>, elliptic_var>;
+template class cov_data<float>;
+template class cov_data<std::complex<float>, circular_var>;
+template class cov_data<std::complex<float>, elliptic_var>;
 
 
 template <typename T, typename Str>
 cov_acc<T,Str>::cov_acc(size_t size, uint64_t batch_size)
     : store_(new cov_data<T,Str>(size))
     , current_(size, batch_size)
+    , stage_(size, STAGE_SIZE)
+    , nstaged_(0)
 { }
 
 // We need an explicit copy constructor, as we need to copy the data
@@ -82,6 +87,8 @@ template <typename T, typename Str>
 cov_acc<T,Str>::cov_acc(const cov_acc &other)
     : store_(other.store_ ? new cov_data<T,Str>(*other.store_) : nullptr)
     , current_(other.current_)
+    , stage_(other.stage_)
+    , nstaged_(other.nstaged_)
 { }
 
 template <typename T, typename Str>
@@ -89,6 +96,8 @@ cov_acc<T,Str> &cov_acc<T,Str>::operator=(const cov_acc &other)
 {
     store_.reset(other.store_ ? new cov_data<T,Str>(*other.store_) : nullptr);
     current_ = other.current_;
+    stage_ = other.stage_;
+    nstaged_ = other.nstaged_;
     return *this;
 }
 
@@ -96,6 +105,7 @@ template <typename T, typename Str>
 void cov_acc<T,Str>::reset()
 {
     current_.reset();
+    nstaged_ = 0;
     if (valid())
         store_->reset();
     else
@@ -106,6 +116,8 @@ template <typename T, typename Str>
 void cov_acc<T,Str>::set_size(size_t size)
 {
     current_ = bundle<T>(size, current_.target());
+    stage_.resize(size, STAGE_SIZE);
+    nstaged_ = 0;
     if (valid())
         store_.reset(new cov_data<T,Str>(size));
 }
@@ -129,6 +141,32 @@ void cov_acc<T,Str>::add(const computed<value_type> &source, uint64_t count)
         add_bundle();
 }
 
+template <typename T, typename Str>
+void cov_acc<T,Str>::add_sparse(const sparse_computed<T> &source, uint64_t count)
+{
+    // if the batch spans multiple samples, the bundle has to be dense
+    if (current_.count() != 0 || count < current_.target()) {
+        add(source, count);
+        return;
+    }
+
+    internal::check_valid(*this);
+    if (source.size() != size())
+        throw size_mismatch();
+    source.check_indices();
+
+    // the sample is a batch by itself: equivalent to add_bundle()
+    const size_t *index = source.indices();
+    const T *value = source.values();
+    for (size_t k = 0; k != source.nnz(); ++k)
+        store_->data()(index[k]) += value[k];
+    internal::rank_update<bind<Str, T> >::add_sparse(
+                store_->data2(), index, value, source.nnz(),
+                make_real_type<T>(1.0 / count));
+    store_->count() += count;
+    store_->count2() += count * count;
+}
+
 template <typename T, typename Str>
 cov_acc<T,Str> &cov_acc<T,Str>::operator<<(const cov_result<T,Str> &other)
 {
@@ -151,12 +189,39 @@ cov_acc<T,Str> &cov_acc<T,Str>::operator<<(const cov_result<T,Str> &other)
 template <typename T, typename Str>
 cov_result<T,Str> cov_acc<T,Str>::result() const
 {
-    internal::check_valid(*this);
-    cov_result<T,Str> result(*store_);
-    cov_acc<T,Str>(*this).finalize_to(result);
+    cov_result<T,Str> result;
+    result_to(result);
     return result;
 }
 
+template <typename T, typename Str>
+void cov_acc<T,Str>::result_to(cov_result<T,Str> &result) const
+{
+    internal::check_valid(*this);
+    if (!result.valid() || result.size() != size())
+        result.store_.reset(new cov_data<T,Str>(size()));
+
+    // copy data without re-allocation
+    cov_data<T,Str> &res_store = *result.store_;
+    res_store = *store_;
+
+    // add staged and leftover data to the copy, leaving the accumulator alone
+    if (nstaged_ != 0) {
+        internal::rank_update<bind<Str, T> >::add(res_store.data2(),
+                                                  stage_.leftCols(nstaged_));
+    }
+    if (current_.count() != 0) {
+        res_store.data() += current_.sum();
+        res_store.count() += current_.count();
+        res_store.count2() += current_.count() * current_.count();
+        internal::rank_update<bind<Str, T> >::add(res_store.data2(),
+                current_.sum() / std::sqrt(double(current_.count())));
+    }
+    internal::rank_update<bind<Str, T> >::mirror(res_store.data2());
+
+    res_store.convert_to_mean();
+}
+
 template <typename T, typename Str>
 cov_result<T,Str> cov_acc<T,Str>::finalize()
 {
@@ -173,6 +238,8 @@ void cov_acc<T,Str>::finalize_to(cov_result<T,Str> &result)
     // add leftover data to the covariance.
     if (current_.count() != 0)
         add_bundle();
+    flush_stage();
+    internal::rank_update<bind<Str, T> >::mirror(store_->data2());
 
     // swap data with result
     result.store_.reset();
@@ -185,21 +252,60 @@ void cov_acc<T,Str>::finalize_to(cov_result<T,Str> &result)
 template <typename T, typename Str>
 void cov_acc<T,Str>::add_bundle()
 {
-    // add batch to average and squared
+    // add batch to average
     store_->data().noalias() += current_.sum();
-    store_->data2().noalias() +=
-                internal::outer<bind<Str, T> >(current_.sum(), current_.sum())
-                / current_.count();
     store_->count() += current_.count();
     store_->count2() += current_.count() * current_.count();
 
+    // stage batch for the squared, scaled such that the rank-k update
+    // yields the sum of outer(sum, sum) / count
+    if (nstaged_ == STAGE_SIZE)
+        flush_stage();
+    stage_.col(nstaged_++) = current_.sum() / std::sqrt(double(current_.count()));
+
     // TODO: add possibility for uplevel also here
     current_.reset();
 }
 
+template <typename T, typename Str>
+void cov_acc<T,Str>::flush()
+{
+    internal::check_valid(*this);
+    flush_stage();
+    internal::rank_update<bind<Str, T> >::mirror(store_->data2());
+}
+
+template <typename T, typename Str>
+const cov_data<T,Str> &cov_acc<T,Str>::store() const
+{
+    internal::check_valid(*this);
+    flush_stage();
+    internal::rank_update<bind<Str, T> >::mirror(store_->data2());
+    return *store_;
+}
+
+template <typename T, typename Str>
+void cov_acc<T,Str>::flush_stage() const
+{
+    if (nstaged_ == 0)
+        return;
+
+    // the rank-k update only touches the lower triangle of the squared; the
+    // upper one is restored only when the store is handed out.
+    internal::rank_update<bind<Str, T> >::add(store_->data2(),
+                                              stage_.leftCols(nstaged_));
+    nstaged_ = 0;
+}
+
+template <typename T, typename Str>
+const size_t cov_acc<T,Str>::STAGE_SIZE;
+
 template class cov_acc<double>;
 template class cov_acc<std::complex<double>, circular_var>;
 template class cov_acc<std::complex<double>, elliptic_var>;
+template class cov_acc<float>;
+template class cov_acc<std::complex<float>, circular_var>;
+template class cov_acc<std::complex<float>, elliptic_var>;
 
 
 // We need an explicit copy constructor, as we need to copy the data
@@ -232,6 +338,11 @@ template bool operator==(const cov_result<std::complex<double>, circular_var> &r
                          const cov_result<std::complex<double>, circular_var> &r2);
 template bool operator==(const cov_result<std::complex<double>, elliptic_var> &r1,
                          const cov_result<std::complex<double>, elliptic_var> &r2);
+template bool operator==(const cov_result<float> &r1, const cov_result<float> &r2);
+template bool operator==(const cov_result<std::complex<float>, circular_var> &r1,
+                         const cov_result<std::complex<float>, circular_var> &r2);
+template bool operator==(const cov_result<std::complex<float>, elliptic_var> &r1,
+                         const cov_result<std::complex<float>, elliptic_var> &r2);
 
 template <typename T, typename Str>
 column<typename cov_result<T,Str>::var_type> cov_result<T,Str>::stderror() const
@@ -267,6 +378,9 @@ void cov_result<T,Str>::reduce(const reducer &r, bool pre_commit, bool post_comm
 template class cov_result<double>;
 template class cov_result<std::complex<double>, circular_var>;
 template class cov_result<std::complex<double>, elliptic_var>;
+template class cov_result<float>;
+template class cov_result<std::complex<float>, circular_var>;
+template class cov_result<std::complex<float>, elliptic_var>;
 
 
 template <typename T, typename Str>
@@ -315,10 +429,16 @@ void deserialize(deserializer &s, const std::string &key, cov_result<T,Str> &sel
 template void serialize(serializer &, const std::string &key, const cov_result<double, circular_var> &);
 template void serialize(serializer &, const std::string &key, const cov_result<std::complex<double>, circular_var> &);
 template void serialize(serializer &, const std::string &key, const cov_result<std::complex<double>, elliptic_var> &);
+template void serialize(serializer &, const std::string &key, const cov_result<float, circular_var> &);
+template void serialize(serializer &, const std::string &key, const cov_result<std::complex<float>, circular_var> &);
+template void serialize(serializer &, const std::string &key, const cov_result<std::complex<float>, elliptic_var> &);
 
 template void deserialize(deserializer &, const std::string &key, cov_result<double, circular_var> &);
 template void deserialize(deserializer &, const std::string &key, cov_result<std::complex<double>, circular_var> &);
 template void deserialize(deserializer &, const std::string &key, cov_result<std::complex<double>, elliptic_var> &);
+template void deserialize(deserializer &, const std::string &key, cov_result<float, circular_var> &);
+template void deserialize(deserializer &, const std::string &key, cov_result<std::complex<float>, circular_var> &);
+template void deserialize(deserializer &, const std::string &key, cov_result<std::complex<float>, elliptic_var> &);
 
 
 template <typename T, typename Str>
@@ -338,5 +458,8 @@ std::ostream &operator<<(std::ostream &str, const cov_result<T,Str> &self)
 template std::ostream &operator<<(std::ostream &, const cov_result<double, circular_var> &);
 template std::ostream &operator<<(std::ostream &, const cov_result<std::complex<double>, circular_var> &);
 template std::ostream &operator<<(std::ostream &, const cov_result<std::complex<double>, elliptic_var> &);
+template std::ostream &operator<<(std::ostream &, const cov_result<float, circular_var> &);
+template std::ostream &operator<<(std::ostream &, const cov_result<std::complex<float>, circular_var> &);
+template std::ostream &operator<<(std::ostream &, const cov_result<std::complex<float>, elliptic_var> &);
 
 }} /* namespace alps::alea */
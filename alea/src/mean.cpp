@@ -40,6 +40,8 @@ void mean_data<T>::convert_to_sum()
 
 template class mean_data<double>;
 template class mean_data<std::complex<double> >;
+template class mean_data<float>;
+template class mean_data<std::complex<float> >;
 
 
 // We need an explicit copy constructor, as we need to copy the data
@@ -107,6 +109,17 @@ mean_result<T> mean_acc<T>::result() const
     return result;
 }
 
+template <typename T>
+void mean_acc<T>::result_to(mean_result<T> &result) const
+{
+    internal::check_valid(*this);
+    if (!result.valid() || result.size() != size())
+        result.store_.reset(new mean_data<T>(size()));
+
+    *result.store_ = *store_;
+    result.store_->convert_to_mean();
+}
+
 template <typename T>
 mean_result<T> mean_acc<T>::finalize()
 {
@@ -126,6 +139,8 @@ void mean_acc<T>::finalize_to(mean_result<T> &result)
 
 template class mean_acc<double>;
 template class mean_acc<std::complex<double> >;
+template class mean_acc<float>;
+template class mean_acc<std::complex<float> >;
 
 
 // We need an explicit copy constructor, as we need to copy the data
@@ -155,6 +170,10 @@ template bool operator==(const mean_result<double> &r1,
                          const mean_result<double> &r2);
 template bool operator==(const mean_result<std::complex<double>> &r1,
                          const mean_result<std::complex<double>> &r2);
+template bool operator==(const mean_result<float> &r1,
+                         const mean_result<float> &r2);
+template bool operator==(const mean_result<std::complex<float>> &r1,
+                         const mean_result<std::complex<float>> &r2);
 
 template <typename T>
 void mean_result<T>::reduce(const reducer &r, bool pre_commit, bool post_commit)
@@ -179,6 +198,8 @@ void mean_result<T>::reduce(const reducer &r, bool pre_commit, bool post_commit)
 
 template class mean_result<double>;
 template class mean_result<std::complex<double> >;
+template class mean_result<float>;
+template class mean_result<std::complex<float> >;
 
 
 template <typename T>
@@ -218,9 +239,13 @@ void deserialize(deserializer &s, const std::string &key, mean_result<T> &self)
 
 template void serialize(serializer &, const std::string &, const mean_result<double> &);
 template void serialize(serializer &, const std::string &, const mean_result<std::complex<double> > &);
+template void serialize(serializer &, const std::string &, const mean_result<float> &);
+template void serialize(serializer &, const std::string &, const mean_result<std::complex<float> > &);
 
 template void deserialize(deserializer &, const std::string &, mean_result<double> &);
 template void deserialize(deserializer &, const std::string &, mean_result<std::complex<double> > &);
+template void deserialize(deserializer &, const std::string &, mean_result<float> &);
+template void deserialize(deserializer &, const std::string &, mean_result<std::complex<float> > &);
 
 
 template <typename T>
@@ -238,6 +263,8 @@ std::ostream &operator<<(std::ostream &str, const mean_result<T> &self)
 
 template std::ostream &operator<<(std::ostream &, const mean_result<double> &);
 template std::ostream &operator<<(std::ostream &, const mean_result<std::complex<double>> &);
+template std::ostream &operator<<(std::ostream &, const mean_result<float> &);
+template std::ostream &operator<<(std::ostream &, const mean_result<std::complex<float>> &);
 
 
 }} /* namespace alps::alea */
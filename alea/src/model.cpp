@@ -28,6 +28,17 @@ void var1_model<T>::init()
     }
 
     stddev_eps_ = var_eps_.cwiseSqrt();
+
+    // classify lag term for faster block generation
+    size_t nonzeros = (phi1_.array() != T(0)).count();
+    if (phi1_.isDiagonal(0)) {
+        phi1_structure_ = LAG_DIAGONAL;
+    } else if (4 * nonzeros <= size_t(phi1_.size())) {
+        phi1_structure_ = LAG_SPARSE;
+        phi1_sparse_ = phi1_.sparseView();
+    } else {
+        phi1_structure_ = LAG_DENSE;
+    }
 }
 
 template <typename T>
@@ -131,6 +142,43 @@ void var1_run<T>::update()
     xt_ = model_->phi0() + model_->phi1() * xt_ + epst_;
 }
 
+template <typename T>
+void var1_run<T>::update_block(typename eigen<T>::matrix &out, Eigen::Index start)
+{
+    assert(model_ != nullptr);
+    if (noise_.cols() == 0)
+        return;
+
+    switch (model_->phi1_structure()) {
+    case LAG_DIAGONAL:
+        update_block(model_->phi1().diagonal().asDiagonal(), out, start);
+        break;
+    case LAG_SPARSE:
+        update_block(model_->phi1_sparse(), out, start);
+        break;
+    default:
+        update_block(model_->phi1(), out, start);
+    }
+
+    t_ += noise_.cols();
+    xt_ = out.col(start + noise_.cols() - 1);
+    epst_ = noise_.col(noise_.cols() - 1);
+}
+
+template <typename T>
+template <typename Lag>
+void var1_run<T>::update_block(const Lag &phi1, typename eigen<T>::matrix &out,
+                               Eigen::Index start)
+{
+    // the recursion forbids batching the steps, but all columns are adjacent
+    out.col(start).noalias() = phi1 * xt_;
+    out.col(start) += model_->phi0() + noise_.col(0).template cast<T>();
+    for (Eigen::Index t = 1; t != noise_.cols(); ++t) {
+        out.col(start + t).noalias() = phi1 * out.col(start + t - 1);
+        out.col(start + t) += model_->phi0() + noise_.col(t).template cast<T>();
+    }
+}
+
 template class var1_run<double>;
 template class var1_run<std::complex<double> >;
 
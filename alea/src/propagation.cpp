@@ -5,6 +5,7 @@
  */
 #include <alps/alea/propagation.hpp>
 
+#include <algorithm>
 #include <iostream>
 
 namespace alps { namespace alea {
@@ -31,6 +32,151 @@ template eigen<double>::matrix jacobian(
 template eigen< std::complex<double> >::matrix jacobian(
             const transformer<std::complex<double> > &, column<std::complex<double> >,
             double);
+template eigen<float>::matrix jacobian(
+            const transformer<float> &, column<float>, double);
+template eigen< std::complex<float> >::matrix jacobian(
+            const transformer<std::complex<float> > &, column<std::complex<float> >,
+            double);
+
+
+template <typename T>
+typename eigen<T>::matrix jacobian(const dual_transformer<T> &f, const column<T> &x)
+{
+    size_t in_size = f.in_size();
+    size_t out_size = f.out_size();
+    if ((size_t)x.rows() != in_size)
+        throw size_mismatch();
+
+    // seed the j-th component with the j-th tangent direction
+    column<dual<T> > xd(in_size);
+    for (size_t j = 0; j != in_size; ++j)
+        xd(j) = dual<T>::variable(x(j), in_size, j);
+
+    const column<dual<T> > fxd = f(xd);
+    typename eigen<T>::matrix result =
+                    eigen<T>::matrix::Zero(out_size, in_size);
+    for (size_t i = 0; i != out_size; ++i) {
+        if (!fxd(i).is_constant())
+            result.row(i) = fxd(i).tangent().transpose();
+    }
+    return result;
+}
+
+template eigen<double>::matrix jacobian(
+            const dual_transformer<double> &, const column<double> &);
+template eigen< std::complex<double> >::matrix jacobian(
+            const dual_transformer<std::complex<double> > &,
+            const column<std::complex<double> > &);
+template eigen<float>::matrix jacobian(
+            const dual_transformer<float> &, const column<float> &);
+template eigen< std::complex<float> >::matrix jacobian(
+            const dual_transformer<std::complex<float> > &,
+            const column<std::complex<float> > &);
+
+
+template <typename T>
+std::vector<typename eigen<T>::matrix> block_jacobian(
+                        const transformer<T> &f, column<T> x,
+                        const std::vector<size_t> &block_sizes, double dx)
+{
+    if (f.in_size() != (size_t)x.rows() || f.out_size() != (size_t)x.rows())
+        throw size_mismatch();
+
+    std::vector<typename eigen<T>::matrix> result;
+    std::vector<size_t> offset;
+    size_t max_size = 0, curr_offset = 0;
+    for (size_t block_size : block_sizes) {
+        result.push_back(typename eigen<T>::matrix(block_size, block_size));
+        offset.push_back(curr_offset);
+        max_size = std::max(max_size, block_size);
+        curr_offset += block_size;
+    }
+    if (curr_offset != (size_t)x.rows())
+        throw size_mismatch();
+
+    // displace the j-th component of each block simultaneously
+    const column<T> fx = f(x);
+    for (size_t j = 0; j != max_size; ++j) {
+        column<T> xj = x;
+        for (size_t b = 0; b != block_sizes.size(); ++b) {
+            if (j < block_sizes[b])
+                xj(offset[b] + j) += dx;
+        }
+        const column<T> fxj = f(xj);
+        for (size_t b = 0; b != block_sizes.size(); ++b) {
+            if (j < block_sizes[b]) {
+                result[b].col(j) = (fxj.segment(offset[b], block_sizes[b])
+                                    - fx.segment(offset[b], block_sizes[b])) / dx;
+            }
+        }
+    }
+    return result;
+}
+
+template std::vector<eigen<double>::matrix> block_jacobian(
+            const transformer<double> &, column<double>,
+            const std::vector<size_t> &, double);
+template std::vector<eigen<std::complex<double> >::matrix> block_jacobian(
+            const transformer<std::complex<double> > &, column<std::complex<double> >,
+            const std::vector<size_t> &, double);
+template std::vector<eigen<float>::matrix> block_jacobian(
+            const transformer<float> &, column<float>,
+            const std::vector<size_t> &, double);
+template std::vector<eigen<std::complex<float> >::matrix> block_jacobian(
+            const transformer<std::complex<float> > &, column<std::complex<float> >,
+            const std::vector<size_t> &, double);
+
+
+template <typename T>
+std::vector<typename eigen<T>::matrix> block_jacobian(
+                        const dual_transformer<T> &f, const column<T> &x,
+                        const std::vector<size_t> &block_sizes)
+{
+    if (f.in_size() != (size_t)x.rows() || f.out_size() != (size_t)x.rows())
+        throw size_mismatch();
+
+    std::vector<typename eigen<T>::matrix> result;
+    std::vector<size_t> offset;
+    size_t max_size = 0, curr_offset = 0;
+    for (size_t block_size : block_sizes) {
+        result.push_back(eigen<T>::matrix::Zero(block_size, block_size));
+        offset.push_back(curr_offset);
+        max_size = std::max(max_size, block_size);
+        curr_offset += block_size;
+    }
+    if (curr_offset != (size_t)x.rows())
+        throw size_mismatch();
+
+    // seed the j-th component of each block with the j-th tangent direction
+    column<dual<T> > xd(x.rows());
+    for (size_t b = 0; b != block_sizes.size(); ++b) {
+        for (size_t j = 0; j != block_sizes[b]; ++j)
+            xd(offset[b] + j) = dual<T>::variable(x(offset[b] + j), max_size, j);
+    }
+
+    const column<dual<T> > fxd = f(xd);
+    for (size_t b = 0; b != block_sizes.size(); ++b) {
+        for (size_t i = 0; i != block_sizes[b]; ++i) {
+            const dual<T> &fi = fxd(offset[b] + i);
+            if (!fi.is_constant())
+                result[b].row(i) = fi.tangent().head(block_sizes[b]).transpose();
+        }
+    }
+    return result;
+}
+
+template std::vector<eigen<double>::matrix> block_jacobian(
+            const dual_transformer<double> &, const column<double> &,
+            const std::vector<size_t> &);
+template std::vector<eigen<std::complex<double> >::matrix> block_jacobian(
+            const dual_transformer<std::complex<double> > &,
+            const column<std::complex<double> > &, const std::vector<size_t> &);
+template std::vector<eigen<float>::matrix> block_jacobian(
+            const dual_transformer<float> &, const column<float> &,
+            const std::vector<size_t> &);
+template std::vector<eigen<std::complex<float> >::matrix> block_jacobian(
+            const dual_transformer<std::complex<float> > &,
+            const column<std::complex<float> > &, const std::vector<size_t> &);
 
 
 template <typename T>
@@ -72,6 +218,11 @@ template batch_data<double> jackknife(const batch_data<double> &in,
 template batch_data<std::complex<double> > jackknife(
                                 const batch_data<std::complex<double> > &in,
                                 const transformer<std::complex<double> > &tf);
+template batch_data<float> jackknife(const batch_data<float> &in,
+                                     const transformer<float> &tf);
+template batch_data<std::complex<float> > jackknife(
+                                const batch_data<std::complex<float> > &in,
+                                const transformer<std::complex<float> > &tf);
 
 }}
 
@@ -71,6 +71,9 @@ void var_data<T,Str>::convert_to_sum()
 template class var_data<double>;
 template class var_data<std::complex<double>, circular_var>;
 template class var_data<std::complex<double>, elliptic_var>;
+template class var_data<float>;
+template class var_data<std::complex<float>, circular_var>;
+template class var_data<std::complex<float>, elliptic_var>;
 
 
 template <typename T, typename Str>
@@ -132,6 +135,32 @@ void var_acc<T,Str>::add(const computed<T> &source, uint64_t count,
         add_bundle(cascade);
 }
 
+template <typename T, typename Str>
+void var_acc<T,Str>::add_sparse(const sparse_computed<T> &source, uint64_t count)
+{
+    // if the batch spans multiple samples, the bundle has to be dense
+    if (current_.count() != 0 || count < current_.target()) {
+        add(source, count, nullptr);
+        return;
+    }
+
+    internal::check_valid(*this);
+    if (source.size() != size())
+        throw size_mismatch();
+    source.check_indices();
+
+    // the sample is a batch by itself: equivalent to add_batch()
+    typename bind<Str, T>::abs2_op abs2;
+    const size_t *index = source.indices();
+    const T *value = source.values();
+    for (size_t k = 0; k != source.nnz(); ++k) {
+        store_->data()(index[k]) += value[k];
+        store_->data2()(index[k]) += abs2(value[k]) / count;
+    }
+    store_->count() += count;
+    store_->count2() += count * count;
+}
+
 template <typename T, typename Str>
 var_acc<T,Str> &var_acc<T,Str>::operator<<(const var_result<T,Str> &other)
 {
@@ -154,12 +183,41 @@ var_acc<T,Str> &var_acc<T,Str>::operator<<(const var_result<T,Str> &other)
 template <typename T, typename Str>
 var_result<T,Str> var_acc<T,Str>::result() const
 {
-    internal::check_valid(*this);
     var_result<T,Str> result;
-    var_acc<T,Str>(*this).finalize_to(result, nullptr);
+    result_to(result, nullptr);
     return result;
 }
 
+template <typename T, typename Str>
+void var_acc<T,Str>::result_to(var_result<T,Str> &result, bundle<T> *carry) const
+{
+    internal::check_valid(*this);
+    if (!result.valid() || result.size() != size())
+        result.store_.reset(new var_data<T,Str>(size()));
+
+    // copy data without re-allocation
+    var_data<T,Str> &res_store = *result.store_;
+    res_store = *store_;
+
+    // add leftover data as in finalize_to(), where the leftover data of lower
+    // levels in a hierarchy is passed in `carry` instead of being cascaded
+    const bundle<T> *leftover = &current_;
+    if (carry != nullptr) {
+        carry->sum() += current_.sum();
+        carry->count() += current_.count();
+        leftover = carry;
+    }
+    if (leftover->count() != 0) {
+        typename bind<Str, T>::abs2_op abs2;
+        res_store.data() += leftover->sum();
+        res_store.data2() += leftover->sum().unaryExpr(abs2) / leftover->count();
+        res_store.count() += leftover->count();
+        res_store.count2() += leftover->count() * leftover->count();
+    }
+
+    res_store.convert_to_mean();
+}
+
 template <typename T, typename Str>
 var_result<T,Str> var_acc<T,Str>::finalize()
 {
@@ -189,13 +247,8 @@ void var_acc<T,Str>::finalize_to(var_result<T,Str> &result, var_acc<T,Str> *casc
 template <typename T, typename Str>
 void var_acc<T,Str>::add_bundle(var_acc<T,Str> *cascade)
 {
-    typename bind<Str, T>::abs2_op abs2;
-
     // add batch to average and squared
-    store_->data().noalias() += current_.sum();
-    store_->data2().noalias() += current_.sum().unaryExpr(abs2) / current_.count();
-    store_->count() += current_.count();
-    store_->count2() += current_.count() * current_.count();
+    add_batch(current_.sum(), current_.count());
 
     // add batch mean also to uplevel
     if (cascade != nullptr)
@@ -204,9 +257,23 @@ void var_acc<T,Str>::add_bundle(var_acc<T,Str> *cascade)
     current_.reset();
 }
 
+template <typename T, typename Str>
+void var_acc<T,Str>::add_batch(const column<T> &sum, uint64_t count)
+{
+    typename bind<Str, T>::abs2_op abs2;
+
+    store_->data().noalias() += sum;
+    store_->data2().noalias() += sum.unaryExpr(abs2) / count;
+    store_->count() += count;
+    store_->count2() += count * count;
+}
+
 template class var_acc<double>;
 template class var_acc<std::complex<double>, circular_var>;
 template class var_acc<std::complex<double>, elliptic_var>;
+template class var_acc<float>;
+template class var_acc<std::complex<float>, circular_var>;
+template class var_acc<std::complex<float>, elliptic_var>;
 
 // We need an explicit copy constructor, as we need to copy the data
 template <typename T, typename Str>
@@ -238,6 +305,11 @@ template bool operator==(const var_result<std::complex<double>, circular_var> &r
                          const var_result<std::complex<double>, circular_var> &r2);
 template bool operator==(const var_result<std::complex<double>, elliptic_var> &r1,
                          const var_result<std::complex<double>, elliptic_var> &r2);
+template bool operator==(const var_result<float> &r1, const var_result<float> &r2);
+template bool operator==(const var_result<std::complex<float>, circular_var> &r1,
+                         const var_result<std::complex<float>, circular_var> &r2);
+template bool operator==(const var_result<std::complex<float>, elliptic_var> &r1,
+                         const var_result<std::complex<float>, elliptic_var> &r2);
 
 template <typename T, typename Str>
 column<typename var_result<T,Str>::var_type> var_result<T,Str>::stderror() const
@@ -272,6 +344,9 @@ void var_result<T,Str>::reduce(const reducer &r, bool pre_commit, bool post_comm
 template class var_result<double>;
 template class var_result<std::complex<double>, circular_var>;
 template class var_result<std::complex<double>, elliptic_var>;
+template class var_result<float>;
+template class var_result<std::complex<float>, circular_var>;
+template class var_result<std::complex<float>, elliptic_var>;
 
 
 template <typename T, typename Str>
@@ -320,10 +395,16 @@ void deserialize(deserializer &s, const std::string &key, var_result<T,Str> &sel
 template void serialize(serializer &, const std::string &key, const var_result<double, circular_var> &);
 template void serialize(serializer &, const std::string &key, const var_result<std::complex<double>, circular_var> &);
 template void serialize(serializer &, const std::string &key, const var_result<std::complex<double>, elliptic_var> &);
+template void serialize(serializer &, const std::string &key, const var_result<float, circular_var> &);
+template void serialize(serializer &, const std::string &key, const var_result<std::complex<float>, circular_var> &);
+template void serialize(serializer &, const std::string &key, const var_result<std::complex<float>, elliptic_var> &);
 
 template void deserialize(deserializer &, const std::string &key, var_result<double, circular_var> &);
 template void deserialize(deserializer &, const std::string &key, var_result<std::complex<double>, circular_var> &);
 template void deserialize(deserializer &, const std::string &key, var_result<std::complex<double>, elliptic_var> &);
+template void deserialize(deserializer &, const std::string &key, var_result<float, circular_var> &);
+template void deserialize(deserializer &, const std::string &key, var_result<std::complex<float>, circular_var> &);
+template void deserialize(deserializer &, const std::string &key, var_result<std::complex<float>, elliptic_var> &);
 
 
 template <typename T, typename Str>
@@ -342,5 +423,8 @@ std::ostream &operator<<(std::ostream &str, const var_result<T,Str> &self)
 template std::ostream &operator<<(std::ostream &, const var_result<double, circular_var> &);
 template std::ostream &operator<<(std::ostream &, const var_result<std::complex<double>, circular_var> &);
 template std::ostream &operator<<(std::ostream &, const var_result<std::complex<double>, elliptic_var> &);
+template std::ostream &operator<<(std::ostream &, const var_result<float, circular_var> &);
+template std::ostream &operator<<(std::ostream &, const var_result<std::complex<float>, circular_var> &);
+template std::ostream &operator<<(std::ostream &, const var_result<std::complex<float>, elliptic_var> &);
 
 }}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+#include <alps/alea/buffer.hpp>
+#include <alps/alea/mean.hpp>
+#include <alps/alea/variance.hpp>
+#include <alps/alea/covariance.hpp>
+#include <alps/alea/blockcov.hpp>
+#include <alps/alea/autocorr.hpp>
+#include <alps/alea/batch.hpp>
+
+#include "gtest/gtest.h"
+#include "dataset.hpp"
+
+TEST(buffer, primitives)
+{
+    alps::alea::buffer_serializer ser(16);
+    std::vector<double> vec = {1.5, 2.5, 3.5, 4.5, 5.5, 6.5};
+    size_t shape[2] = {2, 3};
+
+    ser.enter("group");
+    ser.write("matrix", alps::alea::ndview<const double>(vec.data(), shape, 2));
+    alps::serialization::serialize(ser, "scalar", uint64_t(42));
+    ser.exit();
+    alps::serialization::serialize(ser, "complex", std::complex<double>(0.5, 0.75));
+
+    // copy to make sure the deserializer does not rely on the serializer
+    std::vector<char> buffer = ser.buffer();
+    alps::alea::buffer_deserializer deser(buffer);
+
+    deser.enter("group");
+    std::vector<size_t> exp_shape = {2, 3};
+    EXPECT_EQ(exp_shape, deser.get_shape("matrix"));
+
+    std::vector<double> out(6);
+    deser.read("matrix", alps::alea::ndview<double>(out.data(), shape, 2));
+    EXPECT_EQ(vec, out);
+
+    alps::alea::ndview<const double> direct = deser.view<double>("matrix");
+    EXPECT_EQ(6u, direct.size());
+    EXPECT_EQ(0u, ((const char *)direct.data() - buffer.data()) % 16);
+    EXPECT_EQ(4.5, direct.data()[3]);
+
+    size_t wrong_shape[2] = {3, 2};
+    EXPECT_THROW(deser.read("matrix", alps::alea::ndview<double>(nullptr, wrong_shape, 2)),
+                 alps::alea::size_mismatch);
+
+    uint64_t scalar;
+    alps::serialization::deserialize(deser, "scalar", scalar);
+    EXPECT_EQ(42u, scalar);
+    EXPECT_THROW(deser.read("scalar", alps::alea::ndview<double>(nullptr, nullptr, 0)),
+                 std::runtime_error);
+    deser.exit();
+
+    std::complex<double> cplx;
+    alps::serialization::deserialize(deser, "complex", cplx);
+    EXPECT_EQ(std::complex<double>(0.5, 0.75), cplx);
+
+    EXPECT_THROW(deser.get_shape("matrix"), std::runtime_error);
+}
+
+template <typename Acc>
+class twogauss_buffer_case
+    : public ::testing::Test
+{
+public:
+    typedef typename alps::alea::traits<Acc>::value_type value_type;
+    typedef typename alps::alea::traits<Acc>::result_type result_type;
+
+    twogauss_buffer_case() { }
+
+    void test_result()
+    {
+        Acc in_acc(2);
+        for (size_t i = 0; i != twogauss_count; ++i)
+            in_acc << std::vector<value_type>{twogauss_data[i][0], twogauss_data[i][1]};
+
+        result_type in = in_acc.result();
+        alps::alea::buffer_serializer ser;
+        serialize(ser, "result", in);
+
+        alps::alea::buffer_deserializer deser(ser.data(), ser.size());
+        result_type out = Acc(2).result();
+        deserialize(deser, "result", out);
+        EXPECT_EQ(in, out);
+    }
+};
+
+using namespace alps::alea;
+
+typedef ::testing::Types<
+        mean_acc<double>
+      , mean_acc<std::complex<double> >
+      , var_acc<double>
+      , var_acc<std::complex<double>, elliptic_var>
+      , cov_acc<double>
+      , cov_acc<std::complex<double> >
+      , blockcov_acc<double>
+      , autocorr_acc<double>
+      , batch_acc<double>
+      , batch_acc<std::complex<double> >
+    > buffer_serializable;
+
+TYPED_TEST_CASE(twogauss_buffer_case, buffer_serializable);
+TYPED_TEST(twogauss_buffer_case, test_result) { this->test_result(); }
@@ -4,10 +4,12 @@
  * For use in publications, see ACKNOWLEDGE.TXT
  */
 #include <alps/alea/batch.hpp>
+#include <alps/alea/buffer.hpp>
 
 #include "gtest/gtest.h"
 #include "dataset.hpp"
 
+#include <algorithm>
 #include <iterator>
 #include <iostream>
 
@@ -86,6 +88,78 @@ TEST_F(galois_case, correct_order)
     }
 }
 
+void check_compact(const batch_data<double> &store)
+{
+    for (size_t i = 0; i != store.num_batches(); ++i) {
+        size_t offset = store.offset()[i];
+        size_t size = store.count()[i];
+        EXPECT_LE(offset + size, twogauss_count);
+
+        std::vector<double> expect(2, 0.0);
+        for (size_t k = offset; k != offset + size; ++k) {
+            expect[0] += twogauss_data[k][0];
+            expect[1] += twogauss_data[k][1];
+        }
+        EXPECT_NEAR(store.batch()(0, i), expect[0], 1e-5);
+        EXPECT_NEAR(store.batch()(1, i), expect[1], 1e-5);
+    }
+}
+
+TEST_F(galois_case, rebatch)
+{
+    std::vector<size_t> num_batches = {8, 6, 4, 2};
+    batch_result<double> res = acc_.result();
+    std::vector< batch_result<double> > coarse = res.rebatch(num_batches);
+    ASSERT_EQ(coarse.size(), num_batches.size());
+
+    for (size_t j = 0; j != coarse.size(); ++j) {
+        EXPECT_EQ(coarse[j].num_batches(), num_batches[j]);
+        EXPECT_EQ(coarse[j].count(), twogauss_count);
+        EXPECT_NEAR(coarse[j].mean()(0), res.mean()(0), 1e-10);
+        EXPECT_NEAR(coarse[j].mean()(1), res.mean()(1), 1e-10);
+
+        // coarse batches must be compact in time
+        check_compact(coarse[j].store());
+    }
+
+    // splitting by component must not change the result
+    std::vector< batch_result<double> > split = res.rebatch(num_batches, 2);
+    for (size_t j = 0; j != coarse.size(); ++j)
+        EXPECT_EQ(split[j], coarse[j]);
+
+    EXPECT_THROW(res.rebatch(std::vector<size_t>(1, 16)), size_mismatch);
+}
+
+TEST_F(galois_case, rebatch_after_round_trip)
+{
+    // the hopper has merged batches, so they are not stored in time order
+    batch_result<double> res = acc_.result();
+    const batch_data<double> &orig = res.store();
+    std::vector<size_t> offsets(orig.offset().data(),
+                                orig.offset().data() + orig.num_batches());
+    ASSERT_FALSE(std::is_sorted(offsets.begin(), offsets.end()));
+
+    buffer_serializer ser;
+    serialize(ser, "batch", res);
+    buffer_deserializer deser(ser.buffer());
+    batch_result<double> restored;
+    deserialize(deser, "batch", restored);
+
+    // offsets are recovered
+    EXPECT_EQ(twogauss_count, restored.count());
+    check_compact(restored.store());
+    std::sort(offsets.begin(), offsets.end());
+    for (size_t i = 0; i != restored.store().num_batches(); ++i)
+        EXPECT_EQ(offsets[i], restored.store().offset()[i]);
+
+    std::vector<size_t> num_batches = {8, 6, 4, 2};
+    std::vector< batch_result<double> > coarse = restored.rebatch(num_batches);
+    for (size_t j = 0; j != coarse.size(); ++j) {
+        EXPECT_EQ(coarse[j].count(), twogauss_count);
+        check_compact(coarse[j].store());
+    }
+}
+
 // int main(int argc, char **argv)
 // {
 //     ::testing::InitGoogleTest(&argc, argv);
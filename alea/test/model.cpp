@@ -11,6 +11,7 @@
 #include "gtest/gtest.h"
 
 #include <boost/random/mersenne_twister.hpp>
+#include <algorithm>
 #include <iostream>
 
 alps::alea::util::var1_model<double> get_test_model()
@@ -188,6 +189,106 @@ TEST(var1_test, autocorr)
     ASSERT_GE(t2.pvalue(), 0.01);
 }
 
+TEST(var1_test, step_block)
+{
+    // dense, diagonal and sparse lag terms, respectively
+    Eigen::VectorXd phi0(3), veps(3);
+    Eigen::MatrixXd phi1_dense(3,3), phi1_diag(3,3), phi1_sparse(3,3);
+    phi0 << 2, 3, 1;
+    veps << 1.0, 0.25, 0.5;
+    phi1_dense << .5, .25, .1, .25, .3, .1, .1, .1, .2;
+    phi1_diag << .8, 0, 0, 0, .64, 0, 0, 0, .3;
+    phi1_sparse << .8, 0, 0, 0, 0, 0, .1, 0, 0;
+
+    std::vector<Eigen::MatrixXd> phi1s = {phi1_dense, phi1_diag, phi1_sparse};
+    std::vector<alps::alea::util::lag_structure> structures = {
+            alps::alea::util::LAG_DENSE, alps::alea::util::LAG_DIAGONAL,
+            alps::alea::util::LAG_SPARSE};
+    for (size_t m = 0; m != phi1s.size(); ++m) {
+        alps::alea::util::var1_model<double> model(phi0, phi1s[m], veps);
+        EXPECT_EQ(structures[m], model.phi1_structure());
+
+        alps::alea::util::var1_run<double> run = model.start();
+        boost::random::mt19937 engine;
+        alps::alea::autocorr_acc<double> acc(3);
+        Eigen::MatrixXd block(3, 1000);
+        for (size_t b = 0; b != 400; ++b) {
+            run.step_block(engine, block);
+            for (Eigen::Index t = 0; t != block.cols(); ++t)
+                acc << block.col(t);
+        }
+        EXPECT_EQ(400000u, run.t());
+        EXPECT_EQ(block.col(block.cols() - 1), run.xt());
+
+        alps::alea::autocorr_result<double> res = acc.finalize();
+        alps::alea::t2_result t2 = alps::alea::test_mean(res, model.mean());
+        print_t2(std::cerr, t2);
+        EXPECT_GE(t2.pvalue(), 0.01);
+    }
+}
+
+TEST(var1_test, step_block_reproduces_step)
+{
+    // dense, diagonal and sparse lag terms, respectively
+    Eigen::VectorXd phi0(3), veps(3);
+    Eigen::MatrixXd phi1_dense(3,3), phi1_diag(3,3), phi1_sparse(3,3);
+    phi0 << 2, 3, 1;
+    veps << 1.0, 0.25, 0.5;
+    phi1_dense << .5, .25, .1, .25, .3, .1, .1, .1, .2;
+    phi1_diag << .8, 0, 0, 0, .64, 0, 0, 0, .3;
+    phi1_sparse << .8, 0, 0, 0, 0, 0, .1, 0, 0;
+
+    // the block spans several chunks of the noise buffer
+    std::vector<Eigen::MatrixXd> phi1s = {phi1_dense, phi1_diag, phi1_sparse};
+    for (size_t m = 0; m != phi1s.size(); ++m) {
+        alps::alea::util::var1_model<double> model(phi0, phi1s[m], veps);
+        alps::alea::util::var1_run<double> run1 = model.start(), run2 = model.start();
+        boost::random::mt19937 engine1(4711), engine2(4711);
+
+        Eigen::MatrixXd block(3, 12345);
+        run2.step_block(engine2, block);
+        for (Eigen::Index t = 0; t != block.cols(); ++t) {
+            run1.step(engine1);
+            ASSERT_NEAR(0, (block.col(t) - run1.xt()).norm(), 1e-10 * run1.xt().norm())
+                << "at step " << t;
+        }
+        EXPECT_EQ(engine1, engine2);
+    }
+}
+
+TEST(var1_test, autocorr_snapshot)
+{
+    Eigen::VectorXd phi0(2), veps(2);
+    Eigen::MatrixXd phi1(2,2);
+    phi0 << 2, 3;
+    phi1 << .80, 0, 0, .64;
+    veps << 1.0, 0.25;
+    alps::alea::util::var1_model<double> model(phi0, phi1, veps);
+
+    // choose odd count and batch size to get left-over data on every level
+    alps::alea::autocorr_acc<double> acc(2, 3);
+    alps::alea::autocorr_result<double> snapshot;
+    alps::alea::bundle<double> carry(2, 3);
+    fill(model, acc, 1000);
+    acc.result_to(snapshot);
+    fill(model, acc, 12345);
+    acc.result_to(snapshot, carry);
+
+    alps::alea::autocorr_result<double> res = acc.finalize();
+    ASSERT_EQ(res.nlevel(), snapshot.nlevel());
+    for (size_t i = 0; i != res.nlevel(); ++i) {
+        EXPECT_EQ(res.level(i).count(), snapshot.level(i).count());
+        EXPECT_NEAR(res.level(i).count2(), snapshot.level(i).count2(), 1e-6);
+        for (size_t j = 0; j != 2; ++j) {
+            EXPECT_NEAR(res.level(i).mean()(j), snapshot.level(i).mean()(j), 1e-10);
+            if (std::isfinite(res.level(i).var()(j)))  // top level: one batch
+                EXPECT_NEAR(res.level(i).var()(j), snapshot.level(i).var()(j), 1e-8);
+            else
+                EXPECT_FALSE(std::isfinite(snapshot.level(i).var()(j)));
+        }
+    }
+}
+
 TEST(var1_test, same)
 {
     Eigen::VectorXd phi0(2), veps_one(2), veps_two(2);
@@ -224,3 +325,275 @@ TEST(var1_test, same)
     t2 = alps::alea::test_mean(res1, res2);
     ASSERT_GE(t2.pvalue(), 0.01);
 }
+
+TEST(var1_test, autocorr_merge)
+{
+    Eigen::VectorXd phi0(2), veps(2);
+    Eigen::MatrixXd phi1(2,2);
+    phi0 << 2, 3;
+    phi1 << .80, 0, 0, .64;
+    veps << 1.0, 0.25;
+    alps::alea::util::var1_model<double> model(phi0, phi1, veps);
+
+    // accumulate two independent chains of different lengths
+    alps::alea::autocorr_acc<double> acc1(2), acc2(2);
+    alps::alea::util::var1_run<double> run1 = model.start(), run2 = model.start();
+    boost::random::mt19937 engine1(1), engine2(2);
+    while (run1.t() < 300000) {
+        run1.step(engine1);
+        acc1 << run1.xt();
+    }
+    while (run2.t() < 100001) {
+        run2.step(engine2);
+        acc2 << run2.xt();
+    }
+
+    acc1 << acc2.finalize();
+    EXPECT_EQ(400001u, acc1.count());
+    for (size_t i = 0; i != acc1.nlevel(); ++i)
+        EXPECT_EQ(1u << i, acc1.level(i).batch_size());
+
+    alps::alea::autocorr_result<double> res = acc1.finalize();
+    print_result(std::cerr, res);
+    for (size_t i = 0; i != res.nlevel(); ++i)
+        EXPECT_EQ(400001u, res.level(i).count());
+
+    alps::alea::t2_result t2 = alps::alea::test_mean(res, model.mean());
+    print_t2(std::cerr, t2);
+    ASSERT_GE(t2.pvalue(), 0.01);
+
+    std::vector<double> tau = res.tau();
+    EXPECT_NEAR(model.ctau()(0,0), tau[0], 0.5);
+    EXPECT_NEAR(model.ctau()(1,1), tau[1], 0.5);
+}
+
+TEST(var1_test, autocorr_function)
+{
+    Eigen::VectorXd phi0(2), veps(2);
+    Eigen::MatrixXd phi1(2,2);
+    phi0 << 2, 3;
+    phi1 << .80, 0, 0, .64;
+    veps << 1.0, 0.25;
+    alps::alea::util::var1_model<double> model(phi0, phi1, veps);
+
+    const size_t nsteps = 200000;
+    Eigen::MatrixXd series(2, nsteps);
+    alps::alea::util::var1_run<double> run = model.start();
+    boost::random::mt19937 engine(1);
+    for (size_t t = 0; t != nsteps; ++t) {
+        run.step(engine);
+        series.col(t) = run.xt();
+    }
+
+    // compare with naive O(N^2) estimate on a short piece of the series
+    const size_t nshort = 100;
+    Eigen::MatrixXd short_series = series.leftCols(nshort);
+    Eigen::MatrixXd short_acf = alps::alea::autocorr_function(short_series);
+    ASSERT_EQ(2, short_acf.rows());
+    ASSERT_EQ((long)nshort, short_acf.cols());
+    for (size_t i = 0; i != 2; ++i) {
+        Eigen::VectorXd dev = short_series.row(i).array() - short_series.row(i).mean();
+        for (size_t t = 0; t != nshort; ++t) {
+            double gamma = dev.head(nshort - t).dot(dev.tail(nshort - t));
+            EXPECT_NEAR(gamma / dev.squaredNorm(), short_acf(i, t), 1e-10);
+        }
+    }
+
+    // AR(1) process has exponentially decaying autocorrelation
+    Eigen::MatrixXd acf = alps::alea::autocorr_function(series, 50);
+    ASSERT_EQ(51, acf.cols());
+    EXPECT_NEAR(1.0, acf(0, 0), 1e-12);
+    EXPECT_NEAR(0.8, acf(0, 1), 0.02);
+    EXPECT_NEAR(0.64, acf(1, 1), 0.02);
+    EXPECT_NEAR(std::pow(0.8, 5), acf(0, 5), 0.03);
+
+    std::vector<size_t> window = alps::alea::sokal_window(acf);
+    EXPECT_GT(window[0], window[1]);
+
+    std::vector<double> tau = alps::alea::sokal_tau(acf);
+    EXPECT_NEAR(model.ctau()(0,0), tau[0], 0.5);
+    EXPECT_NEAR(model.ctau()(1,1), tau[1], 0.5);
+}
+
+/** Naive estimate of the normalized autocorrelation of row `i` at lag `t` */
+template <typename Matrix>
+double naive_acf(const Matrix &series, size_t i, size_t t)
+{
+    size_t n = series.cols();
+    typedef typename Matrix::Scalar scalar_type;
+    Eigen::Matrix<scalar_type, 1, Eigen::Dynamic> dev =
+        series.row(i).array() - series.row(i).mean();
+    double gamma = std::real(dev.head(n - t).dot(dev.tail(n - t)));
+    return gamma / dev.squaredNorm();
+}
+
+TEST(autocorr_function, batch_result)
+{
+    // enough samples for the hopper to rebatch, such that slot order is not
+    // time order
+    const size_t nsamples = 300;
+    Eigen::MatrixXd series = Eigen::MatrixXd::Random(2, nsamples);
+    alps::alea::batch_acc<double> acc(2, 64, 1);
+    for (size_t t = 0; t != nsamples; ++t)
+        acc << alps::alea::column<double>(series.col(t));
+    alps::alea::batch_result<double> res = acc.finalize();
+
+    // rebuild the series of batch means from the time ranges of the batches
+    const alps::alea::batch_data<double> &store = res.store();
+    std::vector<std::pair<uint64_t, uint64_t> > ranges;
+    for (size_t i = 0; i != store.num_batches(); ++i) {
+        if (store.count()(i) != 0)
+            ranges.push_back(std::make_pair(store.offset()(i), store.count()(i)));
+    }
+    std::sort(ranges.begin(), ranges.end());
+    Eigen::MatrixXd means(2, ranges.size());
+    for (size_t j = 0; j != ranges.size(); ++j)
+        means.col(j) = series.middleCols(ranges[j].first, ranges[j].second).rowwise().mean();
+
+    Eigen::MatrixXd acf = alps::alea::autocorr_function(res, 10);
+    ASSERT_EQ(11, acf.cols());
+    for (size_t i = 0; i != 2; ++i) {
+        for (size_t t = 0; t <= 10; ++t)
+            EXPECT_NEAR(naive_acf(means, i, t), acf(i, t), 1e-10);
+    }
+}
+
+TEST(autocorr_function, batched)
+{
+    // odd number of real components, such that one is not paired
+    Eigen::MatrixXd series = Eigen::MatrixXd::Random(5, 300);
+    Eigen::MatrixXd acf = alps::alea::autocorr_function(series);
+    for (size_t i = 0; i != 5; ++i) {
+        for (size_t t = 0; t < 300; t += 7)
+            EXPECT_NEAR(naive_acf(series, i, t), acf(i, t), 1e-10);
+    }
+
+    Eigen::MatrixXcd cseries = Eigen::MatrixXcd::Random(3, 300);
+    Eigen::MatrixXd cacf = alps::alea::autocorr_function(cseries);
+    for (size_t i = 0; i != 3; ++i) {
+        for (size_t t = 0; t < 300; t += 7)
+            EXPECT_NEAR(naive_acf(cseries, i, t), cacf(i, t), 1e-10);
+    }
+
+    // long series are transformed in several batches
+    Eigen::MatrixXd long_series = Eigen::MatrixXd::Random(3, (1 << 20) + 1);
+    Eigen::MatrixXd long_acf = alps::alea::autocorr_function(long_series, 3);
+    ASSERT_EQ(4, long_acf.cols());
+    for (size_t i = 0; i != 3; ++i) {
+        for (size_t t = 0; t != 4; ++t)
+            EXPECT_NEAR(naive_acf(long_series, i, t), long_acf(i, t), 1e-10);
+    }
+}
+
+TEST(var1_test, autocorr_merge_mismatch)
+{
+    alps::alea::autocorr_acc<double> acc1(2, 1), acc2(2, 4);
+    for (size_t i = 0; i != 100; ++i)
+        acc2 << std::vector<double>{1.0 * i, 2.0 * i};
+
+    EXPECT_THROW(acc1 << acc2.finalize(), alps::alea::size_mismatch);
+}
+
+TEST(var1_test, batch_merge)
+{
+    Eigen::VectorXd phi0(2), veps(2);
+    Eigen::MatrixXd phi1(2,2);
+    phi0 << 2, 3;
+    phi1 << .80, 0, 0, .64;
+    veps << 1.0, 0.25;
+    alps::alea::util::var1_model<double> model(phi0, phi1, veps);
+
+    // accumulate two independent chains with different number of batches
+    alps::alea::batch_acc<double> acc1(2, 64), acc2(2, 32);
+    alps::alea::util::var1_run<double> run1 = model.start(), run2 = model.start();
+    boost::random::mt19937 engine1(1), engine2(2);
+    while (run1.t() < 300000) {
+        run1.step(engine1);
+        acc1 << run1.xt();
+    }
+    while (run2.t() < 100001) {
+        run2.step(engine2);
+        acc2 << run2.xt();
+    }
+
+    acc1 << acc2.finalize();
+    EXPECT_EQ(400001u, acc1.count());
+    EXPECT_EQ(64u, acc1.num_batches());
+
+    alps::alea::batch_result<double> res = acc1.finalize();
+    std::cerr << res << "\n";
+
+    alps::alea::t2_result t2 = alps::alea::test_mean(res, model.mean());
+    print_t2(std::cerr, t2);
+    ASSERT_GE(t2.pvalue(), 0.01);
+}
+
+TEST(var1_test, batch_merge_separate)
+{
+    // two "chains" with constant and increasing values in disjoint ranges
+    alps::alea::batch_acc<double> acc1(1, 8), acc2(1, 8);
+    for (size_t i = 0; i != 1001; ++i)
+        acc1 << 1.0;
+    for (size_t i = 0; i != 1001; ++i)
+        acc2 << 2.0 + i / 1001.0;
+
+    acc1 << acc2.finalize();
+    EXPECT_EQ(2002u, acc1.count());
+
+    // all batches but the one on the seam must come from a single chain
+    const alps::alea::batch_data<double> &store = acc1.store();
+    size_t nmixed = 0;
+    for (size_t i = 0; i != store.num_batches(); ++i) {
+        double mean = store.batch()(0, i) / store.count()(i);
+        if (std::abs(mean - 1.0) > 1e-12 && (mean < 2.0 || mean > 3.0))
+            ++nmixed;
+    }
+    EXPECT_LE(nmixed, 1u);
+
+    // batches must be contiguous in time: the second chain increases
+    // linearly, so each batch mean is fixed by its offset and count
+    for (size_t i = 0; i != store.num_batches(); ++i) {
+        if (store.count()(i) == 0)
+            continue;
+        double mean = store.batch()(0, i) / store.count()(i);
+        double first = store.offset()(i);
+        if (first < 1001) {
+            EXPECT_NEAR(1.0, mean, 1e-12);
+        } else {
+            double mid = first - 1001 + 0.5 * (store.count()(i) - 1);
+            EXPECT_NEAR(2.0 + mid / 1001.0, mean, 1e-12);
+        }
+    }
+}
+
+TEST(var1_test, batch_merge_offsets)
+{
+    // merge before the batches are full, such that whole batches are added
+    // to slots which were never merged into
+    alps::alea::batch_acc<double> acc1(1, 8, 1), acc2(1, 8, 1);
+    for (size_t i = 0; i != 3; ++i)
+        acc1 << 1.0;
+    for (size_t i = 0; i != 100; ++i)
+        acc2 << 2.0;
+
+    acc1 << acc2.finalize();
+    EXPECT_EQ(103u, acc1.count());
+
+    // in time order, each batch must start where the previous one ends
+    const alps::alea::batch_data<double> &store = acc1.store();
+    std::vector<size_t> order;
+    for (size_t i = 0; i != store.num_batches(); ++i) {
+        if (store.count()(i) != 0)
+            order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return store.offset()(a) < store.offset()(b);
+        });
+
+    uint64_t offset = 0;
+    for (size_t i : order) {
+        EXPECT_EQ(offset, store.offset()(i));
+        offset += store.count()(i);
+    }
+    EXPECT_EQ(103u, offset);
+}
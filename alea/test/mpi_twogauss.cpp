@@ -15,6 +15,7 @@
 #include "dataset.hpp"
 
 #include <iostream>
+#include <type_traits>
 
 TEST(reducer, setup)
 {
@@ -101,9 +102,10 @@ public:
 
         EXPECT_EQ(setup.have_result, result.valid());
         if (setup.have_result) {
+            const double tol = std::is_same<value_type, float>::value ? 1e-5 : 1e-6;
             std::vector<value_type> obs_mean = result.mean();
-            EXPECT_NEAR(obs_mean[0], twogauss_mean[0], 1e-6);
-            EXPECT_NEAR(obs_mean[1], twogauss_mean[1], 1e-6);
+            EXPECT_NEAR(obs_mean[0], twogauss_mean[0], tol);
+            EXPECT_NEAR(obs_mean[1], twogauss_mean[1], tol);
         }
     }
 
@@ -118,6 +120,11 @@ typedef ::testing::Types<
     , alps::alea::cov_acc<double>
     , alps::alea::autocorr_acc<double>
     , alps::alea::batch_acc<double>
+    , alps::alea::mean_acc<float>
+    , alps::alea::var_acc<float>
+    , alps::alea::cov_acc<float>
+    , alps::alea::autocorr_acc<float>
+    , alps::alea::batch_acc<float>
     > test_types;
 
 TYPED_TEST_CASE(mpi_twogauss_case, test_types);
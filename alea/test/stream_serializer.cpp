@@ -125,7 +125,8 @@ public:
     {
         Acc in_acc(2);
         for (size_t i = 0; i != twogauss_count; ++i)
-            in_acc << std::vector<value_type>{twogauss_data[i][0], twogauss_data[i][1]};
+            in_acc << std::vector<value_type>{value_type(twogauss_data[i][0]),
+                                              value_type(twogauss_data[i][1])};
 
         auto in = in_acc.result();
         std::cerr << alps::alea::PRINT_VERBOSE << "\nin\n" << in;
@@ -158,6 +159,11 @@ typedef ::testing::Types<
       , autocorr_acc<std::complex<double> >
       , batch_acc<double>
       , batch_acc<std::complex<double> >
+      , mean_acc<float>
+      , var_acc<std::complex<float>, elliptic_var>
+      , cov_acc<float>
+      , autocorr_acc<std::complex<float> >
+      , batch_acc<float>
     > stream_serializable;
 
 TYPED_TEST_CASE(twogauss_serialize_case, stream_serializable);
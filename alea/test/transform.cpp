@@ -6,6 +6,7 @@
 #include <alps/alea/mean.hpp>
 #include <alps/alea/variance.hpp>
 #include <alps/alea/covariance.hpp>
+#include <alps/alea/blockcov.hpp>
 #include <alps/alea/convert.hpp>
 #include <alps/alea/transform.hpp>
 #include <alps/alea/transformer.hpp>
@@ -39,6 +40,189 @@ TEST(jacobian, linear)
     ALPS_EXPECT_NEAR(tfmat, jac, 1e-6);
 }
 
+TEST(jacobian, block)
+{
+    Eigen::MatrixXd tfmat = Eigen::MatrixXd::Zero(5, 5);
+    tfmat.topLeftCorner(2, 2) = Eigen::MatrixXd::Random(2, 2);
+    tfmat.bottomRightCorner(3, 3) = Eigen::MatrixXd::Random(3, 3);
+    alps::alea::linear_transformer<double> tf = tfmat;
+
+    Eigen::VectorXd x(5);
+    x << 1, 5, 3, -2, 0.5;
+    std::vector<Eigen::MatrixXd> jac = alps::alea::block_jacobian<double>(
+                                            tf, x, std::vector<size_t>{2, 3}, 0.1);
+
+    ASSERT_EQ(2u, jac.size());
+    ALPS_EXPECT_NEAR(Eigen::MatrixXd(tfmat.topLeftCorner(2, 2)), jac[0], 1e-6);
+    ALPS_EXPECT_NEAR(Eigen::MatrixXd(tfmat.bottomRightCorner(3, 3)), jac[1], 1e-6);
+}
+
+struct polar_fn
+{
+    // (r, phi) -> (r cos(phi), r sin(phi), log(r))
+    template <typename S>
+    alps::alea::column<S> operator() (const alps::alea::column<S> &in) const
+    {
+        using std::cos; using std::sin; using std::log;
+        alps::alea::column<S> out(3);
+        out(0) = in(0) * cos(in(1));
+        out(1) = in(0) * sin(in(1));
+        out(2) = log(in(0));
+        return out;
+    }
+};
+
+struct matrix_fn
+{
+    template <typename S>
+    alps::alea::column<S> operator() (const alps::alea::column<S> &in) const
+    {
+        alps::alea::column<S> out(mat.rows());
+        for (size_t i = 0; i != (size_t)mat.rows(); ++i) {
+            S sum = S(0);
+            for (size_t j = 0; j != (size_t)mat.cols(); ++j)
+                sum += mat(i, j) * in(j);
+            out(i) = sum;
+        }
+        return out;
+    }
+
+    Eigen::MatrixXd mat;
+};
+
+TEST(jacobian, dual)
+{
+    auto tf = alps::alea::make_dual_transformer<double>(2, 3, polar_fn());
+
+    Eigen::VectorXd x(2);
+    x << 2.0, 0.3;
+    Eigen::MatrixXd jac = alps::alea::jacobian<double>(tf, x);
+
+    Eigen::MatrixXd exact(3, 2);
+    exact << std::cos(0.3), -2.0 * std::sin(0.3),
+             std::sin(0.3),  2.0 * std::cos(0.3),
+             0.5,            0.0;
+    ALPS_EXPECT_NEAR(exact, jac, 1e-14);
+
+    // finite differences are biased, but must be close
+    Eigen::MatrixXd fd_jac = alps::alea::jacobian<double>(tf, x, 1e-6);
+    ALPS_EXPECT_NEAR(exact, fd_jac, 1e-5);
+
+    // block-diagonal transform must give the diagonal blocks
+    Eigen::MatrixXd tfmat = Eigen::MatrixXd::Zero(5, 5);
+    tfmat.topLeftCorner(2, 2) = Eigen::MatrixXd::Random(2, 2);
+    tfmat.bottomRightCorner(3, 3) = Eigen::MatrixXd::Random(3, 3);
+    auto lin_tf = alps::alea::make_dual_transformer<double>(5, 5,
+                                                            matrix_fn{tfmat});
+
+    Eigen::VectorXd y(5);
+    y << 1, 5, 3, -2, 0.5;
+    std::vector<Eigen::MatrixXd> block_jac = alps::alea::block_jacobian<double>(
+                                            lin_tf, y, std::vector<size_t>{2, 3});
+    ASSERT_EQ(2u, block_jac.size());
+    ALPS_EXPECT_NEAR(Eigen::MatrixXd(tfmat.topLeftCorner(2, 2)), block_jac[0], 1e-14);
+    ALPS_EXPECT_NEAR(Eigen::MatrixXd(tfmat.bottomRightCorner(3, 3)), block_jac[1], 1e-14);
+}
+
+TEST(jacobian, dual_pow)
+{
+    typedef alps::alea::dual<double> dual;
+
+    // the derivative is finite at zero for positive powers
+    dual x = dual::variable(0.0, 1, 0);
+    EXPECT_EQ(0.0, pow(x, 2.0).value());
+    EXPECT_EQ(0.0, pow(x, 2.0).tangent()(0));
+    EXPECT_EQ(1.0, pow(x, 1.0).tangent()(0));
+
+    dual y = dual::variable(3.0, 1, 0);
+    EXPECT_NEAR(9.0, pow(y, 2.0).value(), 1e-14);
+    EXPECT_NEAR(6.0, pow(y, 2.0).tangent()(0), 1e-14);
+    EXPECT_NEAR(0.5 / std::sqrt(3.0), pow(y, 0.5).tangent()(0), 1e-14);
+}
+
+TEST(jacobian, dual_inplace)
+{
+    typedef alps::alea::dual<double> dual;
+
+    // compound assignment updates the tangent in place, also if aliased
+    dual x = dual::variable(3.0, 2, 0);
+    dual y = dual::variable(2.0, 2, 1);
+    x *= x;
+    EXPECT_NEAR(9.0, x.value(), 1e-14);
+    EXPECT_NEAR(6.0, x.tangent()(0), 1e-14);
+    EXPECT_EQ(0.0, x.tangent()(1));
+
+    x /= y;
+    EXPECT_NEAR(4.5, x.value(), 1e-14);
+    EXPECT_NEAR(3.0, x.tangent()(0), 1e-14);
+    EXPECT_NEAR(-2.25, x.tangent()(1), 1e-14);
+
+    // constants on either side have an empty tangent
+    dual z = 1.0 - x;
+    EXPECT_NEAR(-3.5, z.value(), 1e-14);
+    EXPECT_NEAR(-3.0, z.tangent()(0), 1e-14);
+    EXPECT_NEAR(2.25, z.tangent()(1), 1e-14);
+    EXPECT_TRUE((dual(2.0) * dual(3.0)).is_constant());
+}
+
+TEST(jacobian, dual_float)
+{
+    auto tf = alps::alea::make_dual_transformer<float>(2, 3, polar_fn());
+
+    Eigen::VectorXf x(2);
+    x << 2.0f, 0.3f;
+    Eigen::MatrixXf jac = alps::alea::jacobian<float>(tf, x);
+
+    Eigen::MatrixXf exact(3, 2);
+    exact << std::cos(0.3f), -2.0f * std::sin(0.3f),
+             std::sin(0.3f),  2.0f * std::cos(0.3f),
+             0.5f,            0.0f;
+    ALPS_EXPECT_NEAR(exact, jac, 1e-6);
+}
+
+TEST(twogauss, blockcov)
+{
+    // duplicate the data into two blocks, where the second is negated
+    alps::alea::blockcov_acc<double> acc(std::vector<size_t>{2, 2});
+    alps::alea::cov_acc<double> ref_acc(4);
+    for (size_t i = 0; i != twogauss_count; ++i) {
+        Eigen::Vector4d dat;
+        dat << twogauss_data[i][0], twogauss_data[i][1],
+               -twogauss_data[i][0], -twogauss_data[i][1];
+        acc << alps::alea::column<double>(dat);
+        ref_acc << alps::alea::column<double>(dat);
+    }
+
+    alps::alea::blockcov_result<double> res = acc.finalize();
+    alps::alea::cov_result<double> ref_res = ref_acc.finalize();
+    EXPECT_EQ(2u, res.nblocks());
+    ALPS_EXPECT_NEAR(ref_res.mean(), res.mean(), 1e-12);
+    ALPS_EXPECT_NEAR(ref_res.var(), res.var(), 1e-12);
+    ALPS_EXPECT_NEAR(Eigen::MatrixXd(ref_res.cov().topLeftCorner(2, 2)),
+                     res.block_cov(0), 1e-12);
+    ALPS_EXPECT_NEAR(Eigen::MatrixXd(ref_res.cov().bottomRightCorner(2, 2)),
+                     res.block_cov(1), 1e-12);
+    EXPECT_EQ(0, res.cov()(0, 2));
+
+    // transform within blocks must coincide with the full transform
+    Eigen::MatrixXd tfmat = Eigen::MatrixXd::Zero(4, 4);
+    tfmat << 1, 2, 0, 0,
+             3, 4, 0, 0,
+             0, 0, 5, 6,
+             0, 0, 7, 8;
+    alps::alea::linear_transformer<double> tf = tfmat;
+    alps::alea::blockcov_result<double> tf_res =
+                alps::alea::transform(alps::alea::linear_prop(), tf, res);
+    alps::alea::cov_result<double> tf_ref_res =
+                alps::alea::transform(alps::alea::linear_prop(), tf, ref_res);
+
+    ALPS_EXPECT_NEAR(tf_ref_res.mean(), tf_res.mean(), 1e-10);
+    ALPS_EXPECT_NEAR(Eigen::MatrixXd(tf_ref_res.cov().topLeftCorner(2, 2)),
+                     tf_res.block_cov(0), 1e-8);
+    ALPS_EXPECT_NEAR(Eigen::MatrixXd(tf_ref_res.cov().bottomRightCorner(2, 2)),
+                     tf_res.block_cov(1), 1e-8);
+}
+
 TEST(types, joinings)
 {
     using alps::alea::internal::joined;
@@ -183,6 +367,39 @@ TEST(twogauss, ratio) {
 }
 
 
+struct ratio_fn
+{
+    template <typename S>
+    alps::alea::column<S> operator() (const alps::alea::column<S> &in) const
+    {
+        alps::alea::column<S> res(1);
+        res(0) = in(0) / in(1);
+        return res;
+    }
+};
+
+TEST(twogauss, ratio_dual) {
+    alps::alea::cov_acc<double> acc(2);
+    for (size_t i = 0; i != twogauss_count; ++i) {
+        Eigen::Map<Eigen::Vector2d> dat((double *)twogauss_data[i], 2);
+        acc << alps::alea::column<double>(dat);
+    }
+    alps::alea::cov_result<double> res = acc.finalize();
+
+    // exact and finite-difference Jacobians must agree to leading order
+    auto dual_tf = alps::alea::make_dual_transformer<double>(2, 1, ratio_fn());
+    alps::alea::cov_result<double> dual_res =
+                alps::alea::transform(alps::alea::linear_prop(), dual_tf, res);
+    alps::alea::cov_result<double> fd_res =
+                alps::alea::transform(alps::alea::linear_prop(),
+                                      transformer_ratio<double>(), res);
+
+    ALPS_EXPECT_NEAR(fd_res.mean(), dual_res.mean(), 1e-14);
+    EXPECT_NEAR(fd_res.var()[0], dual_res.var()[0], 0.05 * fd_res.var()[0]);
+    EXPECT_NEAR(dual_res.mean()[0], twogauss_mean[0] / twogauss_mean[1],
+                dual_res.stderror()[0]);
+}
+
 template<typename T>
 struct transformer_id : public alps::alea::transformer<T>
 {
@@ -233,6 +450,7 @@ public:
 typedef ::testing::Types<
       alps::alea::var_acc<double>
     , alps::alea::cov_acc<double>
+    , alps::alea::blockcov_acc<double>
     , alps::alea::autocorr_acc<double>
     , alps::alea::batch_acc<double>
     > batchable;
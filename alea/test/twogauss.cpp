@@ -6,16 +6,20 @@
 #include <alps/alea/mean.hpp>
 #include <alps/alea/variance.hpp>
 #include <alps/alea/covariance.hpp>
+#include <alps/alea/blockcov.hpp>
 #include <alps/alea/autocorr.hpp>
 #include <alps/alea/batch.hpp>
+#include <alps/alea/concurrent.hpp>
 
 #include <alps/alea/hdf5.hpp>
 #include <alps/alea/util/serializer.hpp>
+#include <alps/testing/unique_file.hpp>
 
 #include "gtest/gtest.h"
 #include "dataset.hpp"
 
 #include <iostream>
+#include <thread>
 
 template <typename Acc>
 class twogauss_setup
@@ -51,6 +55,31 @@ private:
 
 // MEAN
 
+/**
+ * Checks that the scalar data sets below `plain`, written without scalar
+ * attributes, are attributes rather than data sets below `attr`.  Returns
+ * the number of scalars found.
+ */
+size_t check_scalar_attributes(alps::hdf5::archive &ar, const std::string &plain,
+                               const std::string &attr)
+{
+    size_t nscalar = 0;
+    for (const std::string &child : ar.list_children(plain)) {
+        std::string plain_child = plain + "/" + child;
+        std::string attr_child = attr + "/" + child;
+        if (ar.is_group(plain_child)) {
+            nscalar += check_scalar_attributes(ar, plain_child, attr_child);
+        } else if (ar.is_scalar(plain_child)) {
+            EXPECT_FALSE(ar.is_data(attr_child)) << attr_child;
+            EXPECT_TRUE(ar.is_attribute(attr + "/@" + child)) << attr_child;
+            ++nscalar;
+        } else {
+            EXPECT_TRUE(ar.is_data(attr_child)) << attr_child;
+        }
+    }
+    return nscalar;
+}
+
 template <typename Acc>
 class twogauss_mean_case
     : public ::testing::Test
@@ -70,6 +99,26 @@ public:
         EXPECT_NEAR(twogauss_mean[1], obs_mean[1], 1e-6);
     }
 
+    void test_result_to()
+    {
+        result_type res;
+        this->acc().result_to(res);
+        this->acc().result_to(res);     // re-uses storage of res
+        EXPECT_TRUE(this->acc().valid());
+        std::vector<value_type> obs_mean = res.mean();
+        EXPECT_NEAR(twogauss_mean[0], obs_mean[0], 1e-6);
+        EXPECT_NEAR(twogauss_mean[1], obs_mean[1], 1e-6);
+
+        // snapshot must agree with the result also after further additions
+        this->acc() << std::vector<value_type>{1.0, -1.0};
+        this->acc().result_to(res);
+        std::vector<value_type> exp_mean = this->acc().result().mean();
+        obs_mean = res.mean();
+        EXPECT_NEAR(exp_mean[0], obs_mean[0], 1e-12);
+        EXPECT_NEAR(exp_mean[1], obs_mean[1], 1e-12);
+        EXPECT_EQ(this->acc().count(), res.count());
+    }
+
     void test_finalize()
     {
         std::vector<value_type> obs_mean = this->acc().finalize().mean();
@@ -130,6 +179,40 @@ public:
         }
     }
 
+    void test_attributes()
+    {
+        // use a fresh file, since the archive does not truncate existing ones
+        alps::testing::unique_file ufile("twogauss_attributes.h5.",
+                                         alps::testing::unique_file::REMOVE_NOW);
+        result_type res = this->acc().finalize();
+        {
+            alps::hdf5::archive ar(ufile.name(), "w");
+            alps::alea::hdf5_serializer plain(ar, "");
+            alps::alea::serialize(plain, "plain", res);
+            alps::alea::hdf5_serializer ser(ar, "", true);
+            alps::alea::serialize(ser, "first", res);
+            alps::alea::serialize(ser, "second", res);
+        }
+
+        {
+            alps::hdf5::archive ar(ufile.name(), "r");
+            size_t nscalar = check_scalar_attributes(ar, "/plain", "/second");
+            // batch results have no scalars besides the @-attributes
+            if (!std::is_same<Acc, alps::alea::batch_acc<value_type> >::value) {
+                EXPECT_NE(0u, nscalar);
+            }
+
+            alps::alea::hdf5_serializer ser(ar, "");
+            result_type res2;
+
+            alps::alea::deserialize(ser, "second", res2);
+            EXPECT_EQ(res.count(), res2.count());
+            std::vector<value_type> obs_mean = res2.mean();
+            EXPECT_NEAR(twogauss_mean[0], obs_mean[0], 1e-6);
+            EXPECT_NEAR(twogauss_mean[1], obs_mean[1], 1e-6);
+        }
+    }
+
     void test_merge()
     {
         result_type res = this->acc().result();
@@ -149,6 +232,7 @@ typedef ::testing::Types<
       alps::alea::mean_acc<double>
     , alps::alea::var_acc<double>
     , alps::alea::cov_acc<double>
+    , alps::alea::blockcov_acc<double>
     , alps::alea::autocorr_acc<double>
     , alps::alea::batch_acc<double>
     > has_mean;
@@ -159,6 +243,8 @@ TYPED_TEST(twogauss_mean_case, test_resize) { this->test_resize(); }
 
 TYPED_TEST(twogauss_mean_case, test_result) { this->test_result(); }
 
+TYPED_TEST(twogauss_mean_case, test_result_to) { this->test_result_to(); }
+
 TYPED_TEST(twogauss_mean_case, test_finalize) { this->test_finalize(); }
 
 TYPED_TEST(twogauss_mean_case, test_lifecycle) { this->test_lifecycle(); }
@@ -167,8 +253,65 @@ TYPED_TEST(twogauss_mean_case, test_serialize) { this->test_serialize(); }
 
 TYPED_TEST(twogauss_mean_case, test_sederialize) { this->test_sederialize(); }
 
+TYPED_TEST(twogauss_mean_case, test_attributes) { this->test_attributes(); }
+
 TYPED_TEST(twogauss_mean_case, test_merge) { this->test_merge(); }
 
+// SINGLE PRECISION
+
+template <typename Acc>
+class twogauss_float_case
+    : public ::testing::Test
+    , public twogauss_setup<Acc>
+{
+public:
+    typedef typename alps::alea::traits<Acc>::value_type value_type;
+    typedef typename alps::alea::traits<Acc>::result_type result_type;
+
+    twogauss_float_case() : twogauss_setup<Acc>() { }
+
+    void test_hdf5()
+    {
+        alps::testing::unique_file ufile("twogauss_float.h5.",
+                                         alps::testing::unique_file::REMOVE_NOW);
+        result_type res = this->acc().finalize();
+        {
+            alps::hdf5::archive ar(ufile.name(), "w");
+            alps::alea::hdf5_serializer ser(ar, "");
+            alps::alea::serialize(ser, "float", res);
+        }
+
+        {
+            alps::hdf5::archive ar(ufile.name(), "r");
+            alps::alea::hdf5_serializer ser(ar, "");
+            result_type res2;
+            alps::alea::deserialize(ser, "float", res2);
+
+            // the file holds doubles, so the round trip keeps float precision
+            // up to the order of summation (batches are stored in time order)
+            EXPECT_EQ(res.count(), res2.count());
+            std::vector<value_type> mean = res.mean(), mean2 = res2.mean();
+            EXPECT_NEAR(mean[0], mean2[0], 1e-6);
+            EXPECT_NEAR(mean[1], mean2[1], 1e-6);
+            EXPECT_NEAR(twogauss_mean[0], mean2[0], 1e-5);
+            EXPECT_NEAR(twogauss_mean[1], mean2[1], 1e-5);
+        }
+    }
+};
+
+typedef ::testing::Types<
+      alps::alea::mean_acc<float>
+    , alps::alea::var_acc<float>
+    , alps::alea::cov_acc<float>
+    , alps::alea::blockcov_acc<float>
+    , alps::alea::autocorr_acc<float>
+    , alps::alea::batch_acc<float>
+    > has_float;
+
+TYPED_TEST_CASE(twogauss_float_case, has_float);
+
+TYPED_TEST(twogauss_float_case, test_hdf5) { this->test_hdf5(); }
+
 // VARIANCE
 
 template <typename Acc>
@@ -192,6 +335,7 @@ public:
 typedef ::testing::Types<
       alps::alea::var_acc<double>
     , alps::alea::cov_acc<double>
+    , alps::alea::blockcov_acc<double>
     //, alps::alea::autocorr_acc<double>
     //, alps::alea::batch_acc<double>
     > has_var;
@@ -235,11 +379,221 @@ public:
 typedef ::testing::Types<
       alps::alea::var_acc<double>
     , alps::alea::cov_acc<double>
+    , alps::alea::blockcov_acc<double>
     > has_var;
 
 TYPED_TEST_CASE(twogauss_block_case, has_var);
 TYPED_TEST(twogauss_block_case, test) { this->test(); }
 
+// COVARIANCE
+
+template <typename Acc>
+class twogauss_cov_case
+    : public ::testing::Test
+    , public twogauss_setup<Acc>
+{
+public:
+    typedef typename alps::alea::traits<Acc>::value_type value_type;
+    typedef typename alps::alea::traits<Acc>::cov_type cov_type;
+
+    twogauss_cov_case() : twogauss_setup<Acc>() { }
+
+    void test()
+    {
+        // explicit two-pass estimate for comparison
+        Eigen::Matrix<cov_type, 2, 2> expected = Eigen::Matrix<cov_type, 2, 2>::Zero();
+        for (size_t i = 0; i != twogauss_count; ++i) {
+            Eigen::Matrix<value_type, 2, 1> x;
+            x << twogauss_data[i][0] - twogauss_mean[0],
+                 twogauss_data[i][1] - twogauss_mean[1];
+            expected += x * x.adjoint();
+        }
+        expected /= twogauss_count - 1.0;
+
+        // the batches are staged, so result() and finalize() must agree
+        typename alps::alea::traits<Acc>::result_type res = this->acc().result();
+        EXPECT_EQ(res, this->acc().finalize());
+        for (size_t i = 0; i != 2; ++i) {
+            for (size_t j = 0; j != 2; ++j)
+                EXPECT_NEAR(0, std::abs(expected(i, j) - res.cov()(i, j)), 1e-6);
+        }
+    }
+};
+
+typedef ::testing::Types<
+      alps::alea::cov_acc<double>
+    , alps::alea::cov_acc<std::complex<double> >
+    , alps::alea::blockcov_acc<double>
+    > has_cov;
+
+TYPED_TEST_CASE(twogauss_cov_case, has_cov);
+TYPED_TEST(twogauss_cov_case, test) { this->test(); }
+
+TEST(twogauss_cov_stage, const_result)
+{
+    alps::alea::cov_acc<double> acc(2);
+    for (size_t i = 0; i != twogauss_count; ++i)
+        acc << std::vector<double>(twogauss_data[i], twogauss_data[i] + 2);
+
+    // result() must not touch the accumulator, even if batches are staged
+    const alps::alea::cov_acc<double> &cacc = acc;
+    Eigen::MatrixXd before = cacc.store().data2();
+    alps::alea::cov_result<double> res = cacc.result();
+    EXPECT_EQ(before, cacc.store().data2());
+    EXPECT_EQ(res, cacc.result());
+
+    // the store holds all completed batches and both triangles
+    const alps::alea::cov_data<double> &store = cacc.store();
+    EXPECT_EQ(twogauss_count, store.count());
+    EXPECT_EQ(Eigen::MatrixXd(store.data2().transpose()), store.data2());
+    EXPECT_EQ(res, acc.result());
+    EXPECT_EQ(res, acc.finalize());
+}
+
+// SPARSE
+
+template <typename Acc>
+class twogauss_sparse_case
+    : public ::testing::Test
+{
+public:
+    typedef typename alps::alea::traits<Acc>::value_type value_type;
+    typedef typename alps::alea::traits<Acc>::result_type result_type;
+
+    void test()
+    {
+        // embed the two components into a larger vector
+        Acc dense_acc(5), sparse_acc(5);
+        std::vector<size_t> indices = {3, 1};
+        std::vector<value_type> values(2), dense(5);
+        for (size_t i = 0; i != twogauss_count; ++i) {
+            values[0] = dense[3] = twogauss_data[i][0];
+            values[1] = dense[1] = twogauss_data[i][1];
+            dense_acc << dense;
+            sparse_acc << alps::alea::make_sparse_adapter(5, indices, values);
+        }
+
+        result_type dense_res = dense_acc.finalize();
+        result_type sparse_res = sparse_acc.finalize();
+        EXPECT_EQ(dense_res.count(), sparse_res.count());
+        std::vector<value_type> dense_mean = dense_res.mean();
+        std::vector<value_type> sparse_mean = sparse_res.mean();
+        for (size_t i = 0; i != 5; ++i)
+            EXPECT_NEAR(dense_mean[i], sparse_mean[i], 1e-12);
+        EXPECT_NEAR(twogauss_mean[0], sparse_mean[3], 1e-6);
+        EXPECT_NEAR(twogauss_mean[1], sparse_mean[1], 1e-6);
+    }
+
+    void test_bad_index()
+    {
+        Acc acc(5);
+        std::vector<size_t> indices = {3, 5};
+        std::vector<value_type> values = {1.0, 2.0};
+        EXPECT_THROW(acc << alps::alea::make_sparse_adapter(5, indices, values),
+                     alps::alea::size_mismatch);
+        EXPECT_EQ(0u, acc.count());
+    }
+};
+
+typedef ::testing::Types<
+      alps::alea::mean_acc<double>
+    , alps::alea::var_acc<double>
+    , alps::alea::cov_acc<double>
+    , alps::alea::batch_acc<double>
+    > has_sparse;
+
+TYPED_TEST_CASE(twogauss_sparse_case, has_sparse);
+TYPED_TEST(twogauss_sparse_case, test) { this->test(); }
+TYPED_TEST(twogauss_sparse_case, bad_index) { this->test_bad_index(); }
+
+TEST(twogauss_sparse, cov)
+{
+    alps::alea::cov_acc<double> dense_acc(3), sparse_acc(3);
+    std::vector<size_t> indices = {2, 0};
+    std::vector<double> values(2), dense(3);
+    for (size_t i = 0; i != twogauss_count; ++i) {
+        values[0] = dense[2] = twogauss_data[i][0];
+        values[1] = dense[0] = twogauss_data[i][1];
+        dense_acc << dense;
+        sparse_acc << alps::alea::make_sparse_adapter(3, indices, values);
+    }
+
+    alps::alea::cov_result<double> dense_res = dense_acc.finalize();
+    alps::alea::cov_result<double> sparse_res = sparse_acc.finalize();
+    for (size_t i = 0; i != 3; ++i) {
+        for (size_t j = 0; j != 3; ++j)
+            EXPECT_NEAR(dense_res.cov()(i, j), sparse_res.cov()(i, j), 1e-10);
+    }
+    EXPECT_NEAR(twogauss_var[0], sparse_res.var()(2), 1e-6);
+    EXPECT_NEAR(twogauss_var[1], sparse_res.var()(0), 1e-6);
+}
+
+// CONCURRENT
+
+template <typename Acc>
+class twogauss_concurrent_case
+    : public ::testing::Test
+{
+public:
+    typedef typename alps::alea::traits<Acc>::value_type value_type;
+    typedef typename alps::alea::traits<Acc>::result_type result_type;
+
+    static const size_t nthreads = 4;
+
+    static void produce(Acc &acc, size_t thread)
+    {
+        std::vector<value_type> curr(2);
+        for (size_t i = thread; i < twogauss_count; i += nthreads) {
+            std::copy(twogauss_data[i], twogauss_data[i+1], curr.begin());
+            acc << curr;
+        }
+    }
+
+    result_type run()
+    {
+        alps::alea::concurrent_acc<Acc> acc(nthreads + 1, Acc(2));
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i != nthreads; ++i)
+            threads.emplace_back(produce, std::ref(acc.producer(i)), i);
+        for (size_t i = 0; i != nthreads; ++i)
+            threads[i].join();
+
+        // partial accumulators start on separate cache lines
+        typedef alps::alea::concurrent_acc<Acc> concurrent_type;
+        for (size_t i = 0; i != acc.nproducers(); ++i) {
+            EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(&acc.producer(i))
+                                    % concurrent_type::CACHE_LINE);
+        }
+
+        // last producer stays idle
+        EXPECT_EQ(twogauss_count, acc.count());
+        return acc.result();
+    }
+
+    void test()
+    {
+        result_type res = run();
+        EXPECT_EQ(twogauss_count, res.count());
+        std::vector<value_type> obs_mean = res.mean();
+        EXPECT_NEAR(twogauss_mean[0], obs_mean[0], 1e-6);
+        EXPECT_NEAR(twogauss_mean[1], obs_mean[1], 1e-6);
+
+        // merging in producer order makes result reproducible
+        std::vector<value_type> obs_mean2 = run().mean();
+        EXPECT_EQ(obs_mean, obs_mean2);
+    }
+};
+
+typedef ::testing::Types<
+      alps::alea::mean_acc<double>
+    , alps::alea::var_acc<double>
+    , alps::alea::cov_acc<double>
+    , alps::alea::autocorr_acc<double>
+    > has_concurrent;
+
+TYPED_TEST_CASE(twogauss_concurrent_case, has_concurrent);
+TYPED_TEST(twogauss_concurrent_case, test) { this->test(); }
+
 // int main(int argc, char **argv)
 // {
 //     ::testing::InitGoogleTest(&argc, argv);
@@ -41,6 +41,7 @@ cmake $alpscore_src                                   \
 -DALPS_BUNDLE_DOWNLOAD_TRIES=3                        \
 -DMPIEXEC=mpiexec -DMPIEXEC_NUMPROC_FLAG='-n'         \
 -DENABLE_MPI=$ENABLE_MPI                              \
+-DBenchmarks=ON                                       \
 ${boost_cmake_params}
 
 # TravisCI provides 2 cores, with possible bursts;
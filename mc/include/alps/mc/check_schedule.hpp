@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <ctime>
 
 namespace alps {
@@ -21,7 +24,7 @@ namespace alps {
             typedef typename clock_type::time_point_type time_point_type;
             typedef typename clock_type::time_duration_type time_duration_type;
 
-            private:
+            protected:
             clock_type clock_;
             
             bool next_check_known_;
@@ -126,8 +129,200 @@ namespace alps {
                 return std::difftime(t1, t0);
             }
         };
+
+        /// Type for monotonic time with sub-second resolution
+        class steady_clock {
+          public:
+            /// Type for "point at time" (that is, duration from some epoch)
+            typedef std::chrono::steady_clock::time_point time_point_type;
+
+            /// Type for "duration of time" in seconds
+            typedef double time_duration_type;
+
+            /// Returns current time point
+            static time_point_type now_time() { return std::chrono::steady_clock::now(); }
+
+            /// Returns a difference (duration) between time points
+            static time_duration_type time_diff(time_point_type t1, time_point_type t0)
+            {
+                return std::chrono::duration<double>(t1 - t0).count();
+            }
+        };
+
+        /// Class template to check for simulation completion, bounding the time spent in checks
+        /**
+            Schedules checks like `generic_check_schedule`, but also measures
+            the cost of each check.  The caller brackets the parts of a check
+            that block it, e.g., the stop callback and the calls to MPI, by
+            `begin_check()` and `end_check()`; the cost of a check is the time
+            spent within these brackets since the previous `update()`.  Work
+            done while a non-blocking reduction is in flight is thus not
+            counted.  The interval between checks is kept at least
+            `cost / max_overhead`, so that checks take at most about the
+            fraction `max_overhead` of the run time, unless this exceeds `tmax`.
+        */
+        template <typename CLOCK_T>
+        class generic_cost_aware_check_schedule : public generic_check_schedule<CLOCK_T> {
+            typedef generic_check_schedule<CLOCK_T> base_type;
+
+            public:
+            typedef typename base_type::clock_type clock_type;
+            typedef typename base_type::time_point_type time_point_type;
+            typedef typename base_type::time_duration_type time_duration_type;
+
+            private:
+            double max_overhead_;
+            time_duration_type cost_;
+            bool cost_known_;
+
+            time_duration_type check_cost_;
+            bool check_timed_;
+            bool in_check_;
+            time_point_type check_start_;
+
+            public:
+            /// Constructor using default clock instance
+            /**
+               \param[in] tmin minimum time to check if simulation has finished
+               \param[in] tmax maximum time to check if simulation has finished
+               \param[in] max_overhead maximum fraction of time spent in checks
+            */
+            generic_cost_aware_check_schedule(double tmin, double tmax, double max_overhead = 0.01)
+                : base_type(tmin, tmax),
+                  max_overhead_(max_overhead),
+                  cost_(),
+                  cost_known_(false),
+                  check_cost_(),
+                  check_timed_(false),
+                  in_check_(false),
+                  check_start_()
+            { }
+
+            /// Constructor using a given clock instance
+            generic_cost_aware_check_schedule(double tmin, double tmax, double max_overhead, const clock_type& clock)
+                : base_type(tmin, tmax, clock),
+                  max_overhead_(max_overhead),
+                  cost_(),
+                  cost_known_(false),
+                  check_cost_(),
+                  check_timed_(false),
+                  in_check_(false),
+                  check_start_()
+            { }
+
+            /// Starts timing a blocking part of the current check
+            void begin_check()
+            {
+                in_check_ = true;
+                check_start_ = this->clock_.now_time();
+            }
+
+            /// Stops timing a blocking part of the current check; ignored without `begin_check()`
+            void end_check()
+            {
+                if (!in_check_) return;
+                check_cost_ += this->clock_.time_diff(this->clock_.now_time(), check_start_);
+                check_timed_ = true;
+                in_check_ = false;
+            }
+
+            /// Schedule the next check based on the fraction completed and the cost of the check
+            void update(double fraction)
+            {
+                if (check_timed_) {
+                    // smooth out fluctuations of the latency
+                    cost_ = cost_known_ ? 0.5 * (cost_ + check_cost_) : check_cost_;
+                    cost_known_ = true;
+                    check_cost_ = time_duration_type();
+                    check_timed_ = false;
+                }
+                base_type::update(fraction);
+
+                time_duration_type min_check = cost_ / max_overhead_;
+                if (this->next_check_ < min_check)
+                    this->next_check_ = std::min(min_check, this->max_check_);
+            }
+
+            /// Returns the smoothed cost of a check
+            time_duration_type check_cost() const { return cost_; }
+
+            /// Returns the time until the next check
+            time_duration_type next_check() const { return this->next_check_; }
+        };
+
+        /// Marks the start of a blocking part of a check; does nothing for checkers that do not time checks
+        template <typename ScheduleChecker>
+        void begin_check(ScheduleChecker &) { }
+
+        template <typename CLOCK_T>
+        void begin_check(generic_cost_aware_check_schedule<CLOCK_T> & checker) { checker.begin_check(); }
+
+        /// Marks the end of a blocking part of a check; does nothing for checkers that do not time checks
+        template <typename ScheduleChecker>
+        void end_check(ScheduleChecker &) { }
+
+        template <typename CLOCK_T>
+        void end_check(generic_cost_aware_check_schedule<CLOCK_T> & checker) { checker.end_check(); }
+
+        /// Defines the parameters read by `make_check_schedule()`; none for custom checkers
+        /**
+            The second argument is a null pointer selecting the checker type.
+        */
+        template <typename Parameters, typename ScheduleChecker>
+        void define_check_schedule_parameters(Parameters &, ScheduleChecker *) { }
+
+        /// Defines Tmin and Tmax in whole seconds
+        template <typename Parameters>
+        void define_check_schedule_parameters(Parameters & parameters, generic_check_schedule<posix_wall_clock> *)
+        {
+            if (!parameters.defined("Tmin"))
+                parameters.template define<std::size_t>("Tmin", 1, "minimum time to check if simulation has finished");
+            if (!parameters.defined("Tmax"))
+                parameters.template define<std::size_t>("Tmax", 600, "maximum time to check if simulation has finished");
+        }
+
+        /// Defines Tmin and Tmax in seconds, as fractional numbers
+        template <typename Parameters, typename CLOCK_T>
+        void define_check_schedule_parameters(Parameters & parameters, generic_check_schedule<CLOCK_T> *)
+        {
+            if (!parameters.defined("Tmin"))
+                parameters.template define<double>("Tmin", 1., "minimum time to check if simulation has finished");
+            if (!parameters.defined("Tmax"))
+                parameters.template define<double>("Tmax", 600., "maximum time to check if simulation has finished");
+        }
+
+        /// Defines Tmin and Tmax in seconds, as fractional numbers, and CheckOverhead
+        template <typename Parameters, typename CLOCK_T>
+        void define_check_schedule_parameters(Parameters & parameters, generic_cost_aware_check_schedule<CLOCK_T> *)
+        {
+            define_check_schedule_parameters(parameters, static_cast<generic_check_schedule<CLOCK_T> *>(0));
+            if (!parameters.defined("CheckOverhead"))
+                parameters.template define<double>("CheckOverhead", 0.01, "maximum fraction of time spent in checks for completion");
+        }
+
+        /// Constructs a schedule checker from the parameters Tmin and Tmax
+        template <typename Parameters, typename ScheduleChecker>
+        ScheduleChecker make_check_schedule(Parameters const & parameters, ScheduleChecker *)
+        {
+            return ScheduleChecker(parameters["Tmin"], parameters["Tmax"]);
+        }
+
+        /// Constructs a cost-aware schedule checker from the parameters Tmin, Tmax and CheckOverhead
+        template <typename Parameters, typename CLOCK_T>
+        generic_cost_aware_check_schedule<CLOCK_T> make_check_schedule(Parameters const & parameters,
+                                                                       generic_cost_aware_check_schedule<CLOCK_T> *)
+        {
+            return generic_cost_aware_check_schedule<CLOCK_T>(parameters["Tmin"], parameters["Tmax"],
+                                                              parameters["CheckOverhead"]);
+        }
     } // detail::
         
     typedef detail::generic_check_schedule<detail::posix_wall_clock> check_schedule;
 
+    /// Schedule checker using a steady clock, for check intervals below a second
+    typedef detail::generic_check_schedule<detail::steady_clock> steady_check_schedule;
+
+    /// Schedule checker bounding the fraction of time spent in checks
+    typedef detail::generic_cost_aware_check_schedule<detail::steady_clock> cost_aware_check_schedule;
+
 } // namespace alps 
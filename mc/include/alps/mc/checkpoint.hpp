@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+#pragma once
+
+#include <alps/hdf5/archive.hpp>
+#include <alps/utilities/signal.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace alps {
+
+    /// In-memory copy of the checkpoint data of a simulation
+    /**
+       Each call to `add()` copies a value while the simulation is paused; the
+       copies are written to HDF5 later by `save()`, possibly on another
+       thread, so the snapshot must not refer to the simulation's own state.
+     */
+    class checkpoint_snapshot {
+        public:
+            /// Copy `value` now, to be written to `path` by `save()`
+            template<typename T> void add(std::string const & path, T const & value) {
+                writers.push_back([path, value](alps::hdf5::archive & ar) { ar[path] << value; });
+            }
+
+            /// Take shared ownership of `value` (e.g., a deep copy made by the caller)
+            template<typename T> void add(std::string const & path, std::shared_ptr<T> const & value) {
+                writers.push_back([path, value](alps::hdf5::archive & ar) { ar[path] << *value; });
+            }
+
+            /// Write all values relative to the current path of `ar`
+            void save(alps::hdf5::archive & ar) const;
+
+        private:
+            std::vector<std::function<void (alps::hdf5::archive &)> > writers;
+    };
+
+    /// Writes checkpoint snapshots to HDF5 on a background thread
+    /**
+       A snapshot is first written to `<filename>.tmp`, which is then renamed
+       to `filename`, so the checkpoint file is either the previous or the new
+       complete checkpoint even if the process is killed while writing.  Only
+       one checkpoint is in flight at a time.
+     */
+    class async_checkpointer {
+        public:
+            async_checkpointer();
+
+            /// Waits for the checkpoint in flight, discarding any error
+            ~async_checkpointer();
+
+            /// Start writing `snapshot` to group `group` of `filename`
+            /**
+               Returns `false` and does nothing if a checkpoint is still in
+               flight.  Rethrows the error of the previous checkpoint, if any.
+             */
+            bool start(std::shared_ptr<checkpoint_snapshot const> snapshot,
+                       std::string const & filename, std::string const & group);
+
+            /// Whether a checkpoint is still being written
+            bool pending() const { return busy.load(); }
+
+            /// Wait for the checkpoint in flight and rethrow its error, if any
+            void wait();
+
+        private:
+            async_checkpointer(async_checkpointer const &);
+            async_checkpointer & operator=(async_checkpointer const &);
+
+            void write(std::shared_ptr<checkpoint_snapshot const> snapshot,
+                       std::string filename, std::string group);
+
+            std::thread worker;
+            std::atomic<bool> busy;
+            std::exception_ptr error;
+    };
+
+    /// When to checkpoint while a simulation is running
+    /**
+       A checkpoint is due every `interval` seconds, every `nsweeps` sweeps,
+       or when SIGUSR1 has been received, whichever comes first; zero disables
+       the respective trigger.  SIGUSR1 is consumed by the policy, so it does
+       not stop the simulation via `alps::stop_callback`, provided that
+       `poll_signals()` is called right before the stop callback.  This
+       allows, e.g., a batch scheduler to request a checkpoint before
+       preempting a job.
+     */
+    class checkpoint_policy {
+        public:
+            /// Checkpoint to `filename` every `interval` seconds and/or `nsweeps` sweeps
+            checkpoint_policy(std::string const & filename, std::size_t interval,
+                              std::size_t nsweeps = 0, bool on_signal = true);
+
+            /// File to write the checkpoints to
+            std::string const & filename() const { return filename_; }
+
+            /// Record that a sweep has been done; returns whether a checkpoint is due
+            bool sweep_done();
+
+            /// Take SIGUSR1 off the signal stack; returns whether a checkpoint was requested
+            bool poll_signals();
+
+            /// Restart the timer and sweep count after a checkpoint
+            void reset();
+
+        private:
+            typedef std::chrono::steady_clock clock_type;
+
+            std::string filename_;
+            clock_type::duration interval_;
+            std::size_t nsweeps_;
+            bool on_signal_;
+            alps::signal signals_;
+            clock_type::time_point start_;
+            std::size_t sweeps_;
+            bool requested_;
+    };
+
+}
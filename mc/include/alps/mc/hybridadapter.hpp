@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+#pragma once
+
+#include <alps/config.hpp>
+
+#if defined(ALPS_HAVE_MPI)
+
+#include <alps/accumulators/mpi.hpp>
+#include <alps/mc/check_schedule.hpp>
+#include <alps/mc/threadadapter.hpp>
+
+#include <exception>
+#include <memory>
+#include <stdexcept>
+
+namespace alps {
+
+    /// Hybrid MPI and thread adapter for an MC simulation class
+    /**
+       Runs `nthreads` clones of the wrapped simulation class on each MPI
+       rank, as `mcthreadadapter` does within a single process.  Clone `i` on
+       rank `r` gets the RNG seed offset
+       `(r * nthreads + i) * rng_seed_step + rng_seed_base`.
+
+       Progress and results are reduced hierarchically: the fractions of the
+       threads are summed locally, and only the calling thread of each rank
+       takes part in the `all_reduce` over the communicator.  Likewise, the
+       measurements are first merged over the threads and then over the ranks
+       using `collective_merge()`.  The collectives thus have one participant
+       per rank rather than per core, and the threads keep sweeping while the
+       calling thread waits for the other ranks.
+
+       Only the calling thread uses MPI, so MPI must be initialized with at
+       least `MPI_THREAD_FUNNELED` support if `nthreads > 1`; the constructor
+       checks this.  If a clone throws on one rank, the other ranks stop at
+       their next check and throw as well, rather than waiting forever.
+
+       @tparam Base a single-process simulation class to be wrapped
+       @tparam ScheduleChecker a schedule checker class
+     */
+    template<typename Base, typename ScheduleChecker = alps::check_schedule>
+    class mchybridadapter : public mcthreadadapter<Base, ScheduleChecker> {
+
+        private:
+            typedef mcthreadadapter<Base, ScheduleChecker> base_type_;
+
+        public:
+            typedef typename base_type_::parameters_type parameters_type;
+            typedef typename base_type_::result_names_type result_names_type;
+            typedef typename base_type_::results_type results_type;
+
+            /// Construct mchybridadapter with a custom scheduler
+            /**
+               @param parameters Parameters object for the wrapped simulation class
+               @param comm MPI communicator to work on
+               @param nthreads Number of threads (and clones) per rank
+               @param check Schedule checker object
+               @param rng_seed_step RNG seed increase for each clone
+               @param rng_seed_base RNG seed for thread 0 on rank 0
+             */
+            mchybridadapter(
+                  parameters_type const & parameters
+                , alps::mpi::communicator const & comm
+                , std::size_t nthreads
+                , ScheduleChecker const & check
+                , int rng_seed_step = 1
+                , int rng_seed_base = 0
+            )
+                : base_type_(parameters, nthreads, check, rng_seed_step,
+                             comm.rank() * nthreads * rng_seed_step + rng_seed_base)
+                , communicator(comm)
+                , fraction(0.)
+            {
+                check_thread_support();
+            }
+
+            /// Construct mchybridadapter with Tmin and Tmax taken from the provided parameters
+            mchybridadapter(
+                  parameters_type const & parameters
+                , alps::mpi::communicator const & comm
+                , std::size_t nthreads
+                , int rng_seed_step = 1
+                , int rng_seed_base = 0
+            )
+                : base_type_(parameters, nthreads, rng_seed_step,
+                             comm.rank() * nthreads * rng_seed_step + rng_seed_base)
+                , communicator(comm)
+                , fraction(0.)
+            {
+                check_thread_support();
+            }
+
+            /// Returns the total fraction over all ranks as of the last check
+            double fraction_completed() const {
+                return fraction;
+            }
+
+            results_type collect_results() const {
+                return collect_results(this->result_names());
+            }
+
+            /// Merge the measurements over all threads and ranks; collective
+            results_type collect_results(result_names_type const & names) const {
+                results_type partial_results;
+                for(typename result_names_type::const_iterator it = names.begin(); it != names.end(); ++it) {
+                    std::unique_ptr<typename base_type_::observable_type> merged;
+                    // a rank failing to merge must still take part in the reduction
+                    std::exception_ptr error;
+                    std::size_t local[2] = {0, 0}, global[2] = {0, 0};
+                    try {
+                        merged = this->merge_clones(*it);
+                        local[0] = bool(merged);
+                    } catch (...) {
+                        error = std::current_exception();
+                        local[1] = 1;
+                    }
+                    alps::mpi::all_reduce(communicator, local, 2, global, std::plus<std::size_t>());
+                    if (error)
+                        std::rethrow_exception(error);
+                    if (global[1] > 0)
+                        throw std::runtime_error(*it + " could not be merged on another MPI process.");
+
+                    const std::size_t sum_counts = global[0];
+                    if (static_cast<int>(sum_counts) == communicator.size()) {
+                        merged->collective_merge(communicator, 0);
+                        partial_results.insert(*it, merged->result());
+                    } else if (sum_counts > 0 && static_cast<int>(sum_counts) < communicator.size()) {
+                        throw std::runtime_error(*it + " was measured on only some of the MPI processes.");
+                    }
+                }
+                return partial_results;
+            }
+
+        protected:
+            void check_thread_support() const {
+                int provided;
+                MPI_Query_thread(&provided);
+                if (this->nthreads() > 1 && provided < MPI_THREAD_FUNNELED)
+                    throw std::runtime_error("mchybridadapter requires MPI to be initialized "
+                                             "with at least MPI_THREAD_FUNNELED support.");
+            }
+
+            double reduce_fraction(double local_fraction) {
+                fraction = alps::mpi::all_reduce(communicator, local_fraction, std::plus<double>());
+                return fraction;
+            }
+
+            alps::mpi::communicator communicator;
+            double fraction;
+    };
+
+}
+
+#endif
@@ -11,14 +11,24 @@
 #include <alps/accumulators.hpp>
 #include <alps/params.hpp>
 #include "random01.hpp"
+#include "philox.hpp"
+#include "checkpoint.hpp"
 
+#include <map>
 #include <vector>
 #include <string>
 
 // move to alps::mcbase root scope
 namespace alps {
 
-    class mcbase {
+    /// Base class for single-process MC simulations
+    /**
+       @tparam RNG uniform random number generator on [0,1), which must be
+               constructible from a seed and a stream number (the seed offset)
+               and provide `save()` and `load()` for checkpointing; see
+               `alps::random01` and `alps::philox01`.
+     */
+    template<typename RNG> class basic_mcbase {
 
         protected:
 
@@ -31,15 +41,27 @@ namespace alps {
 
             typedef alps::accumulators::result_set results_type;
 
-            mcbase(parameters_type const & parms, std::size_t seed_offset = 0);
+            typedef RNG random_type;
+
+            basic_mcbase(parameters_type const & parms, std::size_t seed_offset = 0);
 
             static parameters_type& define_parameters(parameters_type & parameters);
 
             virtual void update() = 0;
             virtual void measure() = 0;
             virtual double fraction_completed() const = 0;
+
+            /// Call `update()` `updates_per_measurement()` times, then `measure()` once
+            /**
+               This is the unit of work of `run()` and the adapters.
+             */
+            void sweep();
+
             bool run(boost::function<bool ()> const & stop_callback);
 
+            /// Run as `run(stop_callback)`, checkpointing asynchronously as prescribed by `policy`
+            bool run(boost::function<bool ()> const & stop_callback, checkpoint_policy & policy);
+
             result_names_type result_names() const;
             result_names_type unsaved_result_names() const;
             results_type collect_results() const;
@@ -50,14 +72,69 @@ namespace alps {
             virtual void save(alps::hdf5::archive & ar) const;
             virtual void load(alps::hdf5::archive & ar);
 
+            /// Write a checkpoint to `filename` in the background
+            /**
+               Takes a snapshot of the state by calling `snapshot()` and
+               returns, while a background thread writes the snapshot to the
+               same location as `save(filename)`.  Returns `false` and does not
+               checkpoint if the previous checkpoint is still being written.
+             */
+            bool save_async(std::string const & filename);
+
+            /// Whether an asynchronous checkpoint is still being written
+            bool checkpoint_pending() const;
+
+            /// Wait for the asynchronous checkpoint and rethrow its error, if any
+            void wait_checkpoint();
+
         protected:
 
+            /// Copy the state written by `save(ar)` into `snap`
+            /**
+               Simulations that save additional data in `save(ar)` must
+               override this, call the base class version, and `add()` copies
+               of the same data to the snapshot.
+             */
+            virtual void snapshot(checkpoint_snapshot & snap) const;
+
+            /// Number of calls to `update()` per call to `measure()` in `sweep()`
+            std::size_t updates_per_measurement() const { return updates_per_measurement_; }
+
+            void set_updates_per_measurement(std::size_t n);
+
+            /// Number of calls to `update()` and `measure()` made by `sweep()`
+            /**
+               The counts are checkpointed, so `fraction_completed()` can be
+               computed from them.
+             */
+            unsigned long update_count() const { return update_count_; }
+
+            unsigned long measurement_count() const { return measurement_count_; }
+
+            /// Measure observable `name` only in every `stride`-th call to `measure()`
+            void set_measurement_stride(std::string const & name, std::size_t stride);
+
+            /// Whether observable `name` is due in the current call to `measure()`
+            bool measure_due(std::string const & name) const;
+
             parameters_type parameters;
             // parameters_type & params; // TODO: deprecated, remove!
-            alps::random01 random;
+            random_type random;
             observable_collection_type measurements;
+
+        private:
+            async_checkpointer checkpointer;
+            std::size_t updates_per_measurement_;
+            unsigned long update_count_;
+            unsigned long measurement_count_;
+            std::map<std::string, std::size_t> strides;
     };
 
-    
+    extern template class basic_mcbase<alps::random01>;
+    extern template class basic_mcbase<alps::philox01>;
+
+    /// MC simulation base class using the Mersenne twister
+    typedef basic_mcbase<alps::random01> mcbase;
+
 }
 
@@ -15,6 +15,9 @@
 
 #include <alps/accumulators/mpi.hpp>
 #include <alps/mc/check_schedule.hpp>
+#include <alps/mc/checkpoint.hpp>
+
+#include <algorithm>
 
 namespace alps {
 
@@ -51,6 +54,7 @@ namespace alps {
                 : Base(parameters, comm.rank()*rng_seed_step + rng_seed_base)
                 , communicator(comm)
                 , schedule_checker(check)
+                , fraction(0.)
                 , clone(comm.rank())
             {}
 
@@ -59,18 +63,126 @@ namespace alps {
                 return fraction;
             }
 
+            /// Run the simulation until the total fraction reaches 1 or `stop_callback` returns `true`
+            /**
+               The fractions of all ranks are summed using a non-blocking
+               all-reduce, so a rank keeps sweeping until the slowest rank has
+               contributed instead of idling at each check.  The schedule is
+               updated once the reduction completes.  All ranks see the same
+               sum for each reduction and hence stop after the same one.  Only
+               the stop callback and the calls to MPI are reported to the
+               schedule checker as the cost of a check (see
+               `alps::cost_aware_check_schedule`), not the sweeps done while
+               the reduction is in flight.
+
+               The stop decision of each rank is sent along in the reduction,
+               so `stop_callback` is called by each rank separately and must
+               not be collective: use `alps::stop_callback(timelimit)` without
+               a communicator.  A collective callback, which broadcasts the
+               decision of rank 0, would make every rank wait for the slowest
+               one at each check, defeating the overlap.
+             */
             bool run(boost::function<bool ()> const & stop_callback) {
-                bool done = false, stopped = false;
-                do {
-                    this->update();
-                    this->measure();
-                    if (stopped || schedule_checker.pending()) {
-                        stopped = stop_callback();
-                        double local_fraction = stopped ? 1. : Base::fraction_completed();
-                        schedule_checker.update(fraction = alps::mpi::all_reduce(communicator, local_fraction, std::plus<double>()));
-                        done = fraction >= 1.;
+                no_checkpoint policy;
+                return run_impl(stop_callback, policy);
+            }
+
+            /// Run as `run(stop_callback)`, checkpointing asynchronously as prescribed by `policy`
+            /**
+               Whether a checkpoint is due is decided by each rank, but the
+               requests are combined in the progress reduction: if any rank
+               asks for a checkpoint, all ranks write one after the same
+               reduction, so the checkpoint files form a consistent set.  Use
+               a different file name for each rank.
+             */
+            bool run(boost::function<bool ()> const & stop_callback, checkpoint_policy & policy) {
+                return run_impl(stop_callback, policy);
+            }
+
+            /// Run a global budget of `nsweeps` sweeps shared dynamically among the ranks
+            /**
+               Rather than giving each rank a fixed share of the work, the
+               ranks claim chunks of `chunk` sweeps (by default, about 1/64 of
+               an even share) from a counter on rank 0 until the budget is
+               exhausted.  Faster ranks thus do more sweeps, and all ranks run
+               out of work at about the same time.  The counter is accessed
+               with one-sided MPI-3 atomics, so rank 0 does not need to poll.
+
+               `Base::fraction_completed()` is not used in this mode.  The
+               `stop_callback` is called by each rank separately before each
+               chunk and therefore must not be collective, e.g., use
+               `alps::stop_callback(timelimit)` without a communicator.  If it
+               returns `true` on any rank, the remaining budget is dropped and
+               all ranks stop after their current chunk.
+
+               Without MPI-3, each rank runs an even share of the budget.
+
+               @returns `false` if the run was stopped on any rank
+             */
+            bool run_budget(boost::function<bool ()> const & stop_callback,
+                            unsigned long nsweeps, unsigned long chunk = 0)
+            {
+                const unsigned long nranks = communicator.size();
+                if (chunk == 0)
+                    chunk = std::max(nsweeps / (64 * nranks), 1ul);
+
+                int stopped = 0;
+#if MPI_VERSION >= 3
+                unsigned long *counter;
+                MPI_Win window;
+                MPI_Win_allocate(communicator.rank() == 0 ? sizeof(unsigned long) : 0,
+                                 sizeof(unsigned long), MPI_INFO_NULL, communicator,
+                                 &counter, &window);
+                // initialize the counter within an access epoch, such that it
+                // is visible to RMA also under the separate memory model
+                if (communicator.rank() == 0) {
+                    const unsigned long zero = 0;
+                    MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, window);
+                    MPI_Put(&zero, 1, MPI_UNSIGNED_LONG, 0, 0, 1, MPI_UNSIGNED_LONG, window);
+                    MPI_Win_unlock(0, window);
+                }
+                MPI_Barrier(communicator);
+
+                MPI_Win_lock_all(0, window);
+                unsigned long start;
+                while (true) {
+                    if (!stopped && stop_callback()) {
+                        // drop the remaining budget for all ranks
+                        stopped = 1;
+                        MPI_Fetch_and_op(&nsweeps, &start, MPI_UNSIGNED_LONG, 0, 0,
+                                         MPI_REPLACE, window);
+                        MPI_Win_flush(0, window);
+                        break;
                     }
-                } while(!done);
+                    MPI_Fetch_and_op(&chunk, &start, MPI_UNSIGNED_LONG, 0, 0,
+                                     MPI_SUM, window);
+                    MPI_Win_flush(0, window);
+                    if (start >= nsweeps)
+                        break;
+
+                    fraction = double(start) / nsweeps;
+                    for (unsigned long i = start; i != std::min(start + chunk, nsweeps); ++i) {
+                        this->sweep();
+                    }
+                }
+                MPI_Win_unlock_all(window);
+                MPI_Win_free(&window);
+#else
+                unsigned long rank = communicator.rank();
+                unsigned long share = nsweeps / nranks + (rank < nsweeps % nranks);
+                for (unsigned long i = 0; i != share; i += chunk) {
+                    if (stop_callback()) {
+                        stopped = 1;
+                        break;
+                    }
+                    fraction = double(i) / share;
+                    for (unsigned long j = i; j != std::min(i + chunk, share); ++j) {
+                        this->sweep();
+                    }
+                }
+#endif
+                stopped = alps::mpi::all_reduce(communicator, stopped, std::plus<int>());
+                fraction = stopped ? fraction : 1.;
                 return !stopped;
             }
 
@@ -99,6 +211,92 @@ namespace alps {
 
         protected:
 
+            /// Checkpoint policy of `run(stop_callback)`, which does not require `Base::save_async()`
+            struct no_checkpoint {
+                bool sweep_done() { return false; }
+                bool poll_signals() { return false; }
+            };
+
+            template<typename Policy>
+            bool run_impl(boost::function<bool ()> const & stop_callback, Policy & policy) {
+                bool done = false, stopped = false, checkpoint = false;
+                // local and global fraction completed and number of checkpoint requests
+                double local[2] = {0., 0.}, global[2] = {0., 0.};
+#if MPI_VERSION >= 3
+                // must stay in place while the reduction is in flight
+                MPI_Request request = MPI_REQUEST_NULL;
+                do {
+                    this->sweep();
+                    if (policy.sweep_done())
+                        checkpoint = true;
+                    if (request == MPI_REQUEST_NULL && (stopped || schedule_checker.pending())) {
+                        begin_check(schedule_checker);
+                        // take SIGUSR1 off the stack before stop_callback sees it
+                        checkpoint = policy.poll_signals() || checkpoint;
+                        stopped = stop_callback();
+                        local[0] = stopped ? 1. : Base::fraction_completed();
+                        local[1] = checkpoint;
+                        MPI_Iallreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, communicator, &request);
+                        end_check(schedule_checker);
+                    }
+                    if (request != MPI_REQUEST_NULL) {
+                        // completes right away if all ranks have arrived
+                        int finished = 0;
+                        begin_check(schedule_checker);
+                        MPI_Test(&request, &finished, MPI_STATUS_IGNORE);
+                        end_check(schedule_checker);
+                        if (finished) {
+                            schedule_checker.update(fraction = global[0]);
+                            done = fraction >= 1.;
+                            if (global[1] > 0.) {
+                                start_checkpoint(policy);
+                                checkpoint = false;
+                            }
+                        }
+                    }
+                } while(!done);
+#else
+                do {
+                    this->sweep();
+                    if (policy.sweep_done())
+                        checkpoint = true;
+                    if (stopped || schedule_checker.pending()) {
+                        begin_check(schedule_checker);
+                        // take SIGUSR1 off the stack before stop_callback sees it
+                        checkpoint = policy.poll_signals() || checkpoint;
+                        stopped = stop_callback();
+                        local[0] = stopped ? 1. : Base::fraction_completed();
+                        local[1] = checkpoint;
+                        MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, communicator);
+                        end_check(schedule_checker);
+                        schedule_checker.update(fraction = global[0]);
+                        done = fraction >= 1.;
+                        if (global[1] > 0.) {
+                            start_checkpoint(policy);
+                            checkpoint = false;
+                        }
+                    }
+                } while(!done);
+#endif
+                finish_checkpoint(policy);
+                return !stopped;
+            }
+
+            void start_checkpoint(no_checkpoint &) {}
+
+            void start_checkpoint(checkpoint_policy & policy) {
+                // every rank must write, so wait for the previous checkpoint
+                this->wait_checkpoint();
+                this->save_async(policy.filename());
+                policy.reset();
+            }
+
+            void finish_checkpoint(no_checkpoint &) {}
+
+            void finish_checkpoint(checkpoint_policy &) {
+                this->wait_checkpoint();
+            }
+
             alps::mpi::communicator communicator;
 
             ScheduleChecker schedule_checker;
@@ -145,6 +343,43 @@ namespace alps {
             )
             : base_type_(parameters, comm, check, rng_seed_step, rng_seed_base)
         {}
+
+        /// Construct mcmpiadapter with the schedule checker taken from the provided parameters
+        /**
+           For the schedule checkers of `alps/mc/check_schedule.hpp`, the
+           parameters are Tmin and Tmax in seconds, and CheckOverhead for
+           `alps::cost_aware_check_schedule`.  Other checkers are constructed
+           from Tmin and Tmax, which must be defined by the user.
+
+           @param parameters Parameters object for the wrapped simulation class
+           @param comm MPI communicator to work on
+           @param rng_seed_step RNG seed increase for each rank
+           @param rng_seed_base RNG seed for rank 0
+        */
+        mcmpiadapter(
+            parameters_type const & parameters
+            , alps::mpi::communicator const & comm
+            , int rng_seed_step = 1
+            , int rng_seed_base = 0
+            )
+            : base_type_(parameters, comm,
+                         detail::make_check_schedule(parameters, static_cast<ScheduleChecker*>(0)),
+                         rng_seed_step, rng_seed_base)
+        {}
+
+        /// Define the parameters of the wrapped class and of the schedule checker, if known
+        /**
+           Tmin and Tmax are fractional numbers of seconds for
+           `alps::steady_check_schedule` and `alps::cost_aware_check_schedule`;
+           the latter also takes CheckOverhead, the maximum fraction of time
+           spent in checks.  Nothing is defined for custom checkers.
+        */
+        static parameters_type& define_parameters(parameters_type & parameters) {
+            base_type_::define_parameters(parameters);
+            if (parameters.is_restored()) return parameters;
+            detail::define_check_schedule_parameters(parameters, static_cast<ScheduleChecker*>(0));
+            return parameters;
+        }
     };
 
     /// MPI adapter for an MC simulation class, with default ScheduleChecker
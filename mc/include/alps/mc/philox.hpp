@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+#pragma once
+
+#include <alps/hdf5/archive.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace alps {
+
+    /// Counter-based Philox4x64-10 random number engine
+    /**
+       The `n`-th block of four 64-bit numbers is obtained by applying ten
+       rounds of a keyed bijection to the counter `n`, where the key is made
+       from the seed and the stream number (Salmon et al., SC'11).  Thus:
+
+         - different `(seed, stream)` pairs give independent streams, so
+           streams for ranks and threads need no seed offset arithmetic,
+         - the state is just the key, the counter and the position within
+           the current block, and
+         - blocks are independent of each other, so any block can be
+           computed directly from its counter.  The 64x64->128 bit products
+           are scalar instructions, so the blocks are not computed with SIMD.
+
+       The engine models a uniform random bit generator with 64-bit output.
+     */
+    class philox4x64 {
+        public:
+            typedef std::uint64_t result_type;
+
+            /// Number of 64-bit numbers generated per counter value
+            static const std::size_t BLOCK = 4;
+
+            static constexpr result_type min() { return 0; }
+            static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+            /// Construct the engine for stream `stream` of seed `seed`
+            philox4x64(std::uint64_t seed = 0, std::uint64_t stream = 0)
+                : counter_(0)
+                , position_(BLOCK)
+            {
+                key_[0] = seed;
+                key_[1] = stream;
+            }
+
+            result_type operator()() {
+                if (position_ == BLOCK) {
+                    generate(counter_++, buffer_);
+                    position_ = 0;
+                }
+                return buffer_[position_++];
+            }
+
+            /// Skip the next `n` numbers in constant time
+            void discard(std::uint64_t n) {
+                std::uint64_t offset = position_ + n;
+                if (offset <= BLOCK) {
+                    position_ = offset;
+                    return;
+                }
+                // the current block has been used up, so skip whole blocks
+                offset -= BLOCK;
+                counter_ += offset / BLOCK;
+                position_ = BLOCK;
+                if (offset % BLOCK != 0) {
+                    generate(counter_++, buffer_);
+                    position_ = offset % BLOCK;
+                }
+            }
+
+            /// Compute the block for the counter value `counter`
+            void generate(std::uint64_t counter, result_type out[BLOCK]) const {
+                std::uint64_t x0 = counter, x1 = 0, x2 = 0, x3 = 0;
+                std::uint64_t k0 = key_[0], k1 = key_[1];
+                for (int round = 0; round != 10; ++round) {
+                    std::uint64_t hi0, lo0 = mulhilo(0xD2E7470EE14C6C93ULL, x0, hi0);
+                    std::uint64_t hi1, lo1 = mulhilo(0xCA5A826395121157ULL, x2, hi1);
+                    x0 = hi1 ^ x1 ^ k0;
+                    x1 = lo1;
+                    x2 = hi0 ^ x3 ^ k1;
+                    x3 = lo0;
+                    k0 += 0x9E3779B97F4A7C15ULL;
+                    k1 += 0xBB67AE8584CAA73BULL;
+                }
+                out[0] = x0;
+                out[1] = x1;
+                out[2] = x2;
+                out[3] = x3;
+            }
+
+            std::uint64_t seed() const { return key_[0]; }
+
+            std::uint64_t stream() const { return key_[1]; }
+
+            /// Number of blocks generated so far
+            std::uint64_t counter() const { return counter_; }
+
+            /// Number of numbers used from the current block
+            std::size_t position() const { return position_; }
+
+            /// Restore the state from seed, stream, counter and position
+            void restore(std::uint64_t seed, std::uint64_t stream,
+                         std::uint64_t counter, std::size_t position) {
+                key_[0] = seed;
+                key_[1] = stream;
+                counter_ = counter;
+                position_ = BLOCK;
+                if (position != BLOCK) {
+                    // regenerate the current block
+                    generate(counter_ - 1, buffer_);
+                    position_ = position;
+                }
+            }
+
+            friend bool operator==(philox4x64 const & a, philox4x64 const & b) {
+                return a.key_[0] == b.key_[0] && a.key_[1] == b.key_[1]
+                    && a.counter_ == b.counter_ && a.position_ == b.position_;
+            }
+
+            friend bool operator!=(philox4x64 const & a, philox4x64 const & b) {
+                return !(a == b);
+            }
+
+        private:
+            /// Returns low and stores high word of the 128-bit product `a * b`
+            static std::uint64_t mulhilo(std::uint64_t a, std::uint64_t b, std::uint64_t & hi) {
+#if defined(__SIZEOF_INT128__)
+                unsigned __int128 product = (unsigned __int128)a * b;
+                hi = (std::uint64_t)(product >> 64);
+                return (std::uint64_t)product;
+#else
+                std::uint64_t a_lo = a & 0xFFFFFFFFULL, a_hi = a >> 32;
+                std::uint64_t b_lo = b & 0xFFFFFFFFULL, b_hi = b >> 32;
+                std::uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi;
+                std::uint64_t hl = a_hi * b_lo, hh = a_hi * b_hi;
+                std::uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFFULL) + (hl & 0xFFFFFFFFULL);
+                hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+                return a * b;
+#endif
+            }
+
+            std::uint64_t key_[2];
+            std::uint64_t counter_;
+            std::size_t position_;
+            result_type buffer_[BLOCK];
+    };
+
+    /// Uniform random numbers in [0,1) from the counter-based philox4x64 engine
+    /**
+       Drop-in alternative to `alps::random01` for `alps::basic_mcbase`: the
+       simulation with seed offset `stream` gets an independent stream of the
+       same seed rather than the seed `seed + stream`.  `fill()` generates many
+       numbers at once, and the checkpoint consists of four integers.
+     */
+    class philox01 {
+        public:
+            typedef double result_type;
+            typedef philox4x64 engine_type;
+
+            philox01(std::uint64_t seed = 42, std::uint64_t stream = 0)
+                : engine_(seed, stream)
+            {}
+
+            /// Returns the next random number in [0,1)
+            double operator()() { return to_double(engine_()); }
+
+            /// Fill `out` with the next `n` random numbers in [0,1)
+            void fill(double * out, std::size_t n) {
+                // use up the current block first
+                for (; n != 0 && engine_.position() != philox4x64::BLOCK; --n)
+                    *out++ = (*this)();
+
+                // then generate whole blocks directly
+                std::uint64_t counter = engine_.counter();
+                std::size_t nblocks = n / philox4x64::BLOCK;
+                for (std::size_t b = 0; b != nblocks; ++b) {
+                    philox4x64::result_type block[philox4x64::BLOCK];
+                    engine_.generate(counter + b, block);
+                    for (std::size_t i = 0; i != philox4x64::BLOCK; ++i)
+                        out[b * philox4x64::BLOCK + i] = to_double(block[i]);
+                }
+                engine_.discard(nblocks * philox4x64::BLOCK);
+                out += nblocks * philox4x64::BLOCK;
+
+                for (n %= philox4x64::BLOCK; n != 0; --n)
+                    *out++ = (*this)();
+            }
+
+            engine_type & engine() { return engine_; }
+
+            engine_type const & engine() const { return engine_; }
+
+            void save(alps::hdf5::archive & ar) const {
+                ar["seed"] << static_cast<unsigned long long>(engine_.seed());
+                ar["stream"] << static_cast<unsigned long long>(engine_.stream());
+                ar["counter"] << static_cast<unsigned long long>(engine_.counter());
+                ar["position"] << static_cast<unsigned long long>(engine_.position());
+            }
+
+            void load(alps::hdf5::archive & ar) {
+                unsigned long long seed, stream, counter, position;
+                ar["seed"] >> seed;
+                ar["stream"] >> stream;
+                ar["counter"] >> counter;
+                ar["position"] >> position;
+                engine_.restore(seed, stream, counter, position);
+            }
+
+        private:
+            /// Use the upper 53 bits as mantissa
+            static double to_double(std::uint64_t x) {
+                return (x >> 11) * (1.0 / 9007199254740992.0);
+            }
+
+            engine_type engine_;
+    };
+
+}
@@ -20,6 +20,11 @@ namespace alps {
             : boost::variate_generator<boost::mt19937, boost::uniform_01<double> >(boost::mt19937(seed), boost::uniform_01<double>())
         {}
 
+        /// Seeds the Mersenne twister with `seed + stream`
+        random01(std::size_t seed, std::size_t stream)
+            : boost::variate_generator<boost::mt19937, boost::uniform_01<double> >(boost::mt19937(seed + stream), boost::uniform_01<double>())
+        {}
+
         void save(alps::hdf5::archive & ar) const { // TODO: move this to hdf5 archive!
             std::ostringstream os;
             os << this->engine();
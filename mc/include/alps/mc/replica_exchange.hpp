@@ -0,0 +1,470 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+#pragma once
+
+#include <boost/function.hpp>
+
+#include <alps/config.hpp>
+#include <alps/mc/philox.hpp>
+
+#if defined(ALPS_HAVE_MPI)
+#include <alps/accumulators/mpi.hpp>
+#include <alps/utilities/mpi.hpp>
+#include <boost/optional.hpp>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace alps {
+
+    /// Parallel tempering (replica exchange) driver for an MC simulation class
+    /**
+       Runs one replica of `Base` per inverse temperature in `betas`.  The
+       replicas are distributed in contiguous blocks over the MPI ranks, and
+       the replicas of each rank are swept by `nthreads` threads.  Every
+       `sweeps_per_exchange` sweeps, the replicas at temperatures `t` and
+       `t+1` try to exchange their temperatures, for even and odd `t` in
+       alternating rounds.  The exchange is accepted with probability
+       `min(1, acceptance(beta_t, beta_{t+1}, E_t, E_{t+1}))`, where `E_t` is
+       the energy of the replica at temperature `t`; by default, this is the
+       Boltzmann ratio `exp((beta_t - beta_{t+1}) * (E_t - E_{t+1}))`.
+
+       An exchange swaps the temperatures (via `set_beta()`) rather than the
+       configurations, so no replica state is moved between threads or ranks.
+       The only communication is an all-gather of the energies and progress
+       of all replicas per round, i.e., three numbers per replica.  From these,
+       every rank takes the same decisions using a counter-based random
+       number generator keyed by the seed and the round.  The all-gather is a
+       blocking `MPI_Allgatherv` in every round, and it is not overlapped with
+       the sweeps: all ranks wait for the slowest one in every round, so
+       `sweeps_per_exchange` should be large enough for the sweeps to
+       dominate the latency of the all-gather.
+
+       The threads are started once per call to `run()` and are kept for all
+       rounds; they synchronize with the calling thread at a barrier before
+       and after the sweeps of each round, and yield while waiting for the
+       exchange.
+
+       Each rank keeps one accumulator set per temperature, and a replica
+       measures into the set of the temperature it currently holds, so the
+       measurements are sorted by temperature rather than by replica.  The
+       sets of all ranks are merged per temperature by `collect_results()`.
+
+       `Base` must derive from `alps::basic_mcbase` and provide:
+
+         - `double energy() const`, the energy in the current configuration,
+         - `void set_beta(double beta)`, which changes the inverse temperature.
+
+       @tparam Base a single-process simulation class to be wrapped
+     */
+    template<typename Base> class replica_exchange {
+
+        public:
+            typedef typename Base::parameters_type parameters_type;
+            typedef typename Base::result_names_type result_names_type;
+            typedef typename Base::results_type results_type;
+
+            /// Returns the probability ratio of exchanging configurations with energies `e1`, `e2` at `beta1`, `beta2`
+            typedef boost::function<double (double beta1, double beta2, double e1, double e2)> acceptance_type;
+
+            /// Construct replica_exchange within a single process
+            /**
+               @param parameters Parameters object for the replicas
+               @param betas Inverse temperatures, one per replica
+               @param nthreads Number of threads to sweep the replicas with
+               @param sweeps_per_exchange Number of sweeps between exchanges
+               @param acceptance Acceptance ratio of an exchange
+             */
+            replica_exchange(
+                  parameters_type const & parameters
+                , std::vector<double> const & betas
+                , std::size_t nthreads = 1
+                , std::size_t sweeps_per_exchange = 1
+                , acceptance_type const & acceptance = &boltzmann
+            )
+                : betas(betas)
+                , nthreads(nthreads)
+                , sweeps_per_exchange(sweeps_per_exchange)
+                , acceptance(acceptance)
+            {
+                init(parameters, 0, 1);
+            }
+
+#if defined(ALPS_HAVE_MPI)
+            /// Construct replica_exchange with the replicas distributed over the ranks of `comm`
+            replica_exchange(
+                  parameters_type const & parameters
+                , alps::mpi::communicator const & comm
+                , std::vector<double> const & betas
+                , std::size_t nthreads = 1
+                , std::size_t sweeps_per_exchange = 1
+                , acceptance_type const & acceptance = &boltzmann
+            )
+                : betas(betas)
+                , nthreads(nthreads)
+                , sweeps_per_exchange(sweeps_per_exchange)
+                , acceptance(acceptance)
+                , communicator(comm)
+            {
+                init(parameters, comm.rank(), comm.size());
+            }
+#endif
+
+            static parameters_type& define_parameters(parameters_type & parameters) {
+                return Base::define_parameters(parameters);
+            }
+
+            /// Boltzmann acceptance ratio
+            static double boltzmann(double beta1, double beta2, double e1, double e2) {
+                return std::exp((beta1 - beta2) * (e1 - e2));
+            }
+
+            /// Number of temperatures (and replicas)
+            std::size_t ntemperatures() const { return betas.size(); }
+
+            /// Index of the temperature held by replica `r`
+            std::size_t temperature_of(std::size_t r) const { return temperature_of_[r]; }
+
+            /// Index of the replica holding temperature `t`
+            std::size_t replica_at(std::size_t t) const { return replica_at_[t]; }
+
+            /// Global index of the first replica on this rank
+            std::size_t first_replica() const { return first; }
+
+            /// Number of replicas on this rank
+            std::size_t nlocal() const { return replicas.size(); }
+
+            /// Returns the `i`-th replica on this rank
+            Base & replica(std::size_t i) { return *replicas[i]; }
+
+            Base const & replica(std::size_t i) const { return *replicas[i]; }
+
+            /// Number of exchange rounds done
+            unsigned long rounds() const { return round; }
+
+            /// Fraction of accepted exchanges between temperatures `t` and `t+1`
+            double acceptance_rate(std::size_t t) const {
+                return attempted[t] ? double(accepted[t]) / attempted[t] : 0.;
+            }
+
+            /// Smallest fraction completed of any replica, as of the last exchange
+            double fraction_completed() const { return fraction; }
+
+            /// Sweep and exchange until all replicas are done or `stop_callback` returns `true`
+            /**
+               `stop_callback` is called once per round on every rank.  If it
+               returns `true` on any rank, all ranks stop after that round.
+               If any replica (or `stop_callback`) throws, the failure is
+               signalled to the other ranks in the all-gather of that round,
+               and the exception is rethrown after all threads of its rank
+               have finished the round.  The other ranks then throw
+               `std::runtime_error` rather than waiting forever.
+
+               @returns `false` if the run was stopped
+             */
+            bool run(boost::function<bool ()> const & stop_callback) {
+                const std::size_t nworkers = std::min(nthreads, nlocal());
+                std::vector<std::exception_ptr> errors(nworkers);
+                barrier sync(nworkers);
+                bool done = false;
+                std::vector<std::thread> workers;
+                for (std::size_t k = 1; k < nworkers; ++k)
+                    workers.push_back(std::thread(&replica_exchange::run_worker, this,
+                                                  k, std::ref(sync), std::ref(done), std::ref(errors[k])));
+                try {
+                    while (!done) {
+                        sync.wait();
+                        sweep_range(0, errors[0]);
+                        sync.wait();
+                        std::exception_ptr error;
+                        for (std::size_t k = 0; k != errors.size() && !error; ++k)
+                            error = errors[k];
+                        bool stop = false;
+                        if (!error) {
+                            try {
+                                stop = stop_callback();
+                            } catch (...) {
+                                error = std::current_exception();
+                            }
+                        }
+                        // finish the all-gather of this round before throwing
+                        done = exchange(stop, error);
+                        if (error)
+                            std::rethrow_exception(error);
+                        if (failed)
+                            throw std::runtime_error("Replica exchange failed on another process.");
+                    }
+                } catch (...) {
+                    done = true;
+                    sync.wait();
+                    for (std::size_t k = 0; k != workers.size(); ++k)
+                        workers[k].join();
+                    throw;
+                }
+                // release the workers waiting for the next round
+                sync.wait();
+                for (std::size_t k = 0; k != workers.size(); ++k)
+                    workers[k].join();
+                return !stopped;
+            }
+
+            result_names_type result_names() const { return replicas[0]->result_names(); }
+
+            /// Merge the measurements at temperature `t` over all ranks; collective
+            /**
+               The results are complete on the lowest rank that has measured
+               at temperature `t`, which is rank 0 unless no replica on rank 0
+               ever held that temperature.  The accumulators must support
+               `collective_merge()`; they are merged only over the ranks that
+               have measured at the temperature.
+             */
+            results_type collect_results(std::size_t t) const {
+                result_names_type names = result_names();
+                results_type partial_results;
+                for(typename result_names_type::const_iterator it = names.begin(); it != names.end(); ++it) {
+                    observable_type merged = (*sets[t])[*it].clone();
+                    bool has_count = merged.count() > 0;
+#if defined(ALPS_HAVE_MPI)
+                    if (communicator) {
+                        int nhave = alps::mpi::all_reduce(*communicator, int(has_count), std::plus<int>());
+                        if (nhave == communicator->size()) {
+                            merged.collective_merge(*communicator, 0);
+                        } else if (nhave > 0) {
+                            // empty partial results cannot be merged by all accumulators
+                            MPI_Comm sub;
+                            MPI_Comm_split(*communicator, has_count ? 0 : MPI_UNDEFINED,
+                                           communicator->rank(), &sub);
+                            if (has_count)
+                                merged.collective_merge(alps::mpi::communicator(sub, alps::mpi::take_ownership), 0);
+                        }
+                    }
+#endif
+                    if (has_count)
+                        partial_results.insert(*it, merged.result());
+                }
+                return partial_results;
+            }
+
+        protected:
+            /// Exposes the measurements of the wrapped class for routing
+            class replica_type : public Base {
+                public:
+                    typedef typename Base::observable_collection_type observable_collection_type;
+
+                    replica_type(parameters_type const & parameters, std::size_t seed_offset)
+                        : Base(parameters, seed_offset)
+                    {}
+
+                    observable_collection_type const & observables() const { return this->measurements; }
+
+                    /// Measure into the accumulators of `set` from now on
+                    void route(observable_collection_type & set) {
+                        this->measurements.clear();
+                        for (typename observable_collection_type::iterator it = set.begin(); it != set.end(); ++it)
+                            this->measurements.insert(it->first, it->second);
+                    }
+            };
+
+            typedef typename replica_type::observable_collection_type observable_collection_type;
+            typedef typename observable_collection_type::value_type observable_type;
+
+            void init(parameters_type const & parameters, std::size_t rank, std::size_t nranks) {
+                const std::size_t R = betas.size();
+                if (R < nranks)
+                    throw std::invalid_argument("Need at least one temperature per rank");
+                if (nthreads == 0 || sweeps_per_exchange == 0)
+                    throw std::invalid_argument("Number of threads and sweeps per exchange must be positive");
+
+                for (std::size_t r = 0; r != nranks; ++r) {
+                    counts.push_back(int(VALUES * (R * (r + 1) / nranks - R * r / nranks)));
+                    displs.push_back(int(VALUES * (R * r / nranks)));
+                }
+                first = R * rank / nranks;
+                for (std::size_t r = first; r != R * (rank + 1) / nranks; ++r)
+                    replicas.emplace_back(new replica_type(parameters, r));
+
+                // the replicas are still empty, so clone the accumulators of any of them
+                observable_collection_type const & prototype = replicas[0]->observables();
+                for (std::size_t t = 0; t != R; ++t) {
+                    sets.emplace_back(new observable_collection_type());
+                    for (typename observable_collection_type::const_iterator it = prototype.begin(); it != prototype.end(); ++it)
+                        sets[t]->insert(it->first, std::shared_ptr<observable_type>(it->second->new_clone()));
+                }
+
+                for (std::size_t t = 0; t != R; ++t) {
+                    temperature_of_.push_back(t);
+                    replica_at_.push_back(t);
+                }
+                for (std::size_t i = 0; i != nlocal(); ++i)
+                    assign(first + i, first + i);
+
+                attempted.assign(R, 0);
+                accepted.assign(R, 0);
+                seed = std::size_t(parameters["SEED"]);
+                round = 0;
+                fraction = 0.;
+                stopped = false;
+                failed = false;
+            }
+
+            /// Let local replica `r` hold temperature `t`
+            void assign(std::size_t r, std::size_t t) {
+                replicas[r - first]->route(*sets[t]);
+                replicas[r - first]->set_beta(betas[t]);
+            }
+
+            void sweep_range(std::size_t k, std::exception_ptr & error) {
+                try {
+                    for (std::size_t i = k; i < nlocal(); i += nthreads)
+                        for (std::size_t s = 0; s != sweeps_per_exchange; ++s)
+                            replicas[i]->sweep();
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+
+            /// Reusable barrier for a fixed number of threads; waiting threads yield
+            class barrier {
+                public:
+                    explicit barrier(std::size_t count) : count(count), waiting(0), generation(0) {}
+
+                    void wait() {
+                        const unsigned long current = generation.load(std::memory_order_acquire);
+                        if (waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+                            waiting.store(0, std::memory_order_relaxed);
+                            generation.store(current + 1, std::memory_order_release);
+                        } else {
+                            while (generation.load(std::memory_order_acquire) == current)
+                                std::this_thread::yield();
+                        }
+                    }
+
+                private:
+                    const std::size_t count;
+                    std::atomic<std::size_t> waiting;
+                    std::atomic<unsigned long> generation;
+            };
+
+            /// Sweep the replicas of worker `k` once per round, until `done` is set by the calling thread
+            /**
+               `done` is only written by the calling thread between the two
+               barriers of a round, so the barriers order all accesses to it.
+             */
+            void run_worker(std::size_t k, barrier & sync, bool const & done, std::exception_ptr & error) {
+                for (;;) {
+                    sync.wait();
+                    if (done)
+                        return;
+                    sweep_range(k, error);
+                    sync.wait();
+                }
+            }
+
+            /// Gather energies and progress, then exchange temperatures; returns whether done
+            /**
+               If `error` is set, or is set by a replica here, only the
+               failure is signalled to the other ranks.  If any rank has
+               failed, no exchange is done and `failed` is set.
+             */
+            bool exchange(bool stop, std::exception_ptr & error) {
+                std::vector<double> local(VALUES * nlocal()), all(VALUES * ntemperatures());
+                if (!error) {
+                    try {
+                        for (std::size_t i = 0; i != nlocal(); ++i) {
+                            local[VALUES * i] = replicas[i]->energy();
+                            local[VALUES * i + 1] = replicas[i]->fraction_completed();
+                            local[VALUES * i + 2] = 0.;
+                            if (stop)
+                                local[VALUES * i + 2] = STOPPED;
+                        }
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                }
+                if (error) {
+                    for (std::size_t i = 0; i != nlocal(); ++i)
+                        local[VALUES * i + 2] = FAILED;
+                }
+#if defined(ALPS_HAVE_MPI)
+                if (communicator)
+                    MPI_Allgatherv(&local[0], int(local.size()), MPI_DOUBLE, &all[0],
+                                   &counts[0], &displs[0], MPI_DOUBLE, *communicator);
+                else
+#endif
+                    all = local;
+
+                for (std::size_t r = 0; r != ntemperatures(); ++r)
+                    failed = failed || all[VALUES * r + 2] == FAILED;
+                if (failed)
+                    return true;
+
+                fraction = 1.;
+                for (std::size_t r = 0; r != ntemperatures(); ++r) {
+                    fraction = std::min(fraction, all[VALUES * r + 1]);
+                    stopped = stopped || all[VALUES * r + 2] == STOPPED;
+                }
+
+                // all ranks draw the same numbers, in a stream separate from the replicas'
+                philox01 rng(seed, EXCHANGE_STREAM + round);
+                for (std::size_t t = round % 2; t + 1 < ntemperatures(); t += 2) {
+                    std::size_t i = replica_at_[t], j = replica_at_[t + 1];
+                    double ratio = acceptance(betas[t], betas[t + 1], all[VALUES * i], all[VALUES * j]);
+                    ++attempted[t];
+                    if (rng() < ratio) {
+                        ++accepted[t];
+                        std::swap(replica_at_[t], replica_at_[t + 1]);
+                        temperature_of_[i] = t + 1;
+                        temperature_of_[j] = t;
+                        if (i >= first && i < first + nlocal())
+                            assign(i, t + 1);
+                        if (j >= first && j < first + nlocal())
+                            assign(j, t);
+                    }
+                }
+                ++round;
+                return stopped || fraction >= 1.;
+            }
+
+            /// Energy, fraction completed and stop flag per replica
+            static const std::size_t VALUES = 3;
+
+            /// Values of the stop flag if the run was stopped or has failed on the rank
+            static constexpr double STOPPED = 1., FAILED = 2.;
+
+            /// First stream of the exchange RNG, out of the range used by the replicas
+            static const std::uint64_t EXCHANGE_STREAM = std::uint64_t(1) << 63;
+
+            std::vector<double> betas;
+            std::size_t nthreads;
+            std::size_t sweeps_per_exchange;
+            acceptance_type acceptance;
+#if defined(ALPS_HAVE_MPI)
+            boost::optional<alps::mpi::communicator> communicator;
+#endif
+            std::vector<int> counts, displs;
+
+            std::size_t first;
+            std::vector<std::unique_ptr<replica_type> > replicas;
+            std::vector<std::unique_ptr<observable_collection_type> > sets;
+            std::vector<std::size_t> temperature_of_, replica_at_;
+            std::vector<unsigned long> attempted, accepted;
+
+            std::uint64_t seed;
+            unsigned long round;
+            double fraction;
+            bool stopped, failed;
+    };
+
+}
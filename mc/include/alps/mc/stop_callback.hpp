@@ -36,6 +36,10 @@ namespace alps {
                     /// Initializes the functor with the desired time duration
                     /** @param timelimit Time limit (seconds); 0 means "indefinitely"
                         @param cm MPI communicator to determine the root process
+
+                        Each call broadcasts the decision of the root, so the
+                        functor is collective over `cm`.  Do not use it with
+                        `mcmpiadapter`, which calls it on each rank separately.
                      */
                     stop_callback(alps::mpi::communicator const & cm, std::size_t timelimit);
 #endif
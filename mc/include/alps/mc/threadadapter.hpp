@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+#pragma once
+
+#include <boost/function.hpp>
+
+#include <alps/hdf5/archive.hpp>
+#include <alps/mc/check_schedule.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace alps {
+
+    /// Thread adapter for an MC simulation class
+    /**
+       Runs `nthreads` clones of the wrapped simulation class within one
+       process, each on its own thread and with its own RNG seed.  The clones
+       share no mutable state, so `update()` and `measure()` run without any
+       synchronization.  Each clone is a full instance of `Base`, with its own
+       copy of the parameters and of any tables `Base` builds from them, so
+       the memory use grows linearly with `nthreads`.
+
+       Each clone publishes its `fraction_completed()` to a private, cache-line
+       sized slot after every sweep; the total fraction is the sum over the
+       slots, as in `mcmpiadapter`, and is computed without locks.  The calling
+       thread runs clone 0 and acts as the root: it calls the stop callback and
+       sums the fractions whenever the schedule checker asks for it.
+
+       The measurements of all clones are merged in `collect_results()`, so the
+       accumulators must support `merge()`.
+
+       @tparam Base a single-process simulation class to be wrapped
+       @tparam ScheduleChecker a schedule checker class
+     */
+    template<typename Base, typename ScheduleChecker = alps::check_schedule> class mcthreadadapter {
+
+        public:
+            typedef typename Base::parameters_type parameters_type;
+            typedef typename Base::result_names_type result_names_type;
+            typedef typename Base::results_type results_type;
+
+            /// Size of a cache line in bytes (conservative estimate)
+            static const std::size_t CACHE_LINE = 64;
+
+            /// Construct mcthreadadapter with a custom scheduler
+            /**
+               Initializes `nthreads` clones of the wrapped simulation class,
+               passes parameters and an RNG seed that linearly depends on the
+               thread number.
+
+               @param parameters Parameters object for the wrapped simulation class
+               @param nthreads Number of threads (and clones)
+               @param check Schedule checker object
+               @param rng_seed_step RNG seed increase for each thread
+               @param rng_seed_base RNG seed for thread 0
+             */
+            mcthreadadapter(
+                  parameters_type const & parameters
+                , std::size_t nthreads
+                , ScheduleChecker const & check
+                , int rng_seed_step = 1
+                , int rng_seed_base = 0
+            )
+                : schedule_checker(check)
+            {
+                init(parameters, nthreads, rng_seed_step, rng_seed_base);
+            }
+
+            /// Construct mcthreadadapter with the schedule checker taken from the provided parameters
+            /**
+               The checker is constructed from Tmin and Tmax, and also from
+               CheckOverhead for `alps::cost_aware_check_schedule`.
+             */
+            mcthreadadapter(
+                  parameters_type const & parameters
+                , std::size_t nthreads
+                , int rng_seed_step = 1
+                , int rng_seed_base = 0
+            )
+                : schedule_checker(detail::make_check_schedule(parameters, static_cast<ScheduleChecker*>(0)))
+            {
+                init(parameters, nthreads, rng_seed_step, rng_seed_base);
+            }
+
+            virtual ~mcthreadadapter() {}
+
+            /// Define parameters of the wrapped class and, for the checkers of alps/mc/check_schedule.hpp, of the checker
+            /**
+               Tmin and Tmax are whole seconds for `alps::check_schedule` and
+               fractional seconds for the other checkers of this library;
+               `alps::cost_aware_check_schedule` also takes CheckOverhead.
+             */
+            static parameters_type& define_parameters(parameters_type & parameters) {
+                Base::define_parameters(parameters);
+                if (parameters.is_restored())
+                    return parameters;
+                detail::define_check_schedule_parameters(parameters, static_cast<ScheduleChecker*>(0));
+                return parameters;
+            }
+
+            /// Number of threads (and clones)
+            std::size_t nthreads() const { return clones.size(); }
+
+            /// Returns the clone run by the `i`-th thread
+            Base & clone(std::size_t i) { return *clones[i]; }
+
+            /// Returns the clone run by the `i`-th thread
+            Base const & clone(std::size_t i) const { return *clones[i]; }
+
+            /// Returns the sum of the fractions last published by the clones
+            double fraction_completed() const {
+                double fraction = 0.;
+                for (std::size_t i = 0; i != nthreads(); ++i)
+                    fraction += progress[i]->fraction.load(std::memory_order_relaxed);
+                return fraction;
+            }
+
+            /// Run all clones until the total fraction reaches 1 or `stop_callback` returns `true`
+            /**
+               `stop_callback` is only called from the calling thread.  If any
+               clone throws, all threads are stopped and the first exception
+               is rethrown.  The failure is signalled to other processes, if
+               any, by an infinite fraction in the next reduction, such that
+               they stop as well and throw `std::runtime_error`.
+             */
+            bool run(boost::function<bool ()> const & stop_callback) {
+                done = false;
+                failed = false;
+                std::vector<std::exception_ptr> errors(nthreads());
+                std::vector<std::thread> workers;
+                for (std::size_t i = 1; i < nthreads(); ++i)
+                    workers.push_back(std::thread(&mcthreadadapter::run_worker, this, i, std::ref(errors[i])));
+
+                bool stopped = false;
+                double fraction = 0.;
+                do {
+                    bool check = true;
+                    if (!failed.load(std::memory_order_relaxed)) {
+                        try {
+                            sweep(0);
+                            check = schedule_checker.pending();
+                            if (check) {
+                                detail::begin_check(schedule_checker);
+                                stopped = stop_callback();
+                            }
+                        } catch (...) {
+                            errors[0] = std::current_exception();
+                            failed = true;
+                        }
+                    }
+                    if (check) {
+                        double local = failed ? std::numeric_limits<double>::infinity()
+                                              : stopped ? 1. : fraction_completed();
+                        fraction = reduce_fraction(local);
+                        detail::end_check(schedule_checker);
+                        if (!std::isinf(fraction))
+                            schedule_checker.update(fraction);
+                        if (fraction >= 1.)
+                            done = true;
+                    }
+                } while (!done.load(std::memory_order_relaxed));
+
+                for (std::size_t i = 0; i != workers.size(); ++i)
+                    workers[i].join();
+                for (std::size_t i = 0; i != errors.size(); ++i)
+                    if (errors[i])
+                        std::rethrow_exception(errors[i]);
+                if (std::isinf(fraction))
+                    throw std::runtime_error("Simulation failed on another process.");
+                return !stopped;
+            }
+
+            result_names_type result_names() const { return clones[0]->result_names(); }
+
+            result_names_type unsaved_result_names() const { return clones[0]->unsaved_result_names(); }
+
+            results_type collect_results() const {
+                return collect_results(result_names());
+            }
+
+            /// Merge the measurements of all clones; must not be called while running
+            results_type collect_results(result_names_type const & names) const {
+                results_type partial_results;
+                for(typename result_names_type::const_iterator it = names.begin(); it != names.end(); ++it) {
+                    std::unique_ptr<observable_type> merged = merge_clones(*it);
+                    if (merged)
+                        partial_results.insert(*it, merged->result());
+                }
+                return partial_results;
+            }
+
+            /// Save all clones to `/simulation/realizations/0/clones/<i>`
+            void save(std::string const & filename) const {
+                alps::hdf5::archive ar(filename, "w");
+                ar["/simulation/realizations/0"] << *this;
+            }
+
+            /// Load all clones from `/simulation/realizations/0/clones/<i>`
+            void load(std::string const & filename) {
+                alps::hdf5::archive ar(filename);
+                ar["/simulation/realizations/0"] >> *this;
+            }
+
+            /// Save clone `i` to `clones/<i>` relative to the current path
+            void save(alps::hdf5::archive & ar) const {
+                for (std::size_t i = 0; i != nthreads(); ++i)
+                    ar[clone_path(i)] << *clones[i];
+            }
+
+            /// Load clone `i` from `clones/<i>` relative to the current path
+            void load(alps::hdf5::archive & ar) {
+                for (std::size_t i = 0; i != nthreads(); ++i) {
+                    if (!ar.is_group(clone_path(i)))
+                        throw std::runtime_error("Checkpoint does not contain " + clone_path(i));
+                    ar[clone_path(i)] >> *clones[i];
+                    publish(i);
+                }
+            }
+
+        protected:
+            /// Exposes the measurements of the wrapped class for merging
+            class clone_type : public Base {
+                public:
+                    typedef typename Base::observable_collection_type observable_collection_type;
+
+                    clone_type(parameters_type const & parameters, std::size_t seed_offset)
+                        : Base(parameters, seed_offset)
+                    {}
+
+                    observable_collection_type const & observables() const { return this->measurements; }
+            };
+
+            typedef typename clone_type::observable_collection_type::value_type observable_type;
+
+            /// Progress of a single clone, padded to avoid false sharing
+            struct progress_slot {
+                progress_slot() : fraction(0.) {}
+
+                std::atomic<double> fraction;
+                char pad[CACHE_LINE];
+            };
+
+            void init(parameters_type const & parameters, std::size_t nthreads, int rng_seed_step, int rng_seed_base) {
+                if (nthreads == 0)
+                    throw std::invalid_argument("Number of threads must be positive");
+                for (std::size_t i = 0; i != nthreads; ++i) {
+                    clones.emplace_back(new clone_type(parameters, i*rng_seed_step + rng_seed_base));
+                    progress.emplace_back(new progress_slot());
+                    publish(i);
+                }
+            }
+
+            /// Combine the fraction completed by this process with other processes, if any
+            virtual double reduce_fraction(double local_fraction) { return local_fraction; }
+
+            /// Merge observable `name` over all clones
+            /**
+               Returns a null pointer if no clone has measured the observable.
+             */
+            std::unique_ptr<observable_type> merge_clones(std::string const & name) const {
+                std::size_t sum_counts = 0;
+                for (std::size_t i = 0; i != nthreads(); ++i)
+                    sum_counts += (clones[i]->observables()[name].count() > 0);
+                if (sum_counts == 0)
+                    return std::unique_ptr<observable_type>();
+                if (sum_counts != nthreads())
+                    throw std::runtime_error(name + " was measured on only some of the threads.");
+
+                // copying the wrapper would share the accumulator, so clone it
+                std::unique_ptr<observable_type> merged(clones[0]->observables()[name].new_clone());
+                for (std::size_t i = 1; i != nthreads(); ++i)
+                    merged->merge(clones[i]->observables()[name]);
+                return merged;
+            }
+
+            void publish(std::size_t i) {
+                progress[i]->fraction.store(clones[i]->fraction_completed(), std::memory_order_relaxed);
+            }
+
+            void sweep(std::size_t i) {
+                clones[i]->sweep();
+                publish(i);
+            }
+
+            void run_worker(std::size_t i, std::exception_ptr & error) {
+                try {
+                    // like each rank in mcmpiadapter, do at least one sweep
+                    do {
+                        sweep(i);
+                    } while (!done.load(std::memory_order_relaxed));
+                } catch (...) {
+                    error = std::current_exception();
+                    failed = true;
+                }
+            }
+
+            static std::string clone_path(std::size_t i) {
+                return "clones/" + std::to_string(i);
+            }
+
+            std::vector<std::unique_ptr<clone_type> > clones;
+            std::vector<std::unique_ptr<progress_slot> > progress;
+            ScheduleChecker schedule_checker;
+            std::atomic<bool> done, failed;
+    };
+
+}
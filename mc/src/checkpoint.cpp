@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+#include <alps/mc/checkpoint.hpp>
+
+#include <cstdio>
+#include <signal.h>
+#include <stdexcept>
+
+namespace alps {
+
+    void checkpoint_snapshot::save(alps::hdf5::archive & ar) const {
+        for (std::size_t i = 0; i != writers.size(); ++i)
+            writers[i](ar);
+    }
+
+    async_checkpointer::async_checkpointer()
+        : busy(false)
+    {}
+
+    async_checkpointer::~async_checkpointer() {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    bool async_checkpointer::start(std::shared_ptr<checkpoint_snapshot const> snapshot,
+                                   std::string const & filename, std::string const & group) {
+        if (busy)
+            return false;
+        wait();
+        busy = true;
+        worker = std::thread(&async_checkpointer::write, this, snapshot, filename, group);
+        return true;
+    }
+
+    void async_checkpointer::wait() {
+        if (worker.joinable())
+            worker.join();
+        if (error) {
+            std::exception_ptr e = error;
+            error = std::exception_ptr();
+            std::rethrow_exception(e);
+        }
+    }
+
+    void async_checkpointer::write(std::shared_ptr<checkpoint_snapshot const> snapshot,
+                                   std::string filename, std::string group) {
+        try {
+            // "w" appends to existing files, so start from scratch
+            std::string tmpname = filename + ".tmp";
+            std::remove(tmpname.c_str());
+            {
+                alps::hdf5::archive ar(tmpname, "w");
+                ar[group] << *snapshot;
+            }
+            if (std::rename(tmpname.c_str(), filename.c_str()) != 0)
+                throw std::runtime_error("Cannot rename " + tmpname + " to " + filename);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        busy = false;
+    }
+
+    checkpoint_policy::checkpoint_policy(std::string const & filename, std::size_t interval,
+                                         std::size_t nsweeps, bool on_signal)
+        : filename_(filename)
+        , interval_(std::chrono::seconds(interval))
+        , nsweeps_(nsweeps)
+        , on_signal_(on_signal)
+        , signals_()
+        , start_(clock_type::now())
+        , sweeps_(0)
+        , requested_(false)
+    {}
+
+    bool checkpoint_policy::sweep_done() {
+        ++sweeps_;
+        return poll_signals()
+            || (nsweeps_ > 0 && sweeps_ >= nsweeps_)
+            || (interval_ != clock_type::duration::zero() && clock_type::now() - start_ >= interval_);
+    }
+
+    bool checkpoint_policy::poll_signals() {
+        while (on_signal_ && !signals_.empty() && signals_.top() == SIGUSR1) {
+            signals_.pop();
+            requested_ = true;
+        }
+        return requested_;
+    }
+
+    void checkpoint_policy::reset() {
+        start_ = clock_type::now();
+        sweeps_ = 0;
+        requested_ = false;
+    }
+
+}
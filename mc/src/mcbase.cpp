@@ -7,55 +7,120 @@
 #include <alps/utilities/signal.hpp>
 #include <alps/mc/mcbase.hpp>
 
+#include <stdexcept>
+
 namespace alps {
 
-    mcbase::mcbase(parameters_type const & parms, std::size_t seed_offset)
+    template<typename RNG>
+    basic_mcbase<RNG>::basic_mcbase(parameters_type const & parms, std::size_t seed_offset)
         : parameters(parms)
-        , random(std::size_t(parameters["SEED"]) + seed_offset)
+        , random(std::size_t(parameters["SEED"]), seed_offset)
+        , updates_per_measurement_(1)
+        , update_count_(0)
+        , measurement_count_(0)
     {
         alps::signal::listen();
     }
 
-    mcbase::parameters_type& mcbase::define_parameters(parameters_type & parameters) {
+    template<typename RNG>
+    typename basic_mcbase<RNG>::parameters_type& basic_mcbase<RNG>::define_parameters(parameters_type & parameters) {
         return parameters.define<long>("SEED", 42, "PRNG seed");
     }
 
-  void mcbase::save(std::string const & filename) const {
+    template<typename RNG>
+    void basic_mcbase<RNG>::save(std::string const & filename) const {
         alps::hdf5::archive ar(filename, "w");
         ar["/simulation/realizations/0/clones/0"] << *this;
     }
 
-    void mcbase::load(std::string const & filename) {
+    template<typename RNG>
+    void basic_mcbase<RNG>::load(std::string const & filename) {
         alps::hdf5::archive ar(filename);
         ar["/simulation/realizations/0/clones/0"] >> *this;
     }
 
-    bool mcbase::run(boost::function<bool ()> const & stop_callback) {
+    template<typename RNG>
+    bool basic_mcbase<RNG>::run(boost::function<bool ()> const & stop_callback) {
         bool stopped = false;
         while(!(stopped = stop_callback()) && fraction_completed() < 1.) {
-            update();
-            measure();
+            sweep();
+        }
+        return !stopped;
+    }
+
+    template<typename RNG>
+    bool basic_mcbase<RNG>::run(boost::function<bool ()> const & stop_callback, checkpoint_policy & policy) {
+        bool stopped = false;
+        bool due = false;
+        // take SIGUSR1 off the stack before stop_callback sees it, also if it
+        // arrives before the first sweep or while a checkpoint is started
+        policy.poll_signals();
+        while(!(stopped = stop_callback()) && fraction_completed() < 1.) {
+            sweep();
+            due = policy.sweep_done() || due;
+            // if the previous checkpoint is still being written, try again after the next sweep
+            if (due && !checkpoint_pending()) {
+                save_async(policy.filename());
+                policy.reset();
+                due = false;
+            }
+            policy.poll_signals();
         }
+        wait_checkpoint();
         return !stopped;
     }
 
+    template<typename RNG>
+    void basic_mcbase<RNG>::sweep() {
+        for (std::size_t i = 0; i != updates_per_measurement_; ++i) {
+            update();
+            ++update_count_;
+        }
+        measure();
+        ++measurement_count_;
+    }
+
+    template<typename RNG>
+    void basic_mcbase<RNG>::set_updates_per_measurement(std::size_t n) {
+        if (n == 0)
+            throw std::invalid_argument("Number of updates per measurement must be positive");
+        updates_per_measurement_ = n;
+    }
+
+    template<typename RNG>
+    void basic_mcbase<RNG>::set_measurement_stride(std::string const & name, std::size_t stride) {
+        if (stride == 0)
+            throw std::invalid_argument("Measurement stride of " + name + " must be positive");
+        strides[name] = stride;
+    }
+
+    template<typename RNG>
+    bool basic_mcbase<RNG>::measure_due(std::string const & name) const {
+        std::map<std::string, std::size_t>::const_iterator it = strides.find(name);
+        return it == strides.end() || measurement_count_ % it->second == 0;
+    }
+
     // implement a nice keys(m) function
-    mcbase::result_names_type mcbase::result_names() const {
+    template<typename RNG>
+    typename basic_mcbase<RNG>::result_names_type basic_mcbase<RNG>::result_names() const {
         result_names_type names;
         for(observable_collection_type::const_iterator it = measurements.begin(); it != measurements.end(); ++it)
             names.push_back(it->first);
         return names;
     }
 
-    mcbase::result_names_type mcbase::unsaved_result_names() const {
+    template<typename RNG>
+    typename basic_mcbase<RNG>::result_names_type basic_mcbase<RNG>::unsaved_result_names() const {
         return result_names_type(); 
     }
 
-    mcbase::results_type mcbase::collect_results() const {
+    template<typename RNG>
+    typename basic_mcbase<RNG>::results_type basic_mcbase<RNG>::collect_results() const {
         return collect_results(result_names());
     }
 
-    mcbase::results_type mcbase::collect_results(result_names_type const & names) const {
+    template<typename RNG>
+    typename basic_mcbase<RNG>::results_type basic_mcbase<RNG>::collect_results(result_names_type const & names) const {
         results_type partial_results;
         for(result_names_type::const_iterator it = names.begin(); it != names.end(); ++it){
                 partial_results.insert(*it, measurements[*it].result());
@@ -63,16 +128,60 @@ namespace alps {
         return partial_results;
     }
 
-    void mcbase::save(alps::hdf5::archive & ar) const {
+    template<typename RNG>
+    void basic_mcbase<RNG>::save(alps::hdf5::archive & ar) const {
         ar["/parameters"] << parameters;
         ar["measurements"] << measurements;
         ar["checkpoint"] << random;
+        ar["schedule/updates"] << update_count_;
+        ar["schedule/measurements"] << measurement_count_;
     }
 
-    void mcbase::load(alps::hdf5::archive & ar) {
+    template<typename RNG>
+    void basic_mcbase<RNG>::load(alps::hdf5::archive & ar) {
         ar["/parameters"] >> parameters;
         ar["measurements"] >> measurements;
         ar["checkpoint"] >> random;
+        // older checkpoints do not have the counts
+        if (ar.is_data("schedule/updates")) {
+            ar["schedule/updates"] >> update_count_;
+            ar["schedule/measurements"] >> measurement_count_;
+        }
+    }
+
+    template<typename RNG>
+    bool basic_mcbase<RNG>::save_async(std::string const & filename) {
+        if (checkpointer.pending())
+            return false;
+        std::shared_ptr<checkpoint_snapshot> snap(new checkpoint_snapshot());
+        snapshot(*snap);
+        return checkpointer.start(snap, filename, "/simulation/realizations/0/clones/0");
     }
 
+    template<typename RNG>
+    bool basic_mcbase<RNG>::checkpoint_pending() const {
+        return checkpointer.pending();
+    }
+
+    template<typename RNG>
+    void basic_mcbase<RNG>::wait_checkpoint() {
+        checkpointer.wait();
+    }
+
+    template<typename RNG>
+    void basic_mcbase<RNG>::snapshot(checkpoint_snapshot & snap) const {
+        // copying the accumulator set would share the accumulators, so clone them
+        std::shared_ptr<observable_collection_type> copy(new observable_collection_type());
+        for(typename observable_collection_type::const_iterator it = measurements.begin(); it != measurements.end(); ++it)
+            copy->insert(it->first, std::shared_ptr<typename observable_collection_type::value_type>(it->second->new_clone()));
+        snap.add("/parameters", parameters);
+        snap.add("measurements", copy);
+        snap.add("checkpoint", random);
+        snap.add("schedule/updates", update_count_);
+        snap.add("schedule/measurements", measurement_count_);
+    }
+
+    template class basic_mcbase<alps::random01>;
+    template class basic_mcbase<alps::philox01>;
+
 }
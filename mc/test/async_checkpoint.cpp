@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+/* Tests writing checkpoints on a background thread */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/testing/unique_file.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <vector>
+
+class checkpoint_sim : public alps::mcbase {
+    public:
+        checkpoint_sim(parameters_type const & parms, std::size_t seed_offset = 0)
+            : alps::mcbase(parms, seed_offset)
+            , count(0)
+            , history()
+        {
+            measurements << alps::accumulators::MeanAccumulator<double>("X");
+        }
+
+        void update() {
+            ++count;
+            history.push_back(random());
+        }
+
+        void measure() { measurements["X"] << history.back(); }
+
+        double fraction_completed() const { return count / 100.; }
+
+        using alps::mcbase::save;
+        using alps::mcbase::load;
+
+        void save(alps::hdf5::archive & ar) const {
+            alps::mcbase::save(ar);
+            ar["checkpoint/count"] << count;
+            ar["checkpoint/history"] << history;
+        }
+
+        void load(alps::hdf5::archive & ar) {
+            alps::mcbase::load(ar);
+            ar["checkpoint/count"] >> count;
+            ar["checkpoint/history"] >> history;
+        }
+
+        int count;
+        std::vector<double> history;
+
+    protected:
+        void snapshot(alps::checkpoint_snapshot & snap) const {
+            alps::mcbase::snapshot(snap);
+            snap.add("checkpoint/count", count);
+            snap.add("checkpoint/history", history);
+        }
+};
+
+class async_checkpoint_test : public ::testing::Test {
+    public:
+        alps::params parameters;
+
+        async_checkpoint_test() {
+            checkpoint_sim::define_parameters(parameters);
+        }
+};
+
+TEST_F(async_checkpoint_test, snapshot_is_consistent) {
+    alps::testing::unique_file ufile("async_checkpoint.h5.", alps::testing::unique_file::REMOVE_AFTER);
+    checkpoint_sim sim(parameters);
+    for (int i = 0; i != 10; ++i) {
+        sim.update();
+        sim.measure();
+    }
+    checkpoint_sim expected(parameters);
+    expected.count = sim.count;
+    expected.history = sim.history;
+    double next = sim.history.size();
+
+    ASSERT_TRUE(sim.save_async(ufile.name()));
+    // keep going while the checkpoint is written
+    for (int i = 0; i != 20; ++i) {
+        sim.update();
+        sim.measure();
+    }
+    sim.wait_checkpoint();
+    EXPECT_FALSE(sim.checkpoint_pending());
+
+    checkpoint_sim restored(parameters);
+    restored.load(ufile.name());
+    EXPECT_EQ(10, restored.count);
+    EXPECT_EQ(expected.history, restored.history);
+    EXPECT_EQ(10, restored.collect_results()["X"].count());
+    EXPECT_EQ(30, sim.collect_results()["X"].count());
+
+    // the RNG continues where the snapshot was taken
+    restored.update();
+    EXPECT_EQ(sim.history[next], restored.history.back());
+}
+
+TEST_F(async_checkpoint_test, replaces_checkpoint) {
+    alps::testing::unique_file ufile("async_checkpoint.h5.", alps::testing::unique_file::REMOVE_AFTER);
+    checkpoint_sim sim(parameters);
+    for (int n = 1; n <= 3; ++n) {
+        sim.update();
+        sim.measure();
+        while (!sim.save_async(ufile.name()))
+            sim.wait_checkpoint();
+    }
+    sim.wait_checkpoint();
+
+    std::FILE * tmp = std::fopen((ufile.name() + ".tmp").c_str(), "r");
+    EXPECT_TRUE(tmp == NULL);
+    if (tmp)
+        std::fclose(tmp);
+
+    checkpoint_sim restored(parameters);
+    restored.load(ufile.name());
+    EXPECT_EQ(3, restored.count);
+    EXPECT_EQ(3, restored.collect_results()["X"].count());
+}
+
+TEST_F(async_checkpoint_test, error_is_rethrown) {
+    checkpoint_sim sim(parameters);
+    sim.update();
+    sim.measure();
+    ASSERT_TRUE(sim.save_async("/nonexistent/directory/checkpoint.h5"));
+    EXPECT_ANY_THROW(sim.wait_checkpoint());
+    EXPECT_NO_THROW(sim.wait_checkpoint());
+}
@@ -161,3 +161,141 @@ TEST(CheckSheduleTest, PosixTimerWrapper)
     EXPECT_NEAR(t1, alps::detail::posix_wall_clock::now_time(), 1) << "Timer wrapper counts time differently";
     EXPECT_EQ(delta, alps::detail::posix_wall_clock::time_diff(t1, t0)) << "Timer wrapper computes intervals differently";
 }
+
+/// Fake clock with sub-second resolution
+class fake_fine_timer {
+  public:
+    typedef double time_point_type;
+    typedef double time_duration_type;
+
+    static void reset(double ini) { now_=ini; }
+
+    static void advance(double delta) { now_+=delta; }
+
+    static time_point_type now_time() { return now_; }
+
+    static time_duration_type time_diff(time_point_type t1, time_point_type t0) { return t1-t0; }
+  private:
+    static time_point_type now_;
+};
+
+fake_fine_timer::time_point_type fake_fine_timer::now_;
+
+typedef alps::detail::generic_cost_aware_check_schedule<fake_fine_timer> test_cost_aware_schedule;
+
+/// Test that cheap checks are scheduled as for the plain checker, with sub-second intervals
+TEST(CheckScheduleTest, CostAwareCheapChecks)
+{
+    fake_fine_timer timer;
+    timer.reset(100);
+
+    test_cost_aware_schedule checker(0.01, 0.5, 0.01, timer);
+    EXPECT_TRUE(checker.pending());
+    checker.begin_check();
+    timer.advance(0.0001);
+    checker.end_check();
+    checker.update(0.);
+    EXPECT_NEAR(0.0001, checker.check_cost(), 1E-9);
+    EXPECT_NEAR(0.01, checker.next_check(), 1E-9);
+
+    EXPECT_FALSE(checker.pending());
+    timer.advance(0.005);
+    EXPECT_FALSE(checker.pending());
+    timer.advance(0.006);
+    EXPECT_TRUE(checker.pending());
+}
+
+/// Test that expensive checks are spaced to bound their overhead
+TEST(CheckScheduleTest, CostAwareExpensiveChecks)
+{
+    fake_fine_timer timer;
+    timer.reset(100);
+
+    test_cost_aware_schedule checker(0.1, 100, 0.01, timer);
+    EXPECT_TRUE(checker.pending());
+    checker.begin_check();
+    timer.advance(0.25);
+    checker.end_check();
+    // work done while the check is in flight is not counted
+    timer.advance(10);
+    checker.begin_check();
+    timer.advance(0.25);
+    checker.end_check();
+    checker.update(0.);
+    EXPECT_NEAR(0.5, checker.check_cost(), 1E-9);
+    EXPECT_NEAR(50, checker.next_check(), 1E-9);
+
+    timer.advance(49);
+    EXPECT_FALSE(checker.pending());
+    timer.advance(1.5);
+    EXPECT_TRUE(checker.pending());
+
+    // the cost estimate is smoothed over checks
+    checker.begin_check();
+    timer.advance(0.1);
+    checker.end_check();
+    checker.update(0.);
+    EXPECT_NEAR(0.3, checker.check_cost(), 1E-9);
+    EXPECT_NEAR(30, checker.next_check(), 1E-9);
+}
+
+/// Test that the overhead bound does not exceed the maximum interval
+TEST(CheckScheduleTest, CostAwareMaxCheck)
+{
+    fake_fine_timer timer;
+    timer.reset(100);
+
+    test_cost_aware_schedule checker(1, 5, 0.01, timer);
+    EXPECT_TRUE(checker.pending());
+    checker.begin_check();
+    timer.advance(1);
+    checker.end_check();
+    checker.update(0.);
+    EXPECT_NEAR(5, checker.next_check(), 1E-9);
+}
+
+/// Test that the hooks are no-ops for other checkers, and that unbracketed checks cost nothing
+TEST(CheckScheduleTest, CostAwareHooks)
+{
+    fake_fine_timer timer;
+    timer.reset(100);
+
+    alps::detail::generic_check_schedule<fake_fine_timer> plain(0.1, 1, timer);
+    alps::detail::begin_check(plain);
+    alps::detail::end_check(plain);
+
+    test_cost_aware_schedule checker(0.1, 100, 0.01, timer);
+    alps::detail::end_check(checker);
+    timer.advance(5);
+    checker.update(0.);
+    EXPECT_EQ(0., checker.check_cost());
+    EXPECT_NEAR(0.1, checker.next_check(), 1E-9);
+
+    alps::detail::begin_check(checker);
+    timer.advance(0.2);
+    alps::detail::end_check(checker);
+    checker.update(0.);
+    EXPECT_NEAR(0.2, checker.check_cost(), 1E-9);
+}
+
+/// Test that the steady clock wrapper has sub-second resolution
+TEST(CheckScheduleTest, SteadyClockWrapper)
+{
+    typedef alps::detail::steady_clock clock_type;
+    clock_type::time_point_type t0=clock_type::now_time();
+    clock_type::time_point_type t1=t0;
+    while (clock_type::time_diff(t1, t0)<0.05) {
+        t1=clock_type::now_time();
+    }
+    EXPECT_NEAR(0.05, clock_type::time_diff(t1, t0), 0.01);
+
+    alps::steady_check_schedule checker(0.02, 0.1);
+    EXPECT_TRUE(checker.pending());
+    checker.update(0.);
+    EXPECT_FALSE(checker.pending());
+    t0=clock_type::now_time();
+    while (!checker.pending()) {
+        ASSERT_GT(1., clock_type::time_diff(clock_type::now_time(), t0)) << "Pending check never occured";
+    }
+    EXPECT_NEAR(0.02, clock_type::time_diff(clock_type::now_time(), t0), 0.01);
+}
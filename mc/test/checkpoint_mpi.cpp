@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+/* Tests that checkpoints in mcmpiadapter::run are coordinated across ranks */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/mc/mpiadapter.hpp>
+#include <alps/mc/stop_callback.hpp>
+
+#include "alps/utilities/mpi.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <signal.h>
+
+class counting_sim : public alps::mcbase {
+    public:
+        counting_sim(const parameters_type& p, std::size_t offset=0)
+            : alps::mcbase(p,offset), count(0), signal_at(-1)
+        {
+            measurements << alps::accumulators::MeanAccumulator<double>("x");
+        }
+
+        void update() {
+            if (++count == signal_at)
+                raise(SIGUSR1);
+        }
+
+        void measure() { measurements["x"] << 1.0; }
+
+        double fraction_completed() const { return count / 100.; }
+
+        using alps::mcbase::save;
+        using alps::mcbase::load;
+
+        void save(alps::hdf5::archive & ar) const {
+            alps::mcbase::save(ar);
+            ar["checkpoint/count"] << count;
+        }
+
+        void load(alps::hdf5::archive & ar) {
+            alps::mcbase::load(ar);
+            ar["checkpoint/count"] >> count;
+        }
+
+        int count;
+        int signal_at;
+
+    protected:
+        void snapshot(alps::checkpoint_snapshot & snap) const {
+            alps::mcbase::snapshot(snap);
+            snap.add("checkpoint/count", count);
+        }
+};
+
+/// Checks progress after every sweep
+struct every_sweep {
+    bool pending() const { return true; }
+    void update(double) {}
+};
+
+typedef alps::mcmpiadapter<counting_sim, every_sweep> sim_type;
+
+static std::string checkpoint_file(alps::mpi::communicator const & comm) {
+    return "checkpoint_mpi.h5." + std::to_string(comm.rank());
+}
+
+static bool file_exists(std::string const & name) {
+    std::FILE * f = std::fopen(name.c_str(), "r");
+    if (f)
+        std::fclose(f);
+    return f != NULL;
+}
+
+static bool never_stop() { return false; }
+
+TEST(CheckpointMPI, SignalOnRoot) {
+    alps::mpi::communicator comm;
+    alps::params p;
+    sim_type::define_parameters(p);
+    std::remove(checkpoint_file(comm).c_str());
+
+    sim_type sim(p, comm, every_sweep());
+    if (comm.rank() == 0)
+        sim.signal_at = 5;
+    alps::checkpoint_policy policy(checkpoint_file(comm), 0);
+    EXPECT_TRUE(sim.run(never_stop, policy));
+
+    // all ranks have written a checkpoint
+    ASSERT_TRUE(file_exists(checkpoint_file(comm)));
+    counting_sim restored(p);
+    restored.load(checkpoint_file(comm));
+    EXPECT_GE(restored.count, 1);
+    EXPECT_LE(restored.count, sim.count);
+    if (comm.rank() == 0) {
+        EXPECT_GE(restored.count, 5);
+    }
+    std::remove(checkpoint_file(comm).c_str());
+}
+
+TEST(CheckpointMPI, NoPolicy) {
+    alps::mpi::communicator comm;
+    alps::params p;
+    sim_type::define_parameters(p);
+    std::remove(checkpoint_file(comm).c_str());
+
+    sim_type sim(p, comm, every_sweep());
+    alps::checkpoint_policy policy(checkpoint_file(comm), 0, 0, false);
+    EXPECT_TRUE(sim.run(never_stop, policy));
+    EXPECT_FALSE(file_exists(checkpoint_file(comm)));
+}
+
+int main(int argc, char**argv)
+{
+   alps::mpi::environment env(argc, argv, false);
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
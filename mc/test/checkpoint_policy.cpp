@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+/* Tests periodic and signal-triggered checkpoints in mcbase::run */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/mc/stop_callback.hpp>
+#include <alps/testing/unique_file.hpp>
+
+#include <gtest/gtest.h>
+
+#include <signal.h>
+
+class periodic_sim : public alps::mcbase {
+    public:
+        periodic_sim(parameters_type const & parms, std::size_t seed_offset = 0)
+            : alps::mcbase(parms, seed_offset)
+            , count(0)
+            , signal_at(-1)
+            , signal_in_snapshot(false)
+            , wait_in_update(false)
+        {
+            measurements << alps::accumulators::MeanAccumulator<double>("X");
+        }
+
+        void update() {
+            if (wait_in_update)
+                wait_checkpoint();
+            if (++count == signal_at)
+                raise(SIGUSR1);
+        }
+
+        void measure() { measurements["X"] << random(); }
+
+        double fraction_completed() const { return count / 50.; }
+
+        using alps::mcbase::save;
+        using alps::mcbase::load;
+
+        void save(alps::hdf5::archive & ar) const {
+            alps::mcbase::save(ar);
+            ar["checkpoint/count"] << count;
+        }
+
+        void load(alps::hdf5::archive & ar) {
+            alps::mcbase::load(ar);
+            ar["checkpoint/count"] >> count;
+        }
+
+        int count;
+        int signal_at;
+        mutable bool signal_in_snapshot;
+        bool wait_in_update;
+
+    protected:
+        void snapshot(alps::checkpoint_snapshot & snap) const {
+            alps::mcbase::snapshot(snap);
+            snap.add("checkpoint/count", count);
+            if (signal_in_snapshot) {
+                signal_in_snapshot = false;
+                raise(SIGUSR1);
+            }
+        }
+};
+
+class checkpoint_policy_test : public ::testing::Test {
+    public:
+        alps::params parameters;
+
+        checkpoint_policy_test() {
+            periodic_sim::define_parameters(parameters);
+        }
+
+        int checkpointed_count(std::string const & filename) {
+            periodic_sim restored(parameters);
+            restored.load(filename);
+            EXPECT_EQ(restored.count, restored.collect_results()["X"].count());
+            return restored.count;
+        }
+};
+
+TEST_F(checkpoint_policy_test, every_nsweeps) {
+    alps::testing::unique_file ufile("checkpoint_policy.h5.", alps::testing::unique_file::REMOVE_AFTER);
+    periodic_sim sim(parameters);
+    alps::checkpoint_policy policy(ufile.name(), 0, 20, false);
+    EXPECT_TRUE(sim.run(alps::stop_callback(0), policy));
+    EXPECT_EQ(50, sim.count);
+
+    // checkpoints are skipped while the previous one is being written
+    int count = checkpointed_count(ufile.name());
+    EXPECT_GE(count, 20);
+    EXPECT_LT(count, 50);
+}
+
+TEST_F(checkpoint_policy_test, on_signal) {
+    alps::testing::unique_file ufile("checkpoint_policy.h5.", alps::testing::unique_file::REMOVE_AFTER);
+    periodic_sim sim(parameters);
+    sim.signal_at = 7;
+    alps::checkpoint_policy policy(ufile.name(), 0);
+
+    // SIGUSR1 triggers a checkpoint, but does not stop the simulation
+    EXPECT_TRUE(sim.run(alps::stop_callback(0), policy));
+    EXPECT_EQ(50, sim.count);
+    EXPECT_EQ(7, checkpointed_count(ufile.name()));
+}
+
+TEST_F(checkpoint_policy_test, signal_before_run) {
+    alps::testing::unique_file ufile("checkpoint_policy.h5.", alps::testing::unique_file::REMOVE_AFTER);
+    periodic_sim sim(parameters);
+    alps::checkpoint_policy policy(ufile.name(), 0);
+
+    // SIGUSR1 pending before the first sweep checkpoints after that sweep
+    raise(SIGUSR1);
+    EXPECT_TRUE(sim.run(alps::stop_callback(0), policy));
+    EXPECT_EQ(50, sim.count);
+    EXPECT_EQ(1, checkpointed_count(ufile.name()));
+}
+
+TEST_F(checkpoint_policy_test, signal_while_checkpointing) {
+    alps::testing::unique_file ufile("checkpoint_policy.h5.", alps::testing::unique_file::REMOVE_AFTER);
+    periodic_sim sim(parameters);
+    sim.signal_in_snapshot = true;
+    sim.wait_in_update = true;
+    alps::checkpoint_policy policy(ufile.name(), 0, 10);
+
+    // SIGUSR1 during the checkpoint after sweep 10 requests another one after
+    // sweep 11, which restarts the count, so the last one is after sweep 41
+    EXPECT_TRUE(sim.run(alps::stop_callback(0), policy));
+    EXPECT_EQ(50, sim.count);
+    EXPECT_FALSE(sim.signal_in_snapshot);
+    EXPECT_EQ(41, checkpointed_count(ufile.name()));
+}
+
+TEST_F(checkpoint_policy_test, signal_ignored) {
+    periodic_sim sim(parameters);
+    sim.signal_at = 7;
+    alps::checkpoint_policy policy("unused.h5", 0, 0, false);
+
+    // without on_signal, SIGUSR1 stops the simulation as before
+    EXPECT_FALSE(sim.run(alps::stop_callback(0), policy));
+    EXPECT_EQ(7, sim.count);
+    alps::signal().pop();
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+/* Tests mcmpiadapter with the cost-aware schedule checker */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/mc/mpiadapter.hpp>
+#include <alps/mc/stop_callback.hpp>
+
+#include <gtest/gtest.h>
+
+/// Fake clock with sub-second resolution
+class fake_clock {
+  public:
+    typedef double time_point_type;
+    typedef double time_duration_type;
+
+    static void advance(double delta) { now_ += delta; }
+
+    static time_point_type now_time() { return now_; }
+
+    static time_duration_type time_diff(time_point_type t1, time_point_type t0) { return t1 - t0; }
+  private:
+    static time_point_type now_;
+};
+
+fake_clock::time_point_type fake_clock::now_ = 0.;
+
+/// Takes one second of fake time per sweep
+class slow_sim : public alps::mcbase {
+    int count_;
+  public:
+    slow_sim(const parameters_type& p, std::size_t offset=0) : alps::mcbase(p,offset), count_(0) {}
+
+    void update() { ++count_; fake_clock::advance(1.); }
+
+    void measure() {}
+
+    double fraction_completed() const { return count_ / 200.; }
+};
+
+typedef alps::detail::generic_cost_aware_check_schedule<fake_clock> fake_schedule;
+
+/// Exposes the schedule checker
+class fake_cost_sim : public alps::mcmpiadapter<slow_sim, fake_schedule> {
+  public:
+    fake_cost_sim(parameters_type const & p, alps::mpi::communicator const & comm)
+        : alps::mcmpiadapter<slow_sim, fake_schedule>(p, comm)
+    {}
+
+    fake_schedule const & checker() const { return this->schedule_checker; }
+};
+
+/// Takes a millisecond of fake time per call
+static bool slow_stop_callback() {
+    fake_clock::advance(0.001);
+    return false;
+}
+
+TEST(CostAwareSchedule, Params) {
+    typedef alps::mcmpiadapter<slow_sim, alps::cost_aware_check_schedule> sim_type;
+    alps::mpi::communicator comm;
+    alps::params p;
+    sim_type::define_parameters(p);
+    EXPECT_TRUE(p.defined("Tmin"));
+    EXPECT_TRUE(p.defined("Tmax"));
+    EXPECT_EQ(0.01, p["CheckOverhead"].as<double>());
+
+    // sub-second intervals are accepted
+    p["Tmin"] = 0.05;
+    p["Tmax"] = 0.5;
+    sim_type sim(p, comm);
+    EXPECT_TRUE(sim.run(alps::stop_callback(60)));
+    EXPECT_GE(sim.fraction_completed(), 1.);
+}
+
+TEST(CostAwareSchedule, OnlyBlockingPartIsTimed) {
+    alps::mpi::communicator comm;
+    alps::params p;
+    fake_cost_sim::define_parameters(p);
+    p["Tmin"] = 0.;
+    p["Tmax"] = 1000.;
+    p["CheckOverhead"] = 0.5;
+
+    fake_cost_sim sim(p, comm);
+    EXPECT_TRUE(sim.run(slow_stop_callback));
+    EXPECT_GE(sim.fraction_completed(), 1.);
+
+    // the sweeps done while the reduction is in flight do not count
+    EXPECT_NEAR(0.001, sim.checker().check_cost(), 1E-9);
+    EXPECT_NEAR(0.002, sim.checker().next_check(), 1E-9);
+}
+
+int main(int argc, char**argv)
+{
+   alps::mpi::environment env(argc, argv, false);
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
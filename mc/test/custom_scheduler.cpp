@@ -47,7 +47,16 @@ TEST(CustomScheduler,Run) {
     sim_type sim(p, comm, my_schecker_type());
     sim.run(stop_callback);
 
-    EXPECT_EQ(sim_type::MAXCOUNT+0, sim.count());
+    // ranks keep sweeping while the progress reduction is in flight, so they
+    // are not in lockstep, but they all stop after the same reduction
+    if (comm.size() == 1) {
+        EXPECT_EQ(sim_type::MAXCOUNT+0, sim.count());
+    }
+    // every rank swept, and some rank completed its sweeps
+    EXPECT_GE(sim.count(), 1);
+    int maxcount = alps::mpi::all_reduce(comm, sim.count(), alps::mpi::maximum<int>());
+    EXPECT_GE(maxcount, sim_type::MAXCOUNT+0);
+    EXPECT_GE(sim.fraction_completed(), 1.);
 }
 
 TEST(CustomScheduler,Params) {
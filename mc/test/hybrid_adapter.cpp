@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/mc/hybridadapter.hpp>
+#include <alps/mc/api.hpp>
+#include <alps/mc/stop_callback.hpp>
+
+#include "alps/utilities/mpi.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+class counting_sim : public alps::mcbase {
+    public:
+        counting_sim(parameters_type const & p, std::size_t seed_offset = 0)
+            : alps::mcbase(p, seed_offset)
+            , count_(0)
+            , total_count_(p["COUNT"])
+            , seed_offset_(seed_offset)
+        {
+            measurements << alps::accumulators::MeanAccumulator<double>("x");
+        }
+
+        static parameters_type& define_parameters(parameters_type & parameters) {
+            alps::mcbase::define_parameters(parameters);
+            return parameters.define<int>("COUNT", 1000, "total number of sweeps");
+        }
+
+        void update() { ++count_; }
+
+        void measure() { measurements["x"] << random(); }
+
+        double fraction_completed() const { return count_ / double(total_count_); }
+
+        int count() const { return count_; }
+
+        std::size_t seed_offset() const { return seed_offset_; }
+
+    private:
+        int count_;
+        int total_count_;
+        std::size_t seed_offset_;
+};
+
+/// Throws in the first update() on thread 0 of rank 0
+class throwing_sim : public counting_sim {
+    public:
+        throwing_sim(parameters_type const & p, std::size_t seed_offset = 0)
+            : counting_sim(p, seed_offset)
+        {}
+
+        void update() {
+            counting_sim::update();
+            if (seed_offset() == 0 && count() == 1)
+                throw std::runtime_error("update failed");
+        }
+};
+
+/// Measures "y" everywhere but on thread 1 of rank 0
+class partial_sim : public counting_sim {
+    public:
+        partial_sim(parameters_type const & p, std::size_t seed_offset = 0)
+            : counting_sim(p, seed_offset)
+        {
+            measurements << alps::accumulators::MeanAccumulator<double>("y");
+        }
+
+        void measure() {
+            counting_sim::measure();
+            if (seed_offset() != 1)
+                measurements["y"] << 1.;
+        }
+};
+
+class always_check {
+    public:
+        bool pending() const { return true; }
+        void update(double) {}
+};
+
+static bool never_stop() { return false; }
+
+TEST(mc_hybrid_adapter, run) {
+    typedef alps::mchybridadapter<counting_sim, always_check> sim_type;
+    alps::mpi::communicator comm;
+    alps::params p;
+    sim_type::define_parameters(p);
+
+    sim_type sim(p, comm, 3, always_check());
+    for (std::size_t i = 0; i != sim.nthreads(); ++i)
+        EXPECT_EQ(comm.rank() * 3 + i, sim.clone(i).seed_offset());
+
+    EXPECT_TRUE(sim.run(never_stop));
+    EXPECT_GE(sim.fraction_completed(), 1.);
+
+    int local = 0;
+    for (std::size_t i = 0; i != sim.nthreads(); ++i)
+        local += sim.clone(i).count();
+    int total = alps::mpi::all_reduce(comm, local, std::plus<int>());
+    EXPECT_GE(total, 1000);
+
+    alps::results_type<sim_type>::type results = alps::collect_results(sim);
+    if (comm.rank() == 0) {
+        EXPECT_EQ(boost::uint64_t(total), results["x"].count());
+    }
+}
+
+TEST(mc_hybrid_adapter, check_schedule) {
+    typedef alps::mchybridadapter<counting_sim> sim_type;
+    alps::mpi::communicator comm;
+    alps::params p;
+    sim_type::define_parameters(p);
+
+    sim_type sim(p, comm, 2);
+    EXPECT_TRUE(sim.run(alps::stop_callback(comm, 60)));
+    EXPECT_GE(sim.fraction_completed(), 1.);
+}
+
+TEST(mc_hybrid_adapter, exception_in_run) {
+    typedef alps::mchybridadapter<throwing_sim, always_check> sim_type;
+    alps::mpi::communicator comm;
+    alps::params p;
+    sim_type::define_parameters(p);
+
+    // all ranks must throw rather than wait for rank 0
+    sim_type sim(p, comm, 2, always_check());
+    EXPECT_THROW(sim.run(never_stop), std::runtime_error);
+}
+
+TEST(mc_hybrid_adapter, partial_measurements) {
+    typedef alps::mchybridadapter<partial_sim, always_check> sim_type;
+    alps::mpi::communicator comm;
+    alps::params p;
+    sim_type::define_parameters(p);
+
+    sim_type sim(p, comm, 2, always_check());
+    EXPECT_TRUE(sim.run(never_stop));
+
+    // merging fails on rank 0 only, but all ranks must throw
+    EXPECT_THROW(alps::results_type<sim_type>::type results = alps::collect_results(sim),
+                 std::runtime_error);
+}
+
+int main(int argc, char**argv)
+{
+   // the threads of the hybrid adapter require MPI_THREAD_FUNNELED
+   int provided;
+   MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+   ::testing::InitGoogleTest(&argc, argv);
+   int rc = RUN_ALL_TESTS();
+   MPI_Finalize();
+   return rc;
+}
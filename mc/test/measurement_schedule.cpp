@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+/* Tests updates per measurement, measurement and strides in mcbase */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/mc/stop_callback.hpp>
+#include <alps/testing/unique_file.hpp>
+
+#include <gtest/gtest.h>
+
+class scheduled_sim : public alps::mcbase {
+    public:
+        scheduled_sim(parameters_type const & parms, std::size_t seed_offset = 0)
+            : alps::mcbase(parms, seed_offset)
+        {
+            measurements << alps::accumulators::MeanAccumulator<double>("X")
+                         << alps::accumulators::MeanAccumulator<double>("Expensive");
+            set_updates_per_measurement(4);
+            set_measurement_stride("Expensive", 3);
+        }
+
+        void update() {}
+
+        void measure() {
+            measurements["X"] << random();
+            if (measure_due("Expensive"))
+                measurements["Expensive"] << 1.;
+        }
+
+        double fraction_completed() const { return update_count() / 100.; }
+
+        unsigned long updates() const { return update_count(); }
+
+        unsigned long measured() const { return measurement_count(); }
+};
+
+class measurement_schedule_test : public ::testing::Test {
+    public:
+        alps::params parameters;
+
+        measurement_schedule_test() {
+            scheduled_sim::define_parameters(parameters);
+        }
+};
+
+TEST_F(measurement_schedule_test, run) {
+    scheduled_sim sim(parameters);
+    EXPECT_TRUE(sim.run(alps::stop_callback(0)));
+    EXPECT_EQ(100u, sim.updates());
+    EXPECT_EQ(25u, sim.measured());
+
+    alps::mcbase::results_type results = sim.collect_results();
+    EXPECT_EQ(25, results["X"].count());
+    EXPECT_EQ(9, results["Expensive"].count());
+}
+
+TEST_F(measurement_schedule_test, save_load) {
+    alps::testing::unique_file ufile("measurement_schedule.h5.", alps::testing::unique_file::REMOVE_AFTER);
+    scheduled_sim sim(parameters);
+    for (int i = 0; i != 8; ++i)
+        sim.sweep();
+    sim.save(ufile.name());
+
+    scheduled_sim restored(parameters);
+    restored.load(ufile.name());
+    EXPECT_EQ(32u, restored.updates());
+    EXPECT_EQ(8u, restored.measured());
+    EXPECT_DOUBLE_EQ(0.32, restored.fraction_completed());
+}
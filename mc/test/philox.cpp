@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+/* Tests the counter-based RNG and its use in basic_mcbase */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/mc/philox.hpp>
+#include <alps/mc/stop_callback.hpp>
+#include <alps/testing/unique_file.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+class philox_sim : public alps::basic_mcbase<alps::philox01> {
+    public:
+        philox_sim(parameters_type const & parms, std::size_t seed_offset = 0)
+            : alps::basic_mcbase<alps::philox01>(parms, seed_offset)
+            , count(0)
+        {
+            measurements << alps::accumulators::FullBinningAccumulator<double>("X");
+        }
+
+        void update() { ++count; }
+
+        void measure() { measurements["X"] << random(); }
+
+        double fraction_completed() const { return count / 100.; }
+
+        alps::philox01 & rng() { return random; }
+
+    private:
+        int count;
+};
+
+TEST(philox, known_answer) {
+    // Random123 known-answer vector for zero counter and key
+    alps::philox4x64 engine;
+    alps::philox4x64::result_type block[alps::philox4x64::BLOCK];
+    engine.generate(0, block);
+    EXPECT_EQ(0x16554d9eca36314cULL, block[0]);
+    EXPECT_EQ(0xdb20fe9d672d0fdcULL, block[1]);
+    EXPECT_EQ(0xd7e772cee186176bULL, block[2]);
+    EXPECT_EQ(0x7e68b68aec7ba23bULL, block[3]);
+
+    for (std::size_t i = 0; i != alps::philox4x64::BLOCK; ++i)
+        EXPECT_EQ(block[i], engine());
+}
+
+TEST(philox, discard) {
+    alps::philox4x64 a(3, 5), b(3, 5);
+    for (int n = 0; n != 11; ++n) {
+        for (int i = 0; i != n; ++i)
+            a();
+        b.discard(n);
+        EXPECT_EQ(a, b);
+        EXPECT_EQ(a(), b());
+    }
+}
+
+TEST(philox, fill) {
+    alps::philox01 a(42, 1), b(42, 1);
+    a();
+    b();
+    std::vector<double> block(23);
+    a.fill(&block[0], block.size());
+    for (std::size_t i = 0; i != block.size(); ++i) {
+        EXPECT_EQ(b(), block[i]);
+        EXPECT_GE(block[i], 0.);
+        EXPECT_LT(block[i], 1.);
+    }
+    EXPECT_EQ(a(), b());
+}
+
+TEST(philox, streams) {
+    alps::philox01 a(42, 0), b(42, 1), c(43, 0);
+    for (int i = 0; i != 10; ++i) {
+        double x = a(), y = b(), z = c();
+        EXPECT_NE(x, y);
+        EXPECT_NE(x, z);
+        EXPECT_NE(y, z);
+    }
+}
+
+TEST(philox, save_load) {
+    alps::testing::unique_file ufile("philox.h5.", alps::testing::unique_file::REMOVE_AFTER);
+    alps::philox01 a(7, 2);
+    for (int i = 0; i != 6; ++i)
+        a();
+    {
+        alps::hdf5::archive ar(ufile.name(), "w");
+        ar["/rng"] << a;
+    }
+
+    alps::philox01 b;
+    {
+        alps::hdf5::archive ar(ufile.name(), "r");
+        ar["/rng"] >> b;
+    }
+    EXPECT_EQ(a.engine(), b.engine());
+    for (int i = 0; i != 10; ++i)
+        EXPECT_EQ(a(), b());
+}
+
+TEST(philox, mcbase) {
+    alps::testing::unique_file ufile("philox_sim.h5.", alps::testing::unique_file::REMOVE_AFTER);
+    alps::params parameters;
+    philox_sim::define_parameters(parameters);
+
+    // the seed offset selects a stream rather than changing the seed
+    philox_sim sim(parameters, 3);
+    EXPECT_EQ(42u, sim.rng().engine().seed());
+    EXPECT_EQ(3u, sim.rng().engine().stream());
+
+    sim.run(alps::stop_callback(5));
+    EXPECT_EQ(100, sim.collect_results()["X"].count());
+    sim.save(ufile.name());
+
+    philox_sim restored(parameters, 0);
+    restored.load(ufile.name());
+    EXPECT_EQ(sim.rng().engine(), restored.rng().engine());
+    EXPECT_EQ(sim.rng()(), restored.rng()());
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+/* Tests the parallel tempering driver within a single process */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/mc/replica_exchange.hpp>
+#include <alps/mc/stop_callback.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+/// Two-level system with energy 0 or 1, sampled by Metropolis
+class two_level_sim : public alps::mcbase {
+    public:
+        two_level_sim(parameters_type const & parms, std::size_t seed_offset = 0)
+            : alps::mcbase(parms, seed_offset)
+            , beta(1.)
+            , state(0)
+            , count(0)
+        {
+            measurements << alps::accumulators::MeanAccumulator<double>("E");
+        }
+
+        void update() {
+            if (state == 1 || random() < std::exp(-beta))
+                state = 1 - state;
+            ++count;
+        }
+
+        void measure() { measurements["E"] << double(state); }
+
+        double fraction_completed() const { return count / 20000.; }
+
+        double energy() const { return state; }
+
+        void set_beta(double b) { beta = b; }
+
+        static double exact(double b) { return 1. / (1. + std::exp(b)); }
+
+        double beta;
+        int state;
+        int count;
+};
+
+typedef alps::replica_exchange<two_level_sim> exchange_type;
+
+static double never(double, double, double, double) { return 0.; }
+
+static double always(double, double, double, double) { return 1.; }
+
+/// Stops after `n` rounds
+struct stop_after {
+    stop_after(int n) : n(new int(n)) {}
+    bool operator()() const { return --*n <= 0; }
+    std::shared_ptr<int> n;
+};
+
+class replica_exchange_test : public ::testing::Test {
+    public:
+        alps::params parameters;
+        std::vector<double> betas;
+
+        replica_exchange_test() {
+            exchange_type::define_parameters(parameters);
+            betas.push_back(0.2);
+            betas.push_back(0.5);
+            betas.push_back(1.);
+            betas.push_back(2.);
+            betas.push_back(4.);
+        }
+};
+
+TEST_F(replica_exchange_test, boltzmann) {
+    exchange_type sim(parameters, betas, 2, 2);
+    EXPECT_TRUE(sim.run(alps::stop_callback(0)));
+    EXPECT_EQ(1., sim.fraction_completed());
+    EXPECT_EQ(10000u, sim.rounds());
+
+    for (std::size_t t = 0; t != betas.size(); ++t) {
+        exchange_type::results_type results = sim.collect_results(t);
+        // one replica at each temperature at any time
+        EXPECT_EQ(20000, results["E"].count());
+        EXPECT_NEAR(two_level_sim::exact(betas[t]), results["E"].mean<double>(), 0.02);
+        if (t + 1 != betas.size()) {
+            EXPECT_GT(sim.acceptance_rate(t), 0.);
+            EXPECT_LT(sim.acceptance_rate(t), 1.);
+        }
+    }
+
+    // temperatures were swapped, not configurations
+    for (std::size_t r = 0; r != betas.size(); ++r) {
+        EXPECT_EQ(r, sim.replica_at(sim.temperature_of(r)));
+        EXPECT_EQ(betas[sim.temperature_of(r)], sim.replica(r).beta);
+    }
+}
+
+TEST_F(replica_exchange_test, never) {
+    exchange_type sim(parameters, betas, 1, 1, &never);
+    sim.run(alps::stop_callback(0));
+    for (std::size_t r = 0; r != betas.size(); ++r)
+        EXPECT_EQ(r, sim.temperature_of(r));
+    EXPECT_EQ(0., sim.acceptance_rate(0));
+}
+
+TEST_F(replica_exchange_test, always) {
+    exchange_type sim(parameters, betas, 3, 1, &always);
+    EXPECT_FALSE(sim.run(stop_after(2)));
+    EXPECT_EQ(2u, sim.rounds());
+
+    // swaps of temperatures (0,1), (2,3), then (1,2), (3,4)
+    EXPECT_EQ(2u, sim.temperature_of(0));
+    EXPECT_EQ(0u, sim.temperature_of(1));
+    EXPECT_EQ(4u, sim.temperature_of(2));
+    EXPECT_EQ(1u, sim.temperature_of(3));
+    EXPECT_EQ(3u, sim.temperature_of(4));
+    EXPECT_EQ(1., sim.acceptance_rate(0));
+
+    // each temperature was measured once per round
+    for (std::size_t t = 0; t != betas.size(); ++t)
+        EXPECT_EQ(2, sim.collect_results(t)["E"].count());
+}
+
+/// Throws in the 100th update of the replica with seed offset 1
+class throwing_sim : public two_level_sim {
+    public:
+        throwing_sim(parameters_type const & parms, std::size_t seed_offset = 0)
+            : two_level_sim(parms, seed_offset)
+            , seed_offset(seed_offset)
+        {}
+
+        void update() {
+            if (seed_offset == 1 && count == 99)
+                throw std::runtime_error("update failed");
+            two_level_sim::update();
+        }
+
+        std::size_t seed_offset;
+};
+
+TEST_F(replica_exchange_test, worker_exception) {
+    alps::replica_exchange<throwing_sim> sim(parameters, betas, 2, 1);
+    // replica 1 is swept by the worker thread
+    EXPECT_THROW(sim.run(alps::stop_callback(0)), std::runtime_error);
+    EXPECT_EQ(99u, sim.rounds());
+}
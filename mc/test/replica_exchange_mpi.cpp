@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+/* Tests the parallel tempering driver with replicas on several ranks */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/mc/replica_exchange.hpp>
+#include <alps/mc/stop_callback.hpp>
+
+#include "alps/utilities/mpi.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+
+/// Two-level system with energy 0 or 1, sampled by Metropolis
+class two_level_sim : public alps::mcbase {
+    public:
+        two_level_sim(parameters_type const & parms, std::size_t seed_offset = 0)
+            : alps::mcbase(parms, seed_offset)
+            , beta(1.)
+            , state(0)
+            , count(0)
+        {
+            measurements << alps::accumulators::MeanAccumulator<double>("E");
+        }
+
+        void update() {
+            if (state == 1 || random() < std::exp(-beta))
+                state = 1 - state;
+            ++count;
+        }
+
+        void measure() { measurements["E"] << double(state); }
+
+        double fraction_completed() const { return count / 20000.; }
+
+        double energy() const { return state; }
+
+        void set_beta(double b) { beta = b; }
+
+        static double exact(double b) { return 1. / (1. + std::exp(b)); }
+
+        double beta;
+        int state;
+        int count;
+};
+
+typedef alps::replica_exchange<two_level_sim> exchange_type;
+
+TEST(ReplicaExchangeMPI, Boltzmann) {
+    alps::mpi::communicator comm;
+    alps::params p;
+    exchange_type::define_parameters(p);
+    std::vector<double> betas;
+    for (int t = 0; t != 6; ++t)
+        betas.push_back(0.25 * (t + 1));
+
+    exchange_type sim(p, comm, betas, 2, 1);
+    EXPECT_TRUE(sim.run(alps::stop_callback(0)));
+
+    // all ranks agree on the temperatures of the replicas
+    for (std::size_t r = 0; r != betas.size(); ++r) {
+        int t = sim.temperature_of(r);
+        EXPECT_EQ(comm.size() * t, alps::mpi::all_reduce(comm, t, std::plus<int>()));
+    }
+    for (std::size_t i = 0; i != sim.nlocal(); ++i)
+        EXPECT_EQ(betas[sim.temperature_of(sim.first_replica() + i)], sim.replica(i).beta);
+
+    for (std::size_t t = 0; t != betas.size(); ++t) {
+        exchange_type::results_type results = sim.collect_results(t);
+        if (comm.rank() == 0) {
+            EXPECT_EQ(20000, results["E"].count());
+            EXPECT_NEAR(two_level_sim::exact(betas[t]), results["E"].mean<double>(), 0.02);
+        }
+    }
+}
+
+/// Two-level system whose first replica throws after some updates
+class failing_sim : public two_level_sim {
+    public:
+        failing_sim(parameters_type const & parms, std::size_t seed_offset = 0)
+            : two_level_sim(parms, seed_offset)
+            , fails(seed_offset == 0)
+        {}
+
+        void update() {
+            if (fails && count == 100)
+                throw std::logic_error("replica failed");
+            two_level_sim::update();
+        }
+
+        bool fails;
+};
+
+TEST(ReplicaExchangeMPI, Failure) {
+    alps::mpi::communicator comm;
+    alps::params p;
+    alps::replica_exchange<failing_sim>::define_parameters(p);
+    std::vector<double> betas;
+    for (int t = 0; t != 6; ++t)
+        betas.push_back(0.25 * (t + 1));
+
+    // the failing replica is on rank 0; all other ranks must throw as well
+    alps::replica_exchange<failing_sim> sim(p, comm, betas, 2, 10);
+    if (comm.rank() == 0)
+        EXPECT_THROW(sim.run(alps::stop_callback(0)), std::logic_error);
+    else
+        EXPECT_THROW(sim.run(alps::stop_callback(0)), std::runtime_error);
+    EXPECT_LT(sim.rounds(), 20u);
+}
+
+int main(int argc, char**argv)
+{
+   alps::mpi::environment env(argc, argv, false);
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -92,7 +92,7 @@ TEST(mc, sum_mpi){
 
         alps::mcmpiadapter<my_sim_type> my_sim(params, c, alps::check_schedule(t_min_check, t_max_check)); // create a simulation
 
-        my_sim.run(alps::stop_callback(c, timelimit)); // run the simulation
+        my_sim.run(alps::stop_callback(timelimit)); // run the simulation
 
         using alps::collect_results;
 
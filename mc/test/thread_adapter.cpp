@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/mc/threadadapter.hpp>
+#include <alps/mc/api.hpp>
+#include <alps/mc/stop_callback.hpp>
+
+#include <alps/testing/unique_file.hpp>
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+class counting_sim : public alps::mcbase {
+    public:
+        counting_sim(parameters_type const & p, std::size_t seed_offset = 0)
+            : alps::mcbase(p, seed_offset)
+            , count_(0)
+            , total_count_(p["COUNT"])
+            , fail_on_(p["FAIL_ON"])
+            , seed_offset_(seed_offset)
+        {
+            measurements << alps::accumulators::MeanAccumulator<double>("x");
+        }
+
+        static parameters_type& define_parameters(parameters_type & parameters) {
+            alps::mcbase::define_parameters(parameters);
+            return parameters
+                .define<int>("COUNT", 1000, "total number of sweeps")
+                .define<int>("FAIL_ON", -1, "seed offset of the clone which throws");
+        }
+
+        void update() {
+            if (int(seed_offset_) == fail_on_)
+                throw std::runtime_error("update failed");
+            ++count_;
+        }
+
+        void measure() { measurements["x"] << random(); }
+
+        // each clone contributes its share to the total fraction
+        double fraction_completed() const { return count_ / double(total_count_); }
+
+        int count() const { return count_; }
+
+        void save(alps::hdf5::archive & ar) const {
+            alps::mcbase::save(ar);
+            ar["count"] << count_;
+        }
+
+        void load(alps::hdf5::archive & ar) {
+            alps::mcbase::load(ar);
+            ar["count"] >> count_;
+        }
+
+    private:
+        int count_;
+        int total_count_;
+        int fail_on_;
+        std::size_t seed_offset_;
+};
+
+class always_check {
+    public:
+        bool pending() const { return true; }
+        void update(double) {}
+};
+
+typedef alps::mcthreadadapter<counting_sim, always_check> thread_sim;
+
+static bool never_stop() { return false; }
+
+TEST(mc_thread_adapter, run) {
+    alps::params p;
+    thread_sim::define_parameters(p);
+    EXPECT_FALSE(p.defined("Tmin"));
+
+    thread_sim sim(p, 4, always_check());
+    EXPECT_EQ(4u, sim.nthreads());
+    EXPECT_TRUE(sim.run(never_stop));
+    EXPECT_GE(sim.fraction_completed(), 1.);
+
+    int total = 0;
+    for (std::size_t i = 0; i != sim.nthreads(); ++i)
+        total += sim.clone(i).count();
+    EXPECT_GE(total, 1000);
+
+    // results are merged over all clones
+    alps::results_type<thread_sim>::type results = alps::collect_results(sim);
+    EXPECT_EQ(boost::uint64_t(total), results["x"].count());
+    EXPECT_NEAR(0.5, results["x"].mean<double>(), 0.05);
+}
+
+TEST(mc_thread_adapter, save_load) {
+    alps::params p;
+    thread_sim::define_parameters(p);
+    alps::testing::unique_file ufile("thread_adapter.h5.", alps::testing::unique_file::REMOVE_AFTER);
+    const std::string & filename = ufile.name();
+
+    thread_sim sim(p, 3, always_check());
+    sim.run(never_stop);
+    sim.save(filename);
+
+    thread_sim sim2(p, 3, always_check());
+    sim2.load(filename);
+    EXPECT_EQ(sim.fraction_completed(), sim2.fraction_completed());
+    for (std::size_t i = 0; i != sim.nthreads(); ++i)
+        EXPECT_EQ(sim.clone(i).count(), sim2.clone(i).count());
+    EXPECT_EQ(alps::collect_results(sim)["x"].count(),
+              alps::collect_results(sim2)["x"].count());
+
+    // more threads than clones in the checkpoint
+    thread_sim sim3(p, 4, always_check());
+    EXPECT_THROW(sim3.load(filename), std::runtime_error);
+}
+
+TEST(mc_thread_adapter, exception) {
+    alps::params p;
+    thread_sim::define_parameters(p);
+    p["FAIL_ON"] = 2;
+
+    thread_sim sim(p, 4, always_check());
+    EXPECT_THROW(sim.run(never_stop), std::runtime_error);
+}
+
+TEST(mc_thread_adapter, check_schedule) {
+    typedef alps::mcthreadadapter<counting_sim> sim_type;
+    alps::params p;
+    sim_type::define_parameters(p);
+    EXPECT_TRUE(p.defined("Tmin"));
+    EXPECT_TRUE(p.defined("Tmax"));
+
+    sim_type sim(p, 2);
+    EXPECT_TRUE(sim.run(alps::stop_callback(60)));
+    EXPECT_GE(sim.fraction_completed(), 1.);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 1998-2018 ALPS Collaboration. See COPYRIGHT.TXT
+ * All rights reserved. Use is subject to license terms. See LICENSE.TXT
+ * For use in publications, see ACKNOWLEDGE.TXT
+ */
+
+#include <alps/mc/mcbase.hpp>
+#include <alps/mc/mpiadapter.hpp>
+#include <alps/mc/api.hpp>
+
+#include "alps/utilities/mpi.hpp"
+
+#include <gtest/gtest.h>
+
+#include <time.h>
+
+class counting_sim : public alps::mcbase {
+    int count_;
+    bool slow_;
+  public:
+    counting_sim(const parameters_type& p, std::size_t offset=0)
+        : alps::mcbase(p,offset), count_(0), slow_(offset == 0)
+    {
+        measurements << alps::accumulators::MeanAccumulator<double>("x");
+    }
+
+    void update() {
+        ++count_;
+        if (slow_) {
+            // rank 0 is much slower than the others
+            timespec requested;
+            requested.tv_sec=0;
+            requested.tv_nsec=100000;
+            nanosleep(&requested, 0);
+        }
+    }
+
+    void measure() { measurements["x"] << 1.0; }
+
+    double fraction_completed() const { return 0; }
+
+    int count() const { return count_; }
+};
+
+static bool never_stop() { return false; }
+
+static bool always_stop() { return true; }
+
+TEST(WorkBudget, Run) {
+    typedef alps::mcmpiadapter<counting_sim> sim_type;
+    alps::mpi::communicator comm;
+    alps::params p;
+    sim_type::define_parameters(p);
+
+    sim_type sim(p, comm, alps::check_schedule(1, 60));
+    EXPECT_TRUE(sim.run_budget(never_stop, 1000, 10));
+    EXPECT_EQ(1., sim.fraction_completed());
+
+    // the budget is exhausted exactly
+    int total = alps::mpi::all_reduce(comm, sim.count(), std::plus<int>());
+    EXPECT_EQ(1000, total);
+    if (comm.size() > 1 && comm.rank() != 0) {
+        EXPECT_GT(sim.count(), 1000 / comm.size());
+    }
+
+    alps::results_type<sim_type>::type results = alps::collect_results(sim);
+    if (comm.rank() == 0) {
+        EXPECT_EQ(1000u, results["x"].count());
+    }
+}
+
+TEST(WorkBudget, Stop) {
+    typedef alps::mcmpiadapter<counting_sim> sim_type;
+    alps::mpi::communicator comm;
+    alps::params p;
+    sim_type::define_parameters(p);
+
+    sim_type sim(p, comm, alps::check_schedule(1, 60));
+    EXPECT_FALSE(sim.run_budget(always_stop, 1000));
+    EXPECT_EQ(0, sim.count());
+}
+
+int main(int argc, char**argv)
+{
+   alps::mpi::environment env(argc, argv, false);
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}